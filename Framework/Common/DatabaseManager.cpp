@@ -24,10 +24,104 @@
 #include <Core/Logging.h>
 #include <Core/OrthancException.h>
 
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/thread.hpp>
 
 namespace OrthancDatabases
 {
+  class DatabaseManager::GroupMember : public boost::noncopyable
+  {
+  private:
+    typedef std::list< std::pair<StatementLocation, Dictionary*> >  Journal;
+
+    Journal             journal_;
+    bool                replayable_;
+    bool                settled_;
+    Orthanc::ErrorCode  status_;
+
+  public:
+    GroupMember() :
+      replayable_(true),
+      settled_(false),
+      status_(Orthanc::ErrorCode_Success)
+    {
+    }
+
+    ~GroupMember()
+    {
+      for (Journal::iterator it = journal_.begin(); it != journal_.end(); ++it)
+      {
+        assert(it->second != NULL);
+        delete it->second;
+      }
+    }
+
+    // Records a statement that modifies the database, so that it can
+    // be replayed if the group commit fails. The caller is blocked
+    // until the member is settled, so the file references remain valid.
+    void Record(const StatementLocation& location,
+                const Dictionary& parameters)
+    {
+      std::auto_ptr<Dictionary> copy(new Dictionary);
+      parameters.Copy(*copy);
+
+      journal_.push_back(std::make_pair(location, copy.get()));
+      copy.release();
+    }
+
+    void SetNotReplayable()
+    {
+      replayable_ = false;
+    }
+
+    bool IsReplayable() const
+    {
+      return replayable_;
+    }
+
+    bool IsReadOnly() const
+    {
+      return replayable_ && journal_.empty();
+    }
+
+    void Replay(DatabaseManager& manager,
+                ITransaction& transaction) const
+    {
+      for (Journal::const_iterator it = journal_.begin(); it != journal_.end(); ++it)
+      {
+        IPrecompiledStatement* statement = manager.LookupCachedStatement(it->first);
+
+        if (statement == NULL)
+        {
+          // Cannot occur, as the cached statements are not discarded
+          // while some group is waiting for its commit
+          LOG(ERROR) << "Cannot replay the statement from "
+                     << it->first.GetFile() << ":" << it->first.GetLine();
+          throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+        }
+
+        transaction.ExecuteWithoutResult(*statement, *it->second);
+      }
+    }
+
+    void Settle(Orthanc::ErrorCode status)
+    {
+      settled_ = true;
+      status_ = status;
+    }
+
+    bool IsSettled() const
+    {
+      return settled_;
+    }
+
+    Orthanc::ErrorCode GetStatus() const
+    {
+      return status_;
+    }
+  };
+
+
   IDatabase& DatabaseManager::GetDatabase()
   {
     static const unsigned int MAX_CONNECTION_ATTEMPTS = 10;   // TODO: Parameter
@@ -41,6 +135,7 @@ namespace OrthancDatabases
       try
       {
         database_.reset(factory_->Open());
+        PrepareStatements();
       }
       catch (Orthanc::OrthancException& e)
       {
@@ -80,19 +175,28 @@ namespace OrthancDatabases
   {
     LOG(TRACE) << "Closing the connection to the database";
 
+    // Don't lose the transactions that are waiting for their group commit
+    CloseGroupCommit();
+
     // Rollback active transaction, if any
     transaction_.reset(NULL);
 
     // Delete all the cached statements (must occur before closing
-    // the database)
-    for (CachedStatements::iterator it = cachedStatements_.begin();
-         it != cachedStatements_.end(); ++it)
+    // the database), but keep their queries for the next connection
+    for (StatementsUsage::const_iterator it = statementsUsage_.begin();
+         it != statementsUsage_.end(); ++it)
     {
-      assert(it->second != NULL);
-      delete it->second;
+      CachedStatements::iterator found = cachedStatements_.find(*it);
+      assert(found != cachedStatements_.end() &&
+             found->second.statement_ != NULL &&
+             found->second.query_ != NULL);
+
+      delete found->second.statement_;
+      pendingQueries_.push_back(std::make_pair(*it, found->second.query_));
     }
 
     cachedStatements_.clear();
+    statementsUsage_.clear();
 
     // Close the database
     database_.reset(NULL);
@@ -116,9 +220,9 @@ namespace OrthancDatabases
   }
 
 
-  IPrecompiledStatement* DatabaseManager::LookupCachedStatement(const StatementLocation& location) const
+  IPrecompiledStatement* DatabaseManager::LookupCachedStatement(const StatementLocation& location)
   {
-    CachedStatements::const_iterator found = cachedStatements_.find(location);
+    CachedStatements::iterator found = cachedStatements_.find(location);
 
     if (found == cachedStatements_.end())
     {
@@ -126,18 +230,29 @@ namespace OrthancDatabases
     }
     else
     {
-      assert(found->second != NULL);
-      return found->second;
+      assert(found->second.statement_ != NULL);
+
+      // Mark the statement as the most recently used
+      statementsUsage_.splice(statementsUsage_.begin(), statementsUsage_, found->second.usage_);
+
+      return found->second.statement_;
     }
   }
 
     
   IPrecompiledStatement& DatabaseManager::CacheStatement(const StatementLocation& location,
-                                                         const Query& query)
+                                                         Query* query)
   {
+    std::auto_ptr<Query> protection(query);
+
+    if (query == NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_NullPointer);
+    }
+
     LOG(TRACE) << "Caching statement from " << location.GetFile() << ":" << location.GetLine();
       
-    std::auto_ptr<IPrecompiledStatement> statement(GetDatabase().Compile(query));
+    std::auto_ptr<IPrecompiledStatement> statement(GetDatabase().Compile(*query));
       
     IPrecompiledStatement* tmp = statement.get();
     if (tmp == NULL)
@@ -146,14 +261,102 @@ namespace OrthancDatabases
     }
 
     assert(cachedStatements_.find(location) == cachedStatements_.end());
-    cachedStatements_[location] = statement.release();
+
+    statementsUsage_.push_front(location);
+
+    CachedStatementEntry& entry = cachedStatements_[location];
+    entry.statement_ = statement.release();
+    entry.query_ = protection.release();
+    entry.usage_ = statementsUsage_.begin();
 
     return *tmp;
   }
 
+
+  void DatabaseManager::PrepareStatements()
+  {
+    if (pendingQueries_.empty())
+    {
+      return;
+    }
+
+    const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+    std::vector<IPrecompiledStatement*> statements;
+    statements.reserve(pendingQueries_.size());
+
+    // Start with the least recently used statements, so as to restore
+    // the order of the cache
+    while (!pendingQueries_.empty())
+    {
+      StatementLocation location = pendingQueries_.back().first;
+      Query* query = pendingQueries_.back().second;
+      pendingQueries_.pop_back();
+
+      try
+      {
+        statements.push_back(&CacheStatement(location, query));
+      }
+      catch (Orthanc::OrthancException&)
+      {
+        // The statement will be compiled again on its first use
+      }
+    }
+
+    try
+    {
+      database_->Prepare(statements);
+    }
+    catch (Orthanc::OrthancException&)
+    {
+      // The statements will be prepared on their first use
+    }
+
+    LOG(WARNING) << "Warm-up of the connection to the database: " << statements.size()
+                 << " statements prepared in "
+                 << (boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds()
+                 << "ms";
+  }
+
+
+  void DatabaseManager::EvictCachedStatements()
+  {
+    // Only invoked if no "CachedStatement" is alive, as the latter
+    // keeps a raw pointer to the "IPrecompiledStatement"
+    assert(activeStatements_ == 0);
+
+    if (groupCommitOpen_)
+    {
+      // The statements of the open group might have to be replayed
+      return;
+    }
+
+    while (maxCachedStatements_ != 0 &&
+           cachedStatements_.size() > maxCachedStatements_)
+    {
+      assert(!statementsUsage_.empty());
+
+      CachedStatements::iterator oldest = cachedStatements_.find(statementsUsage_.back());
+      assert(oldest != cachedStatements_.end() &&
+             oldest->second.statement_ != NULL);
+
+      LOG(TRACE) << "Discarding cached statement from "
+                 << oldest->first.GetFile() << ":" << oldest->first.GetLine();
+
+      // Deallocates the prepared statement on the server side
+      delete oldest->second.statement_;
+      delete oldest->second.query_;
+
+      cachedStatements_.erase(oldest);
+      statementsUsage_.pop_back();
+    }
+  }
+
     
   ITransaction& DatabaseManager::GetTransaction()
   {
+    CloseGroupCommit();
+
     if (transaction_.get() == NULL)
     {
       LOG(TRACE) << "Automatically creating an implicit database transaction";
@@ -174,6 +377,104 @@ namespace OrthancDatabases
   }
 
 
+  void DatabaseManager::CloseGroupCommit()
+  {
+    if (groupCommitOpen_ &&
+        groupCommitActive_ == NULL)
+    {
+      FlushGroupCommit(true);
+    }
+  }
+
+
+  void DatabaseManager::FlushGroupCommit(bool commit)
+  {
+    std::list<GroupMember*> members;
+    members.swap(groupCommitWaiting_);
+
+    groupCommitOpen_ = false;
+    groupCommitActive_ = NULL;
+
+    Orthanc::ErrorCode error = Orthanc::ErrorCode_Success;
+
+    if (commit)
+    {
+      try
+      {
+        if (transaction_.get() == NULL)
+        {
+          // The transaction was rolled back by an error
+          throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+        }
+
+        transaction_->Commit();
+        transaction_.reset(NULL);
+
+        groupCommitsCount_ ++;
+        groupedTransactionsCount_ += members.size();
+      }
+      catch (Orthanc::OrthancException& e)
+      {
+        error = e.GetErrorCode();
+        LOG(WARNING) << "Cannot commit a group of " << members.size()
+                     << " transactions, replaying them one by one: " << e.What();
+      }
+    }
+
+    if (commit &&
+        error == Orthanc::ErrorCode_Success)
+    {
+      for (std::list<GroupMember*>::iterator it = members.begin(); it != members.end(); ++it)
+      {
+        (*it)->Settle(Orthanc::ErrorCode_Success);
+      }
+    }
+    else
+    {
+      transaction_.reset(NULL);  // Rollback
+
+      if (error == Orthanc::ErrorCode_DatabaseUnavailable)
+      {
+        Close();
+      }
+
+      for (std::list<GroupMember*>::iterator it = members.begin(); it != members.end(); ++it)
+      {
+        if ((*it)->IsReplayable())
+        {
+          ReplayGroupMember(**it);
+        }
+        else
+        {
+          (*it)->Settle(error == Orthanc::ErrorCode_Success ? Orthanc::ErrorCode_Database : error);
+        }
+      }
+    }
+
+    groupCommitDone_.notify_all();
+  }
+
+
+  void DatabaseManager::ReplayGroupMember(GroupMember& member)
+  {
+    try
+    {
+      transaction_.reset(GetDatabase().CreateTransaction(false));
+      member.Replay(*this, *transaction_);
+      transaction_->Commit();
+      transaction_.reset(NULL);
+      member.Settle(Orthanc::ErrorCode_Success);
+    }
+    catch (Orthanc::OrthancException& e)
+    {
+      LOG(ERROR) << "Cannot replay a transaction of a failed group commit: " << e.What();
+      CloseIfUnavailable(e.GetErrorCode());
+      transaction_.reset(NULL);
+      member.Settle(e.GetErrorCode());
+    }
+  }
+
+
   void DatabaseManager::ReleaseImplicitTransaction()
   {
     if (transaction_.get() != NULL &&
@@ -196,7 +497,14 @@ namespace OrthancDatabases
 
     
   DatabaseManager::DatabaseManager(IDatabaseFactory* factory) :  // Takes ownership
-    factory_(factory)
+    factory_(factory),
+    maxCachedStatements_(256),
+    activeStatements_(0),
+    groupCommitWindow_(0),
+    groupCommitOpen_(false),
+    groupCommitActive_(NULL),
+    groupCommitsCount_(0),
+    groupedTransactionsCount_(0)
   {
     if (factory == NULL)
     {
@@ -206,6 +514,19 @@ namespace OrthancDatabases
     dialect_ = factory->GetDialect();
   }
 
+
+  DatabaseManager::~DatabaseManager()
+  {
+    Close();
+
+    for (PendingQueries::iterator it = pendingQueries_.begin();
+         it != pendingQueries_.end(); ++it)
+    {
+      assert(it->second != NULL);
+      delete it->second;
+    }
+  }
+
   
   void DatabaseManager::StartTransaction()
   {
@@ -213,6 +534,8 @@ namespace OrthancDatabases
 
     try
     {
+      CloseGroupCommit();
+
       if (transaction_.get() != NULL)
       {
         LOG(ERROR) << "Cannot start another transaction while there is an uncommitted transaction";
@@ -279,6 +602,54 @@ namespace OrthancDatabases
   }
 
 
+  bool DatabaseManager::IsTransactionActive()
+  {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    return transaction_.get() != NULL;
+  }
+
+
+  void DatabaseManager::SetMaxCachedStatements(size_t count)
+  {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    maxCachedStatements_ = count;
+
+    if (activeStatements_ == 0)
+    {
+      EvictCachedStatements();
+    }
+  }
+
+
+  size_t DatabaseManager::GetCachedStatementsCount()
+  {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    return cachedStatements_.size();
+  }
+
+
+  void DatabaseManager::SetGroupCommit(unsigned int windowMilliseconds)
+  {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+
+    if (windowMilliseconds == 0)
+    {
+      CloseGroupCommit();
+    }
+
+    groupCommitWindow_ = windowMilliseconds;
+  }
+
+
+  void DatabaseManager::GetGroupCommitStatistics(uint64_t& commits,
+                                                 uint64_t& transactions)
+  {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    commits = groupCommitsCount_;
+    transactions = groupedTransactionsCount_;
+  }
+
+
   IResult& DatabaseManager::CachedStatement::GetResult() const
   {
     if (result_.get() == NULL)
@@ -307,13 +678,72 @@ namespace OrthancDatabases
   }
 
 
-  DatabaseManager::Transaction::Transaction(DatabaseManager& manager) :
+  void DatabaseManager::CachedStatement::Setup(const IStatementTemplate& statement)
+  {
+    Setup(statement.GetSql(manager_.GetDialect()));
+
+    if (query_.get() != NULL)
+    {
+      // First use of the statement on this connection
+      for (size_t i = 0; i < statement.GetParametersCount(); i++)
+      {
+        const StatementParameter& parameter = statement.GetParameter(i);
+
+        if (parameter.name_ == NULL ||
+            !query_->HasParameter(parameter.name_))
+        {
+          LOG(ERROR) << "Parameter of a statement template that is not in its SQL: "
+                     << (parameter.name_ == NULL ? "(null)" : parameter.name_);
+          throw Orthanc::OrthancException(Orthanc::ErrorCode_InternalError);
+        }
+
+        query_->SetType(parameter.name_, parameter.type_);
+      }
+
+      // "${}" is the default value for INSERT, not a parameter
+      size_t count = query_->GetParametersCount() - (query_->HasParameter("") ? 1 : 0);
+
+      if (count != statement.GetParametersCount())
+      {
+        LOG(ERROR) << "Undeclared parameter in the SQL of a statement template: "
+                   << statement.GetSql(manager_.GetDialect());
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_InternalError);
+      }
+    }
+  }
+
+
+  DatabaseManager::Transaction::Transaction(DatabaseManager& manager,
+                                            bool readOnly) :
     lock_(manager.mutex_),
     manager_(manager),
     database_(manager.GetDatabase()),
     committed_(false)
   {
-    manager_.StartTransaction();
+    if (manager_.groupCommitWindow_ == 0 ||
+        readOnly)
+    {
+      // "StartTransaction()" commits the group that is open, if any
+      manager_.StartTransaction();
+    }
+    else
+    {
+      if (manager_.groupCommitOpen_ &&
+          manager_.transaction_.get() != NULL)
+      {
+        // Join the database transaction of the group, as all the
+        // other transactions of the group are waiting for their commit
+        assert(manager_.groupCommitActive_ == NULL);
+      }
+      else
+      {
+        manager_.StartTransaction();
+        manager_.groupCommitOpen_ = true;
+      }
+
+      member_.reset(new GroupMember);
+      manager_.groupCommitActive_ = member_.get();
+    }
   }
 
 
@@ -321,14 +751,27 @@ namespace OrthancDatabases
   {
     if (!committed_)
     {
-      try
+      if (member_.get() != NULL)
       {
-        manager_.RollbackTransaction();
+        if (manager_.groupCommitActive_ == member_.get())
+        {
+          // The changes of this transaction cannot be separated from
+          // those of the group: Rollback all of them, and replay the
+          // transactions that are waiting
+          manager_.FlushGroupCommit(false);
+        }
       }
-      catch (Orthanc::OrthancException& e)
+      else
       {
-        // Don't rethrow the exception as we are in a destructor
-        LOG(ERROR) << "Uncatched error during some transaction rollback: " << e.What();
+        try
+        {
+          manager_.RollbackTransaction();
+        }
+        catch (Orthanc::OrthancException& e)
+        {
+          // Don't rethrow the exception as we are in a destructor
+          LOG(ERROR) << "Uncatched error during some transaction rollback: " << e.What();
+        }
       }
     }
   }
@@ -340,11 +783,95 @@ namespace OrthancDatabases
     {
       throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
     }
-    else
+    else if (member_.get() == NULL)
     {
       manager_.CommitTransaction();
       committed_ = true;
     }
+    else
+    {
+      committed_ = true;
+
+      if (manager_.groupCommitActive_ != member_.get())
+      {
+        // The group was closed by an error during this transaction
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+      }
+
+      manager_.groupCommitActive_ = NULL;
+
+      if (member_->IsReadOnly() &&
+          !manager_.groupCommitWaiting_.empty())
+      {
+        // Nothing to be made durable, the group will be committed
+        // by the transactions that are waiting
+        return;
+      }
+
+      manager_.groupCommitWaiting_.push_back(member_.get());
+
+      if (member_->IsReadOnly())
+      {
+        manager_.FlushGroupCommit(true);
+      }
+      else if (manager_.groupCommitWaiting_.size() == 1)
+      {
+        manager_.groupCommitDeadline_ = (boost::posix_time::microsec_clock::universal_time() +
+                                         boost::posix_time::milliseconds(manager_.groupCommitWindow_));
+      }
+
+      while (!member_->IsSettled())
+      {
+        if (boost::posix_time::microsec_clock::universal_time() >= manager_.groupCommitDeadline_)
+        {
+          // Any transaction of the group can commit it, which avoids
+          // waiting for a thread that holds the mutex recursively
+          manager_.FlushGroupCommit(true);
+        }
+        else
+        {
+          // Releases the mutex, so that other transactions can join
+          manager_.groupCommitDone_.timed_wait(lock_, manager_.groupCommitDeadline_);
+        }
+      }
+
+      if (member_->GetStatus() != Orthanc::ErrorCode_Success)
+      {
+        throw Orthanc::OrthancException(member_->GetStatus());
+      }
+    }
+  }
+
+
+  IDatabase& DatabaseManager::Transaction::GetDatabase()
+  {
+    if (member_.get() != NULL)
+    {
+      member_->SetNotReplayable();
+    }
+
+    return database_;
+  }
+
+  
+  DatabaseManager::IdleLock::IdleLock(DatabaseManager& manager) :
+    lock_(manager.mutex_),
+    manager_(manager),
+    idle_(manager.database_.get() != NULL &&
+          manager.transaction_.get() == NULL)
+  {
+  }
+
+
+  IDatabase& DatabaseManager::IdleLock::GetDatabase()
+  {
+    if (!idle_ ||
+        manager_.database_.get() == NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    return *manager_.database_;
   }
 
   
@@ -355,9 +882,11 @@ namespace OrthancDatabases
     lock_(manager_.mutex_),
     database_(manager_.GetDatabase()),
     location_(location),
+    member_(NULL),
     transaction_(manager_.GetTransaction())
   {
     Setup(sql);
+    manager_.activeStatements_++;
   }
 
       
@@ -368,15 +897,65 @@ namespace OrthancDatabases
     lock_(manager_.mutex_),
     database_(manager_.GetDatabase()),
     location_(location),
+    member_(transaction.GetGroupMember()),
     transaction_(manager_.GetTransaction())
   {
     Setup(sql);
+    manager_.activeStatements_++;
+  }
+
+
+  DatabaseManager::CachedStatement::CachedStatement(const StatementLocation& location,
+                                                    DatabaseManager& manager,
+                                                    const IStatementTemplate& statement) :
+    manager_(manager),
+    lock_(manager_.mutex_),
+    database_(manager_.GetDatabase()),
+    location_(location),
+    member_(NULL),
+    transaction_(manager_.GetTransaction())
+  {
+    Setup(statement);
+    manager_.activeStatements_++;
+  }
+
+      
+  DatabaseManager::CachedStatement::CachedStatement(const StatementLocation& location,
+                                                    Transaction& transaction,
+                                                    const IStatementTemplate& statement) :
+    manager_(transaction.GetManager()),
+    lock_(manager_.mutex_),
+    database_(manager_.GetDatabase()),
+    location_(location),
+    member_(transaction.GetGroupMember()),
+    transaction_(manager_.GetTransaction())
+  {
+    Setup(statement);
+    manager_.activeStatements_++;
   }
 
 
   DatabaseManager::CachedStatement::~CachedStatement()
   {
+    // A streamed result must be released before the end of the
+    // implicit transaction, as it still occupies the connection
+    result_.reset(NULL);
     manager_.ReleaseImplicitTransaction();
+
+    assert(manager_.activeStatements_ > 0);
+    manager_.activeStatements_--;
+
+    if (manager_.activeStatements_ == 0)
+    {
+      try
+      {
+        manager_.EvictCachedStatements();
+      }
+      catch (Orthanc::OrthancException&)
+      {
+        // Don't throw exceptions in destructors
+      }
+    }
   }
   
       
@@ -389,6 +968,24 @@ namespace OrthancDatabases
   }
 
 
+  void DatabaseManager::CachedStatement::SetStreaming(bool streaming)
+  {
+    if (query_.get() != NULL)
+    {
+      query_->SetStreaming(streaming);
+    }
+  }
+
+
+  void DatabaseManager::CachedStatement::SetTimeout(unsigned int milliseconds)
+  {
+    if (query_.get() != NULL)
+    {
+      query_->SetTimeout(milliseconds);
+    }
+  }
+
+
   void DatabaseManager::CachedStatement::SetParameterType(const std::string& parameter,
                                                           ValueType type)
   {
@@ -420,12 +1017,51 @@ namespace OrthancDatabases
       {
         // Register the newly-created statement
         assert(statement_ == NULL);
-        statement_ = &manager_.CacheStatement(location_, *query_);
-        query_.reset(NULL);
+        statement_ = &manager_.CacheStatement(location_, query_.release());
       }
         
       assert(statement_ != NULL);
       result_.reset(transaction_.Execute(*statement_, parameters));
+
+      if (member_ != NULL &&
+          !statement_->IsReadOnly())
+      {
+        member_->Record(location_, parameters);
+      }
+    }
+    catch (Orthanc::OrthancException& e)
+    {
+      manager_.CloseIfUnavailable(e.GetErrorCode());
+      throw;
+    }
+  }
+
+
+  void DatabaseManager::CachedStatement::ExecuteWithoutResult(const Dictionary& parameters)
+  {
+    if (result_.get() != NULL)
+    {
+      LOG(ERROR) << "Cannot execute twice a statement";
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    try
+    {
+      if (query_.get() != NULL)
+      {
+        // Register the newly-created statement
+        assert(statement_ == NULL);
+        statement_ = &manager_.CacheStatement(location_, query_.release());
+      }
+        
+      assert(statement_ != NULL);
+      transaction_.ExecuteWithoutResult(*statement_, parameters);
+
+      if (member_ != NULL &&
+          !statement_->IsReadOnly())
+      {
+        member_->Record(location_, parameters);
+      }
     }
     catch (Orthanc::OrthancException& e)
     {
@@ -23,10 +23,15 @@
 
 #include "IDatabaseFactory.h"
 #include "StatementLocation.h"
+#include "StatementTemplate.h"
 
 #include <Core/Enumerations.h>
 
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <list>
+#include <map>
 #include <memory>
 
 namespace OrthancDatabases
@@ -34,35 +39,81 @@ namespace OrthancDatabases
   class DatabaseManager : public boost::noncopyable
   {
   private:
-    typedef std::map<StatementLocation, IPrecompiledStatement*>  CachedStatements;
+    // The most recently used statements are at the front
+    typedef std::list<StatementLocation>  StatementsUsage;
+
+    struct CachedStatementEntry
+    {
+      IPrecompiledStatement*     statement_;
+      Query*                     query_;
+      StatementsUsage::iterator  usage_;
+    };
+
+    typedef std::map<StatementLocation, CachedStatementEntry>  CachedStatements;
+
+    // The queries of the statements that were cached when the
+    // connection was closed, from the most recently used
+    typedef std::list< std::pair<StatementLocation, Query*> >  PendingQueries;
+
+    // State of a "Transaction" that takes part in a group commit
+    class GroupMember;
 
     boost::recursive_mutex           mutex_;
     std::auto_ptr<IDatabaseFactory>  factory_;
     std::auto_ptr<IDatabase>         database_;
     std::auto_ptr<ITransaction>      transaction_;
     CachedStatements                 cachedStatements_;
+    StatementsUsage                  statementsUsage_;
+    PendingQueries                   pendingQueries_;
+    size_t                           maxCachedStatements_;
+    unsigned int                     activeStatements_;
     Dialect                          dialect_;
 
+    // Group commit (cf. "SetGroupCommit()"). While the group is open,
+    // "transaction_" is shared by the "Transaction" objects that are
+    // waiting for their commit, and by the active one (if any).
+    unsigned int                     groupCommitWindow_;
+    bool                             groupCommitOpen_;
+    GroupMember*                     groupCommitActive_;
+    std::list<GroupMember*>          groupCommitWaiting_;
+    boost::posix_time::ptime         groupCommitDeadline_;
+    boost::condition_variable_any    groupCommitDone_;
+    uint64_t                         groupCommitsCount_;
+    uint64_t                         groupedTransactionsCount_;
+
     IDatabase& GetDatabase();
 
     void CloseIfUnavailable(Orthanc::ErrorCode e);
 
-    IPrecompiledStatement* LookupCachedStatement(const StatementLocation& location) const;
+    IPrecompiledStatement* LookupCachedStatement(const StatementLocation& location);
 
     IPrecompiledStatement& CacheStatement(const StatementLocation& location,
-                                          const Query& query);
+                                          Query* query);  // Takes ownership
+
+    void PrepareStatements();
 
     ITransaction& GetTransaction();
 
+    // Commits the database transaction of the open group, if no
+    // transaction of the group is active
+    void CloseGroupCommit();
+
+    // Settles all the transactions that are waiting in the group: If
+    // the database transaction cannot be committed (or if "commit" is
+    // "false"), it is rolled back, and each waiting transaction is
+    // replayed and committed on its own
+    void FlushGroupCommit(bool commit);
+
+    void ReplayGroupMember(GroupMember& member);
+
     void ReleaseImplicitTransaction();
 
+    void EvictCachedStatements();
+
   public:
     explicit DatabaseManager(IDatabaseFactory* factory);  // Takes ownership
     
-    ~DatabaseManager()
-    {
-      Close();
-    }
+    ~DatabaseManager();
 
     Dialect GetDialect() const
     {
@@ -74,6 +125,12 @@ namespace OrthancDatabases
       GetDatabase();
     }
 
+    /**
+     * Closes the connection. The statements that were cached are
+     * prepared again, all at once, when the connection is reopened,
+     * which avoids one round trip per statement on its first use
+     * after a failover.
+     **/
     void Close();
     
     void StartTransaction();
@@ -82,8 +139,43 @@ namespace OrthancDatabases
     
     void RollbackTransaction();
 
-
-    // This class is only used in the "StorageBackend"
+    bool IsTransactionActive();
+
+    /**
+     * Sets the maximum number of statements that are kept prepared on
+     * the connection ("0" means no limit). The least recently used
+     * statements are discarded once no statement is running, which
+     * releases their resources on the server side.
+     **/
+    void SetMaxCachedStatements(size_t count);
+
+    size_t GetCachedStatementsCount();
+
+    /**
+     * Enables group commit for the "Transaction" objects ("0" means
+     * disabled, which is the default). The commit of such a
+     * transaction is delayed by at most "windowMilliseconds", so that
+     * the transactions of the other threads that are committed in
+     * the meantime share the same commit on the database. Each
+     * "Commit()" only returns once its own changes are committed. If
+     * the shared commit fails, the transactions are rolled back, then
+     * replayed and committed one by one.
+     *
+     * Warning: The transactions of a group share the same database
+     * transaction, so each of them can read the changes of the other
+     * members that are not committed yet. The read-only transactions
+     * never join a group for this reason (cf. "Transaction").
+     **/
+    void SetGroupCommit(unsigned int windowMilliseconds);
+
+    // Number of commits of groups, and number of transactions that
+    // were committed by these groups
+    void GetGroupCommitStatistics(uint64_t& commits,
+                                  uint64_t& transactions);
+
+
+    // This class is used in the "StorageBackend", and by the
+    // background tasks of the "IndexBackend"
     class Transaction : public boost::noncopyable
     {
     private:
@@ -91,9 +183,14 @@ namespace OrthancDatabases
       DatabaseManager&                     manager_;
       IDatabase&                           database_;
       bool                                 committed_;
+      std::auto_ptr<GroupMember>           member_;  // NULL if no group commit
 
     public:
-      explicit Transaction(DatabaseManager& manager);
+      // A read-only transaction never joins a group commit: The group
+      // that is open is committed first, so that it only reads
+      // committed changes
+      explicit Transaction(DatabaseManager& manager,
+                           bool readOnly = false);
 
       ~Transaction();
 
@@ -104,13 +201,48 @@ namespace OrthancDatabases
         return manager_;
       }
 
-      IDatabase& GetDatabase()
+      // The commands that are run directly on the database cannot be
+      // replayed if a group commit fails: The transaction then fails
+      IDatabase& GetDatabase();
+
+      // For internal use by "CachedStatement"
+      GroupMember* GetGroupMember()
       {
-        return database_;
+        return member_.get();
       }
     };
 
 
+    /**
+     * Lock to be held by the background tasks (i.e. tasks that are
+     * not triggered by Orthanc) while they run statements. Such
+     * statements must not be interleaved with a transaction that was
+     * started by another thread, and they must not reopen a
+     * connection that was closed.
+     **/
+    class IdleLock : public boost::noncopyable
+    {
+    private:
+      boost::recursive_mutex::scoped_lock  lock_;
+      DatabaseManager&                     manager_;
+      bool                                 idle_;
+
+    public:
+      explicit IdleLock(DatabaseManager& manager);
+
+      // Returns "false" if the background task must be postponed
+      bool IsIdle() const
+      {
+        return idle_;
+      }
+
+      // Gives access to the connection outside of any transaction,
+      // for the commands that cannot be run in a transaction
+      // (e.g. "VACUUM"). Only allowed if the manager is idle.
+      IDatabase& GetDatabase();
+    };
+
+
     class CachedStatement : public boost::noncopyable
     {
     private:
@@ -118,6 +250,7 @@ namespace OrthancDatabases
       boost::recursive_mutex::scoped_lock  lock_;
       IDatabase&                           database_;
       StatementLocation                    location_;
+      GroupMember*                         member_;
       ITransaction&                        transaction_;
       IPrecompiledStatement*               statement_;
       std::auto_ptr<Query>                 query_;
@@ -125,6 +258,8 @@ namespace OrthancDatabases
 
       void Setup(const char* sql);
 
+      void Setup(const IStatementTemplate& statement);
+
       IResult& GetResult() const;
 
     public:
@@ -136,6 +271,15 @@ namespace OrthancDatabases
                       Transaction& transaction,
                       const char* sql);
 
+      // The types of the parameters are those of the template
+      CachedStatement(const StatementLocation& location,
+                      DatabaseManager& manager,
+                      const IStatementTemplate& statement);
+
+      CachedStatement(const StatementLocation& location,
+                      Transaction& transaction,
+                      const IStatementTemplate& statement);
+
       ~CachedStatement();
 
       IDatabase& GetDatabase()
@@ -145,6 +289,12 @@ namespace OrthancDatabases
 
       void SetReadOnly(bool readOnly);
 
+      // Cf. "Query::SetStreaming()"
+      void SetStreaming(bool streaming);
+
+      // Cf. "Query::SetTimeout()"
+      void SetTimeout(unsigned int milliseconds);
+
       void SetParameterType(const std::string& parameter,
                             ValueType type);
       
@@ -152,6 +302,10 @@ namespace OrthancDatabases
 
       void Execute(const Dictionary& parameters);
 
+      // For the statements whose result is not read, which allows
+      // the backend to defer their execution (pipeline mode)
+      void ExecuteWithoutResult(const Dictionary& parameters);
+
       bool IsDone() const;
       
       void Next();
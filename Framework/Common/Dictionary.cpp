@@ -31,6 +31,7 @@
 #include <Core/OrthancException.h>
 
 #include <cassert>
+#include <memory>
 
 namespace OrthancDatabases
 {
@@ -116,6 +117,16 @@ namespace OrthancDatabases
   }
 
   
+  void Dictionary::SetFileReference(const std::string& key,
+                                    const void* content,
+                                    size_t size)
+  {
+    std::auto_ptr<FileValue> value(new FileValue);
+    value->SetReference(content, size);
+    SetValue(key, value.release());
+  }
+
+  
   void Dictionary::SetIntegerValue(const std::string& key,
                                    int64_t value)
   {
@@ -144,4 +155,54 @@ namespace OrthancDatabases
       return *found->second;
     }
   }
+
+
+  static IValue* CloneValue(const IValue& value)
+  {
+    switch (value.GetType())
+    {
+      case ValueType_BinaryString:
+        return new BinaryStringValue(dynamic_cast<const BinaryStringValue&>(value).GetContent());
+
+      case ValueType_File:
+      {
+        const FileValue& file = dynamic_cast<const FileValue&>(value);
+
+        std::auto_ptr<FileValue> copy(new FileValue);
+        if (file.IsReference())
+        {
+          copy->SetReference(file.GetBuffer(), file.GetSize());
+        }
+        else
+        {
+          copy->SetContent(file.GetContent());
+        }
+
+        return copy.release();
+      }
+
+      case ValueType_Integer64:
+        return new Integer64Value(dynamic_cast<const Integer64Value&>(value).GetValue());
+
+      case ValueType_Null:
+        return new NullValue;
+
+      case ValueType_Utf8String:
+        return new Utf8StringValue(dynamic_cast<const Utf8StringValue&>(value).GetContent());
+
+      default:
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_NotImplemented);
+    }
+  }
+
+
+  void Dictionary::Copy(Dictionary& target) const
+  {
+    for (Values::const_iterator it = values_.begin(); 
+         it != values_.end(); ++it)
+    {
+      assert(it->second != NULL);
+      target.SetValue(it->first, CloneValue(*it->second));
+    }
+  }
 }
@@ -58,11 +58,21 @@ namespace OrthancDatabases
                       const void* content,
                       size_t size);
 
+    // The content is not copied: It must remain valid until the
+    // statement has been executed (cf. "FileValue::SetReference()")
+    void SetFileReference(const std::string& key,
+                          const void* content,
+                          size_t size);
+
     void SetIntegerValue(const std::string& key,
                          int64_t value);
 
     void SetNullValue(const std::string& key);
 
     const IValue& GetValue(const std::string& key) const;
+
+    // Copies all the values into "target". The buffers of the file
+    // references are not copied, they are borrowed again.
+    void Copy(Dictionary& target) const;
   };
 }
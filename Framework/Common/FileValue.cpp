@@ -30,12 +30,85 @@
 
 namespace OrthancDatabases
 {
+  void FileValue::SetReference(const void* buffer,
+                               size_t size)
+  {
+    content_.clear();
+
+    if (size == 0)
+    {
+      reference_ = NULL;
+      referenceSize_ = 0;
+    }
+    else if (buffer == NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_NullPointer);
+    }
+    else
+    {
+      reference_ = buffer;
+      referenceSize_ = size;
+    }
+  }
+
+
+  void FileValue::SwapContent(std::string& content)
+  {
+    if (reference_ != NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    content_.swap(content);
+  }
+
+
+  void FileValue::SetContent(const std::string& content)
+  {
+    reference_ = NULL;
+    referenceSize_ = 0;
+    content_ = content;
+  }
+
+
+  std::string& FileValue::GetContent()
+  {
+    if (reference_ != NULL)
+    {
+      // Cannot be modified in place, use "GetBuffer()" and "GetSize()"
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    return content_;
+  }
+
+
+  const std::string& FileValue::GetContent() const
+  {
+    if (reference_ != NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    return content_;
+  }
+
+
   IValue* FileValue::Convert(ValueType target) const
   {
     switch (target)
     {
       case ValueType_BinaryString:
-        return new BinaryStringValue(content_);
+      {
+        std::string content;
+
+        if (GetSize() > 0)
+        {
+          content.assign(reinterpret_cast<const char*>(GetBuffer()), GetSize());
+        }
+
+        return new BinaryStringValue(content);
+      }
 
       case ValueType_Null:
         return new NullValue;
@@ -47,6 +120,6 @@ namespace OrthancDatabases
 
   std::string FileValue::Format() const
   {
-    return "(file - " + boost::lexical_cast<std::string>(content_.size()) + " bytes)";
+    return "(file - " + boost::lexical_cast<std::string>(GetSize()) + " bytes)";
   }
 }
@@ -29,51 +29,64 @@ namespace OrthancDatabases
   {
   private:
     std::string  content_;
+    const void*  reference_;       // Borrowed buffer, NULL if the content is owned
+    size_t       referenceSize_;
 
   public:
-    FileValue()
+    FileValue() :
+      reference_(NULL),
+      referenceSize_(0)
     {
     }
 
     explicit FileValue(const std::string& content) :
-      content_(content)
+      content_(content),
+      reference_(NULL),
+      referenceSize_(0)
     {
     }
 
     FileValue(const void* buffer,
-              size_t size)
+              size_t size) :
+      reference_(NULL),
+      referenceSize_(0)
     {
       content_.assign(reinterpret_cast<const char*>(buffer), size);
     }
-    
-    void SwapContent(std::string& content)
-    {
-      content_.swap(content);
-    }
 
-    void SetContent(const std::string& content)
-    {
-      content_ = content;
-    }
+    // The buffer is not copied: It must remain valid until the
+    // statement using this value has been executed
+    void SetReference(const void* buffer,
+                      size_t size);
 
-    std::string& GetContent()
+    bool IsReference() const
     {
-      return content_;
+      return reference_ != NULL;
     }
+    
+    void SwapContent(std::string& content);
 
-    const std::string& GetContent() const
-    {
-      return content_;
-    }
+    void SetContent(const std::string& content);
+
+    std::string& GetContent();
+
+    const std::string& GetContent() const;
 
     const void* GetBuffer() const
     {
-      return (content_.empty() ? NULL : content_.c_str());
+      if (reference_ != NULL)
+      {
+        return reference_;
+      }
+      else
+      {
+        return (content_.empty() ? NULL : content_.c_str());
+      }
     }
 
     size_t GetSize() const
     {
-      return content_.size();
+      return (reference_ != NULL ? referenceSize_ : content_.size());
     }
 
     virtual ValueType GetType() const
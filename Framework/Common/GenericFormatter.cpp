@@ -96,4 +96,5 @@ namespace OrthancDatabases
       return parametersType_[index];
     }
   }
+
 }
@@ -25,6 +25,8 @@
 #include "ITransaction.h"
 #include "Query.h"
 
+#include <vector>
+
 namespace OrthancDatabases
 {
   class IDatabase : public boost::noncopyable
@@ -38,6 +40,12 @@ namespace OrthancDatabases
 
     virtual IPrecompiledStatement* Compile(const Query& query) = 0;
 
+    // Prepares on the server side, with as few round trips as
+    // possible, statements that were compiled by this database and
+    // that are not prepared yet. This is only an optimization: Errors
+    // are to be reported on the first execution of the statements.
+    virtual void Prepare(const std::vector<IPrecompiledStatement*>& statements) = 0;
+
     virtual ITransaction* CreateTransaction(bool isImplicit) = 0;
   };
 }
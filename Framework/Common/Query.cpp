@@ -89,7 +89,9 @@ namespace OrthancDatabases
 
 
   Query::Query(const std::string& sql) :
-    readOnly_(false)
+    readOnly_(false),
+    streaming_(false),
+    timeout_(0)
   {
     Setup(sql);
   }
@@ -97,7 +99,9 @@ namespace OrthancDatabases
 
   Query::Query(const std::string& sql,
                bool readOnly) :
-    readOnly_(readOnly)
+    readOnly_(readOnly),
+    streaming_(false),
+    timeout_(0)
   {
     Setup(sql);
   }
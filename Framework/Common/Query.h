@@ -54,6 +54,8 @@ namespace OrthancDatabases
     std::vector<Token*>  tokens_;
     Parameters           parameters_;
     bool                 readOnly_;
+    bool                 streaming_;
+    unsigned int         timeout_;
 
     void Setup(const std::string& sql);
 
@@ -75,8 +77,47 @@ namespace OrthancDatabases
       readOnly_ = isReadOnly;
     }
 
+    bool IsStreaming() const
+    {
+      return streaming_;
+    }
+
+    /**
+     * Hint that the rows of the result should be fetched one by one
+     * from the server, instead of being buffered all at once in the
+     * memory of the plugin. The result must be entirely read before
+     * another statement is executed on the same connection, and no
+     * large object can be read from it.
+     **/
+    void SetStreaming(bool isStreaming)
+    {
+      streaming_ = isStreaming;
+    }
+
+    unsigned int GetTimeout() const
+    {
+      return timeout_;
+    }
+
+    /**
+     * Maximum execution time of the statement on the server, in
+     * milliseconds ("0" means the default of the server). Once
+     * exceeded, the statement is cancelled by the server, and
+     * "ErrorCode_Timeout" is raised. Ignored by SQLite.
+     **/
+    void SetTimeout(unsigned int milliseconds)
+    {
+      timeout_ = milliseconds;
+    }
+
     bool HasParameter(const std::string& parameter) const;
 
+    // Number of distinct parameters, including "${}" if present
+    size_t GetParametersCount() const
+    {
+      return parameters_.size();
+    }
+
     ValueType GetType(const std::string& parameter) const;
 
     void SetType(const std::string& parameter,
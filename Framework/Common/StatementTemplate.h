@@ -0,0 +1,145 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include "Dictionary.h"
+
+#include <Core/OrthancException.h>
+
+#include <boost/static_assert.hpp>
+
+namespace OrthancDatabases
+{
+  struct StatementParameter
+  {
+    const char*  name_;    // NULL at the end of the list
+    ValueType    type_;
+  };
+
+
+  class IStatementTemplate : public boost::noncopyable
+  {
+  public:
+    virtual ~IStatementTemplate()
+    {
+    }
+
+    virtual const char* GetSql(Dialect dialect) const = 0;
+
+    virtual size_t GetParametersCount() const = 0;
+
+    virtual const StatementParameter& GetParameter(size_t index) const = 0;
+  };
+
+
+  /**
+   * Statement whose SQL is written for each dialect, and whose
+   * parameters are declared once, together with their type. The
+   * "Definition" structure must provide:
+   *
+   *  - "enum Parameter", the last value being "Parameter_Count",
+   *  - "static const StatementParameter PARAMETERS[]", in the order
+   *    of "Parameter", terminated by "{ NULL, ValueType_Null }",
+   *  - "static const char* const SQL_MYSQL", "SQL_POSTGRESQL" and
+   *    "SQL_SQLITE", that use the "${...}" syntax for the parameters.
+   *
+   * A missing dialect or a wrong number of parameters breaks the
+   * build, and so does a misspelled parameter in the C++ code, as the
+   * arguments are indexed by "Parameter". The SQL text is checked
+   * against the declared parameters when the statement is first
+   * compiled (cf. "DatabaseManager::CachedStatement").
+   **/
+  template <typename Definition>
+  class StatementTemplate : public IStatementTemplate
+  {
+  private:
+    const char*  sql_[3];  // Indexed by "Dialect"
+
+  public:
+    typedef typename Definition::Parameter  Parameter;
+
+    StatementTemplate()
+    {
+      BOOST_STATIC_ASSERT(sizeof(Definition::PARAMETERS) ==
+                          (Definition::Parameter_Count + 1) * sizeof(StatementParameter));
+
+      sql_[Dialect_MySQL] = Definition::SQL_MYSQL;
+      sql_[Dialect_PostgreSQL] = Definition::SQL_POSTGRESQL;
+      sql_[Dialect_SQLite] = Definition::SQL_SQLITE;
+    }
+
+    virtual const char* GetSql(Dialect dialect) const
+    {
+      if (static_cast<size_t>(dialect) >= sizeof(sql_) / sizeof(sql_[0]))
+      {
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_NotImplemented);
+      }
+
+      return sql_[dialect];
+    }
+
+    virtual size_t GetParametersCount() const
+    {
+      return Definition::Parameter_Count;
+    }
+
+    virtual const StatementParameter& GetParameter(size_t index) const
+    {
+      if (index >= static_cast<size_t>(Definition::Parameter_Count))
+      {
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+      }
+
+      return Definition::PARAMETERS[index];
+    }
+
+
+    class Arguments : public boost::noncopyable
+    {
+    private:
+      Dictionary  dictionary_;
+
+    public:
+      void SetInteger(Parameter parameter,
+                      int64_t value)
+      {
+        dictionary_.SetIntegerValue(Definition::PARAMETERS[parameter].name_, value);
+      }
+
+      void SetUtf8(Parameter parameter,
+                   const std::string& utf8)
+      {
+        dictionary_.SetUtf8Value(Definition::PARAMETERS[parameter].name_, utf8);
+      }
+
+      void SetNull(Parameter parameter)
+      {
+        dictionary_.SetNullValue(Definition::PARAMETERS[parameter].name_);
+      }
+
+      const Dictionary& GetDictionary() const
+      {
+        return dictionary_;
+      }
+    };
+  };
+}
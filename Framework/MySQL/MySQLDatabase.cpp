@@ -66,6 +66,11 @@ namespace OrthancDatabases
       {
         throw Orthanc::OrthancException(Orthanc::ErrorCode_DatabaseUnavailable);
       }
+      else if (IsTimeoutError(error))
+      {
+        // The connection is still usable
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_Timeout);
+      }
       else
       {
         throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
@@ -74,6 +79,15 @@ namespace OrthancDatabases
   }
 
 
+  bool MySQLDatabase::IsTimeoutError(unsigned int error)
+  {
+    // The numeric values are used, as these errors are not defined
+    // by the headers of older client libraries
+    return (error == 3024 /* ER_QUERY_TIMEOUT, MySQL >= 5.7.8 */ ||
+            error == 1969 /* ER_STATEMENT_TIMEOUT, MariaDB >= 10.1 */);
+  }
+
+
   MySQLDatabase::MySQLDatabase(const MySQLParameters& parameters) :
     parameters_(parameters),
     mysql_(NULL)
@@ -410,6 +424,15 @@ namespace OrthancDatabases
       
         LOG(TRACE) << "MySQL: " << s;
         CheckErrorCode(mysql_query(mysql_, s.c_str()));
+
+        // Discard the result set of the administrative commands
+        // (e.g. "ANALYZE TABLE"), that would otherwise prevent the
+        // next command from running
+        MYSQL_RES* result = mysql_store_result(mysql_);
+        if (result != NULL)
+        {
+          mysql_free_result(result);
+        }
       }
     }
   }
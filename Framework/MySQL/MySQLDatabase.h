@@ -53,6 +53,10 @@ namespace OrthancDatabases
 
     void CheckErrorCode(int code);
 
+    // Whether the error corresponds to a statement that was cancelled
+    // by the server, because it exceeded its maximum execution time
+    static bool IsTimeoutError(unsigned int error);
+
     MYSQL* GetObject();
 
     void Open();
@@ -88,6 +92,11 @@ namespace OrthancDatabases
 
     virtual IPrecompiledStatement* Compile(const Query& query);
 
+    virtual void Prepare(const std::vector<IPrecompiledStatement*>& statements)
+    {
+      // The statements are prepared by "Compile()"
+    }
+
     virtual ITransaction* CreateTransaction(bool isImplicit);
 
     static void GlobalFinalization();
@@ -50,6 +50,11 @@ namespace OrthancDatabases
         database_.LogError();
         throw Orthanc::OrthancException(Orthanc::ErrorCode_DatabaseUnavailable);
       }
+      else if (MySQLDatabase::IsTimeoutError(error))
+      {
+        database_.LogError();
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_Timeout);
+      }
       else
       {
         database_.LogError();
@@ -30,12 +30,24 @@
 
 #include <Core/Logging.h>
 #include <Core/OrthancException.h>
+#include <Core/Toolbox.h>
 
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
 #include <list>
 #include <memory>
 
 namespace OrthancDatabases
 {
+  // Size of the buffer that is bound to the string columns: Larger
+  // values are truncated by "mysql_stmt_fetch()", and are then read
+  // separately with "mysql_stmt_fetch_column()"
+  static const unsigned long MAX_INLINE_STRING = 256;
+
+  // Number of rows that are fetched at once from a cursor
+  static const unsigned long STREAMING_PREFETCH_ROWS = 1000;
+
+
   class MySQLStatement::ResultField : public boost::noncopyable
   {
   private:     
@@ -165,10 +177,9 @@ namespace OrthancDatabases
               throw Orthanc::OrthancException(Orthanc::ErrorCode_NotImplemented);                
           }
 
-          if (field.max_length > 0)
-          {
-            buffer_.resize(field.max_length);
-          }
+          // "field.max_length" is only available once the whole
+          // result has been stored: Use the declared length instead
+          buffer_.resize(std::min(field.length, MAX_INLINE_STRING));
 
           break;
           
@@ -220,16 +231,17 @@ namespace OrthancDatabases
                        MYSQL_BIND& bind,
                        unsigned int column) const
     {
-      if (isError_)
-      {
-        throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
-      }
-      else if (isNull_)
+      if (isNull_)
       {
         return new NullValue;
       }
       else if (orthancType_ == ValueType_Integer64)
       {
+        if (isError_)
+        {
+          throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+        }
+
         return CreateIntegerValue(bind);
       }
       else if (orthancType_ == ValueType_Utf8String ||
@@ -240,20 +252,19 @@ namespace OrthancDatabases
 
         if (!tmp.empty())
         {
-          if (buffer_.empty())
-          {
-            bind.buffer = &tmp[0];
-            bind.buffer_length = tmp.size();
-
-            database.CheckErrorCode(mysql_stmt_fetch_column(&statement, &bind, column, 0));
-          }
-          else if (tmp.size() <= buffer_.size())
+          if (tmp.size() <= buffer_.size())
           {
             memcpy(&tmp[0], &buffer_[0], length_);
           }
           else
           {
-            throw Orthanc::OrthancException(Orthanc::ErrorCode_InternalError);
+            // The value was truncated (which is reported in
+            // "isError_"), or no buffer was bound to this column
+            MYSQL_BIND full = bind;
+            full.buffer = &tmp[0];
+            full.buffer_length = tmp.size();
+
+            database.CheckErrorCode(mysql_stmt_fetch_column(&statement, &full, column, 0));
           }
         }
 
@@ -341,12 +352,25 @@ namespace OrthancDatabases
                                  const Query& query) :
     db_(db),
     readOnly_(query.IsReadOnly()),
+    streaming_(query.IsReadOnly() && query.IsStreaming()),
     statement_(NULL),
     formatter_(Dialect_MySQL)
   {
     std::string sql;
     query.Format(sql, formatter_);
 
+    std::string command = sql.substr(0, 6);
+    Orthanc::Toolbox::ToUpperCase(command);
+
+    if (query.GetTimeout() != 0 &&
+        command == "SELECT")
+    {
+      // Optimizer hint of MySQL >= 5.7.8, that only applies to
+      // "SELECT" (MariaDB ignores it, as it is a comment)
+      sql.insert(6, " /*+ MAX_EXECUTION_TIME(" +
+                 boost::lexical_cast<std::string>(query.GetTimeout()) + ") */");
+    }
+
     statement_ = mysql_stmt_init(db.GetObject());
     if (statement_ == NULL)
     {
@@ -393,6 +417,14 @@ namespace OrthancDatabases
       unsigned long type = (unsigned long) CURSOR_TYPE_READ_ONLY;
       mysql_stmt_attr_set(statement_, STMT_ATTR_CURSOR_TYPE, (void*) &type);
     }
+
+    if (streaming_)
+    {
+      // The rows are fetched by batches from the server-side cursor,
+      // instead of being all stored in the client
+      unsigned long rows = STREAMING_PREFETCH_ROWS;
+      mysql_stmt_attr_set(statement_, STMT_ATTR_PREFETCH_ROWS, (void*) &rows);
+    }
   }
 
 
@@ -495,9 +527,12 @@ namespace OrthancDatabases
 
         case ValueType_File:
         {
-          const std::string& content = dynamic_cast<const FileValue&>(value).GetContent();
-          inputs[i].buffer = const_cast<char*>(content.c_str());
-          inputs[i].buffer_length = content.size();
+          // The content of the file is not copied, as it might be
+          // borrowed from the caller (cf. "FileValue::SetReference()")
+          const FileValue& content = dynamic_cast<const FileValue&>(value);
+          inputs[i].buffer = (content.GetSize() == 0 ? const_cast<char*>("") :
+                              const_cast<void*>(content.GetBuffer()));
+          inputs[i].buffer_length = content.GetSize();
           inputs[i].buffer_type = MYSQL_TYPE_BLOB;
           break;
         }
@@ -532,7 +567,11 @@ namespace OrthancDatabases
     if (!outputs_.empty())
     {
       db_.CheckErrorCode(mysql_stmt_bind_result(statement_, &outputs_[0]));
-      db_.CheckErrorCode(mysql_stmt_store_result(statement_));
+
+      if (!streaming_)
+      {
+        db_.CheckErrorCode(mysql_stmt_store_result(statement_));
+      }
     }
 
     return new MySQLResult(db_, *this);
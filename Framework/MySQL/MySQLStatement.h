@@ -40,6 +40,7 @@ namespace OrthancDatabases
 
     MySQLDatabase&             db_;
     bool                       readOnly_;
+    bool                       streaming_;
     MYSQL_STMT                *statement_;
     GenericFormatter           formatter_;
     std::vector<ResultField*>  result_;
@@ -0,0 +1,282 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "ChangesFeed.h"
+
+#include <Core/Logging.h>
+#include <Core/OrthancException.h>
+
+#include <boost/lexical_cast.hpp>
+#include <json/reader.h>
+
+namespace OrthancDatabases
+{
+  static ChangesFeed* registeredFeed_ = NULL;
+
+
+  static OrthancPluginErrorCode ServeChangesFeed(OrthancPluginRestOutput* output,
+                                                 const char* url,
+                                                 const OrthancPluginHttpRequest* request)
+  {
+    try
+    {
+      if (registeredFeed_ == NULL)
+      {
+        return OrthancPluginErrorCode_BadSequenceOfCalls;
+      }
+
+      registeredFeed_->Answer(output, request);
+      return OrthancPluginErrorCode_Success;
+    }
+    catch (Orthanc::OrthancException& e)
+    {
+      return static_cast<OrthancPluginErrorCode>(e.GetErrorCode());
+    }
+    catch (...)
+    {
+      return OrthancPluginErrorCode_Plugin;
+    }
+  }
+
+
+  static uint64_t ParseArgument(const OrthancPluginHttpRequest* request,
+                                const std::string& key,
+                                uint64_t defaultValue)
+  {
+    for (uint32_t i = 0; i < request->getCount; i++)
+    {
+      if (key == request->getKeys[i])
+      {
+        try
+        {
+          return boost::lexical_cast<uint64_t>(request->getValues[i]);
+        }
+        catch (boost::bad_lexical_cast&)
+        {
+          LOG(ERROR) << "Bad value for argument \"" << key << "\": " << request->getValues[i];
+          throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+        }
+      }
+    }
+
+    return defaultValue;
+  }
+
+
+  uint64_t ChangesFeed::GetGeneration()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return generation_;
+  }
+
+
+  bool ChangesFeed::WaitSignal(uint64_t generation,
+                               const boost::system_time& deadline)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (maxWaiters_ != 0 &&
+        waiters_ >= maxWaiters_)
+    {
+      // Too many blocked requests, answer this one immediately
+      // instead of holding one more HTTP thread of Orthanc
+      return false;
+    }
+
+    waiters_++;
+
+    bool signalled = true;
+    while (!stopped_ &&
+           generation_ == generation)
+    {
+      if (!condition_.timed_wait(lock, deadline))
+      {
+        signalled = false;  // Timeout
+        break;
+      }
+    }
+
+    waiters_--;
+
+    return (signalled && !stopped_);
+  }
+
+
+  ChangesFeed::ChangesFeed(OrthancPluginContext* context) :
+    context_(context),
+    generation_(0),
+    stopped_(false),
+    maxTimeout_(60),
+    maxWaiters_(10),
+    waiters_(0)
+  {
+    if (context == NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_NullPointer);
+    }
+  }
+
+
+  ChangesFeed::~ChangesFeed()
+  {
+    Stop();
+
+    if (registeredFeed_ == this)
+    {
+      registeredFeed_ = NULL;
+    }
+  }
+
+
+  void ChangesFeed::SetMaxTimeout(unsigned int seconds)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    maxTimeout_ = seconds;
+  }
+
+
+  void ChangesFeed::SetMaxWaiters(unsigned int count)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    maxWaiters_ = count;
+  }
+
+
+  void ChangesFeed::ReadConfiguration(const OrthancPlugins::OrthancConfiguration& configuration)
+  {
+    unsigned int value;
+
+    if (configuration.LookupUnsignedIntegerValue(value, "ChangesFeedMaxWaiters"))
+    {
+      SetMaxWaiters(value);
+    }
+  }
+
+
+  void ChangesFeed::Signal()
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      generation_++;
+    }
+
+    condition_.notify_all();
+  }
+
+
+  void ChangesFeed::Stop()
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      stopped_ = true;
+    }
+
+    condition_.notify_all();
+  }
+
+
+  void ChangesFeed::Register(const std::string& uri)
+  {
+    if (registeredFeed_ != NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    registeredFeed_ = this;
+
+    // The "NoLock" flavor is mandatory, otherwise one blocked request
+    // would block all the REST callbacks of the plugin
+    OrthancPluginRegisterRestCallbackNoLock(context_, uri.c_str(), ServeChangesFeed);
+  }
+
+
+  void ChangesFeed::Answer(OrthancPluginRestOutput* output,
+                           const OrthancPluginHttpRequest* request)
+  {
+    if (request->method != OrthancPluginHttpMethod_Get)
+    {
+      OrthancPluginSendMethodNotAllowed(context_, output, "GET");
+      return;
+    }
+
+    const uint64_t since = ParseArgument(request, "since", 0);
+    const uint64_t limit = ParseArgument(request, "limit", 100);
+    uint64_t timeout = ParseArgument(request, "timeout", 30);
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (timeout > maxTimeout_)
+      {
+        timeout = maxTimeout_;
+      }
+    }
+
+    const boost::system_time deadline = (boost::get_system_time() +
+                                         boost::posix_time::seconds(static_cast<long>(timeout)));
+
+    const std::string uri = ("/changes?since=" + boost::lexical_cast<std::string>(since) +
+                             "&limit=" + boost::lexical_cast<std::string>(limit));
+
+    for (;;)
+    {
+      // The generation must be read before the changes, otherwise a
+      // change committed in between would be missed until the timeout
+      const uint64_t generation = GetGeneration();
+
+      OrthancPluginMemoryBuffer changes;
+      OrthancPluginErrorCode code = OrthancPluginRestApiGet(context_, &changes, uri.c_str());
+      if (code != OrthancPluginErrorCode_Success)
+      {
+        throw Orthanc::OrthancException(static_cast<Orthanc::ErrorCode>(code));
+      }
+
+      bool isEmpty;
+
+      {
+        const char* data = reinterpret_cast<const char*>(changes.data);
+
+        Json::Value json;
+        Json::Reader reader;
+        if (!reader.parse(data, data + changes.size, json) ||
+            json.type() != Json::objectValue ||
+            !json.isMember("Changes") ||
+            json["Changes"].type() != Json::arrayValue)
+        {
+          OrthancPluginFreeMemoryBuffer(context_, &changes);
+          throw Orthanc::OrthancException(Orthanc::ErrorCode_InternalError);
+        }
+
+        isEmpty = (json["Changes"].size() == 0);
+      }
+
+      if (!isEmpty ||
+          !WaitSignal(generation, deadline))
+      {
+        OrthancPluginAnswerBuffer(context_, output, reinterpret_cast<const char*>(changes.data),
+                                  changes.size, "application/json");
+        OrthancPluginFreeMemoryBuffer(context_, &changes);
+        return;
+      }
+
+      OrthancPluginFreeMemoryBuffer(context_, &changes);
+    }
+  }
+}
@@ -0,0 +1,89 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include <orthanc/OrthancCPlugin.h>
+#include <Plugins/Samples/Common/OrthancPluginCppWrapper.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <string>
+
+namespace OrthancDatabases
+{
+  /**
+   * Long polling on the log of changes. The REST route registered by
+   * this class answers "GET {uri}?since=...&limit=...&timeout=..."
+   * with the same content as the "/changes" route of Orthanc, but if
+   * no change is available after "since", the request is blocked
+   * until some change is committed or until "timeout" seconds have
+   * elapsed. The feed must be signalled whenever new changes have
+   * been committed to the database. At most "maxWaiters" requests
+   * are blocked at once, the other ones are answered immediately.
+   **/
+  class ChangesFeed : public boost::noncopyable
+  {
+  private:
+    OrthancPluginContext*      context_;
+    boost::mutex               mutex_;
+    boost::condition_variable  condition_;
+    uint64_t                   generation_;
+    bool                       stopped_;
+    unsigned int               maxTimeout_;
+    unsigned int               maxWaiters_;
+    unsigned int               waiters_;
+
+    uint64_t GetGeneration();
+
+    bool WaitSignal(uint64_t generation,
+                    const boost::system_time& deadline);
+
+  public:
+    explicit ChangesFeed(OrthancPluginContext* context);
+
+    ~ChangesFeed();
+
+    // Upper bound on the "timeout" argument, in seconds. Each
+    // blocked request holds one of the HTTP threads of Orthanc.
+    void SetMaxTimeout(unsigned int seconds);
+
+    // Upper bound on the number of requests that are blocked at
+    // once, so that the feed never holds more than this number of
+    // HTTP threads ("0" means no limit)
+    void SetMaxWaiters(unsigned int count);
+
+    void ReadConfiguration(const OrthancPlugins::OrthancConfiguration& configuration);
+
+    // Can be invoked from any thread
+    void Signal();
+
+    // Wakes up all the blocked requests
+    void Stop();
+
+    // Only one feed can be registered by a plugin
+    void Register(const std::string& uri);
+
+    void Answer(OrthancPluginRestOutput* output,
+                const OrthancPluginHttpRequest* request);
+  };
+}
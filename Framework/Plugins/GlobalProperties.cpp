@@ -30,6 +30,44 @@
 
 namespace OrthancDatabases
 {
+  // Inserts or overwrites one global property in a single statement
+  // (the "ON CONFLICT" clause requires PostgreSQL >= 9.5)
+  struct SetGlobalPropertyDefinition
+  {
+    enum Parameter
+    {
+      Parameter_Property,
+      Parameter_Value,
+      Parameter_Count
+    };
+
+    static const StatementParameter  PARAMETERS[];
+    static const char* const         SQL_MYSQL;
+    static const char* const         SQL_POSTGRESQL;
+    static const char* const         SQL_SQLITE;
+  };
+
+  const StatementParameter SetGlobalPropertyDefinition::PARAMETERS[] =
+  {
+    { "property", ValueType_Integer64 },
+    { "value", ValueType_Utf8String },
+    { NULL, ValueType_Null }
+  };
+
+  const char* const SetGlobalPropertyDefinition::SQL_MYSQL =
+    "INSERT INTO GlobalProperties VALUES (${property}, ${value}) "
+    "ON DUPLICATE KEY UPDATE value=VALUES(value)";
+
+  const char* const SetGlobalPropertyDefinition::SQL_POSTGRESQL =
+    "INSERT INTO GlobalProperties VALUES (${property}, ${value}) "
+    "ON CONFLICT (property) DO UPDATE SET value=EXCLUDED.value";
+
+  const char* const SetGlobalPropertyDefinition::SQL_SQLITE =
+    "INSERT OR REPLACE INTO GlobalProperties VALUES (${property}, ${value})";
+
+  static const StatementTemplate<SetGlobalPropertyDefinition>  SET_GLOBAL_PROPERTY;
+
+
   bool LookupGlobalProperty(std::string& target,
                             IDatabase& db,
                             ITransaction& transaction,
@@ -115,48 +153,17 @@ namespace OrthancDatabases
                          Orthanc::GlobalProperty property,
                          const std::string& utf8)
   {
-    if (db.GetDialect() == Dialect_SQLite)
-    {
-      Query query("INSERT OR REPLACE INTO GlobalProperties VALUES (${property}, ${value})", false);
-      query.SetType("property", ValueType_Integer64);
-      query.SetType("value", ValueType_Utf8String);
-      
-      std::auto_ptr<IPrecompiledStatement> statement(db.Compile(query));
-
-      Dictionary args;
-      args.SetIntegerValue("property", static_cast<int>(property));
-      args.SetUtf8Value("value", utf8);
-        
-      transaction.ExecuteWithoutResult(*statement, args);
-    }
-    else
-    {
-      {
-        Query query("DELETE FROM GlobalProperties WHERE property=${property}", false);
-        query.SetType("property", ValueType_Integer64);
-      
-        std::auto_ptr<IPrecompiledStatement> statement(db.Compile(query));
-
-        Dictionary args;
-        args.SetIntegerValue("property", static_cast<int>(property));
-        
-        transaction.ExecuteWithoutResult(*statement, args);
-      }
-
-      {
-        Query query("INSERT INTO GlobalProperties VALUES (${property}, ${value})", false);
-        query.SetType("property", ValueType_Integer64);
-        query.SetType("value", ValueType_Utf8String);
+    Query query(SET_GLOBAL_PROPERTY.GetSql(db.GetDialect()), false);
+    query.SetType("property", ValueType_Integer64);
+    query.SetType("value", ValueType_Utf8String);
       
-        std::auto_ptr<IPrecompiledStatement> statement(db.Compile(query));
+    std::auto_ptr<IPrecompiledStatement> statement(db.Compile(query));
 
-        Dictionary args;
-        args.SetIntegerValue("property", static_cast<int>(property));
-        args.SetUtf8Value("value", utf8);
+    StatementTemplate<SetGlobalPropertyDefinition>::Arguments args;
+    args.SetInteger(SetGlobalPropertyDefinition::Parameter_Property, static_cast<int>(property));
+    args.SetUtf8(SetGlobalPropertyDefinition::Parameter_Value, utf8);
         
-        transaction.ExecuteWithoutResult(*statement, args);
-      }
-    }
+    transaction.ExecuteWithoutResult(*statement, args.GetDictionary());
   }
 
 
@@ -164,51 +171,14 @@ namespace OrthancDatabases
                          Orthanc::GlobalProperty property,
                          const std::string& utf8)
   {
-    if (manager.GetDialect() == Dialect_SQLite)
-    {
-      DatabaseManager::CachedStatement statement(
-        STATEMENT_FROM_HERE, manager,
-        "INSERT OR REPLACE INTO GlobalProperties VALUES (${property}, ${value})");
-        
-      statement.SetParameterType("property", ValueType_Integer64);
-      statement.SetParameterType("value", ValueType_Utf8String);
-        
-      Dictionary args;
-      args.SetIntegerValue("property", static_cast<int>(property));
-      args.SetUtf8Value("value", utf8);
-        
-      statement.Execute(args);
-    }
-    else
-    {
-      {
-        DatabaseManager::CachedStatement statement(
-          STATEMENT_FROM_HERE, manager,
-          "DELETE FROM GlobalProperties WHERE property=${property}");
-        
-        statement.SetParameterType("property", ValueType_Integer64);
-        
-        Dictionary args;
-        args.SetIntegerValue("property", property);
-        
-        statement.Execute(args);
-      }
-
-      {
-        DatabaseManager::CachedStatement statement(
-          STATEMENT_FROM_HERE, manager,
-          "INSERT INTO GlobalProperties VALUES (${property}, ${value})");
-        
-        statement.SetParameterType("property", ValueType_Integer64);
-        statement.SetParameterType("value", ValueType_Utf8String);
+    DatabaseManager::CachedStatement statement(
+      STATEMENT_FROM_HERE, manager, SET_GLOBAL_PROPERTY);
         
-        Dictionary args;
-        args.SetIntegerValue("property", static_cast<int>(property));
-        args.SetUtf8Value("value", utf8);
+    StatementTemplate<SetGlobalPropertyDefinition>::Arguments args;
+    args.SetInteger(SetGlobalPropertyDefinition::Parameter_Property, static_cast<int>(property));
+    args.SetUtf8(SetGlobalPropertyDefinition::Parameter_Value, utf8);
         
-        statement.Execute(args);
-      }
-    }
+    statement.Execute(args.GetDictionary());
   }
 
 
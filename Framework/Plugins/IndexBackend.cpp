@@ -30,9 +30,156 @@
 #include <Core/OrthancException.h>
 #include <OrthancServer/ServerEnumerations.h>
 
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 
 namespace OrthancDatabases
 {
+  // Maximum number of pages whose last key is remembered by
+  // "GetAllPublicIds()" to implement keyset pagination
+  static const size_t MAX_PAGES_INDEX_SIZE = 1024;
+
+
+  // The "GlobalIntegers" table contains counters that are maintained
+  // by the triggers of the database (cf. the "GlobalIntegers.sql"
+  // file of each plugin). On PostgreSQL, each counter is split into
+  // several stripes that must be summed.
+  struct ReadGlobalIntegerDefinition
+  {
+    enum Parameter
+    {
+      Parameter_Property,
+      Parameter_Count
+    };
+
+    static const StatementParameter  PARAMETERS[];
+    static const char* const         SQL_MYSQL;
+    static const char* const         SQL_POSTGRESQL;
+    static const char* const         SQL_SQLITE;
+  };
+
+  const StatementParameter ReadGlobalIntegerDefinition::PARAMETERS[] =
+  {
+    { "property", ValueType_Integer64 },
+    { NULL, ValueType_Null }
+  };
+
+  const char* const ReadGlobalIntegerDefinition::SQL_MYSQL =
+    "SELECT value FROM GlobalIntegers WHERE property=${property}";
+
+  const char* const ReadGlobalIntegerDefinition::SQL_POSTGRESQL =
+    "SELECT CAST(COALESCE(SUM(value), 0) AS BIGINT) FROM GlobalIntegers WHERE property=${property}";
+
+  const char* const ReadGlobalIntegerDefinition::SQL_SQLITE =
+    "SELECT value FROM GlobalIntegers WHERE property=${property}";
+
+  static const StatementTemplate<ReadGlobalIntegerDefinition>  READ_GLOBAL_INTEGER;
+
+
+  // Inserts or overwrites one metadata in a single statement (the
+  // "ON CONFLICT" clause requires PostgreSQL >= 9.5). On SQLite, the
+  // whole row is replaced, which is equivalent as "value" is the only
+  // column that is not part of the primary key.
+  struct SetMetadataDefinition
+  {
+    enum Parameter
+    {
+      Parameter_Id,
+      Parameter_Type,
+      Parameter_Value,
+      Parameter_Count
+    };
+
+    static const StatementParameter  PARAMETERS[];
+    static const char* const         SQL_MYSQL;
+    static const char* const         SQL_POSTGRESQL;
+    static const char* const         SQL_SQLITE;
+  };
+
+  const StatementParameter SetMetadataDefinition::PARAMETERS[] =
+  {
+    { "id", ValueType_Integer64 },
+    { "type", ValueType_Integer64 },
+    { "value", ValueType_Utf8String },
+    { NULL, ValueType_Null }
+  };
+
+  const char* const SetMetadataDefinition::SQL_MYSQL =
+    "INSERT INTO Metadata VALUES (${id}, ${type}, ${value}) "
+    "ON DUPLICATE KEY UPDATE value=VALUES(value)";
+
+  const char* const SetMetadataDefinition::SQL_POSTGRESQL =
+    "INSERT INTO Metadata VALUES (${id}, ${type}, ${value}) "
+    "ON CONFLICT (id, type) DO UPDATE SET value=EXCLUDED.value";
+
+  const char* const SetMetadataDefinition::SQL_SQLITE =
+    "INSERT OR REPLACE INTO Metadata VALUES (${id}, ${type}, ${value})";
+
+  static const StatementTemplate<SetMetadataDefinition>  SET_METADATA;
+
+
+  // Counting the rows of some tables (for unit testing only)
+  struct CountResourcesDefinition
+  {
+    enum Parameter
+    {
+      Parameter_Count
+    };
+
+    static const StatementParameter  PARAMETERS[];
+    static const char* const         SQL_MYSQL;
+    static const char* const         SQL_POSTGRESQL;
+    static const char* const         SQL_SQLITE;
+  };
+
+  const StatementParameter CountResourcesDefinition::PARAMETERS[] =
+  {
+    { NULL, ValueType_Null }
+  };
+
+  const char* const CountResourcesDefinition::SQL_MYSQL =
+    "SELECT CAST(COUNT(*) AS UNSIGNED INT) FROM Resources";
+
+  const char* const CountResourcesDefinition::SQL_POSTGRESQL =
+    "SELECT CAST(COUNT(*) AS BIGINT) FROM Resources";
+
+  const char* const CountResourcesDefinition::SQL_SQLITE =
+    "SELECT COUNT(*) FROM Resources";
+
+  static const StatementTemplate<CountResourcesDefinition>  COUNT_RESOURCES;
+
+
+  struct CountUnprotectedPatientsDefinition
+  {
+    enum Parameter
+    {
+      Parameter_Count
+    };
+
+    static const StatementParameter  PARAMETERS[];
+    static const char* const         SQL_MYSQL;
+    static const char* const         SQL_POSTGRESQL;
+    static const char* const         SQL_SQLITE;
+  };
+
+  const StatementParameter CountUnprotectedPatientsDefinition::PARAMETERS[] =
+  {
+    { NULL, ValueType_Null }
+  };
+
+  const char* const CountUnprotectedPatientsDefinition::SQL_MYSQL =
+    "SELECT CAST(COUNT(*) AS UNSIGNED INT) FROM PatientRecyclingOrder";
+
+  const char* const CountUnprotectedPatientsDefinition::SQL_POSTGRESQL =
+    "SELECT CAST(COUNT(*) AS BIGINT) FROM PatientRecyclingOrder";
+
+  const char* const CountUnprotectedPatientsDefinition::SQL_SQLITE =
+    "SELECT COUNT(*) FROM PatientRecyclingOrder";
+
+  static const StatementTemplate<CountUnprotectedPatientsDefinition>  COUNT_UNPROTECTED_PATIENTS;
+
+
   static std::string ConvertWildcardToLike(const std::string& query)
   {
     std::string s = query;
@@ -97,8 +244,8 @@ namespace OrthancDatabases
   }
 
     
-  std::string IndexBackend::ReadString(const DatabaseManager::CachedStatement& statement,
-                                       size_t field)
+  const std::string& IndexBackend::ReadString(const DatabaseManager::CachedStatement& statement,
+                                              size_t field)
   {
     const IValue& value = statement.GetResultField(field);
       
@@ -144,14 +291,110 @@ namespace OrthancDatabases
   }
 
     
-  void IndexBackend::ReadListOfStrings(std::list<std::string>& target,
-                                       DatabaseManager::CachedStatement& statement,
-                                       const Dictionary& args)
+  class IndexBackend::ListOfIntegers : public IIntegersSink
   {
-    statement.Execute(args);
+  private:
+    std::list<int64_t>&  target_;
 
-    target.clear();
+  public:
+    explicit ListOfIntegers(std::list<int64_t>& target) :
+      target_(target)
+    {
+      target_.clear();
+    }
+
+    virtual void Add(int64_t value)
+    {
+      target_.push_back(value);
+    }
+  };
+
+
+  class IndexBackend::ListOfStrings : public IStringsSink
+  {
+  private:
+    std::list<std::string>&  target_;
+
+  public:
+    explicit ListOfStrings(std::list<std::string>& target) :
+      target_(target)
+    {
+      target_.clear();
+    }
+
+    virtual void Add(const std::string& value)
+    {
+      target_.push_back(value);
+    }
+  };
+
+
+  class IndexBackend::IntegersOutput : public IIntegersSink
+  {
+  private:
+    OrthancPlugins::DatabaseBackendOutput&  output_;
+
+  public:
+    explicit IntegersOutput(OrthancPlugins::DatabaseBackendOutput& output) :
+      output_(output)
+    {
+    }
+
+    virtual void Add(int64_t value)
+    {
+      output_.AnswerInt64(value);
+    }
+  };
+
+
+  class IndexBackend::StringsOutput : public IStringsSink
+  {
+  private:
+    OrthancPlugins::DatabaseBackendOutput&  output_;
+
+  public:
+    explicit StringsOutput(OrthancPlugins::DatabaseBackendOutput& output) :
+      output_(output)
+    {
+    }
+
+    virtual void Add(const std::string& value)
+    {
+      output_.AnswerString(value);
+    }
+  };
+
+
+  void IndexBackend::ReadIntegers(IIntegersSink& target,
+                                  DatabaseManager::CachedStatement& statement,
+                                  const Dictionary& args)
+  {
+    statement.Execute(args);
+      
+    if (!statement.IsDone())
+    {
+      if (statement.GetResultFieldsCount() != 1)
+      {
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_InternalError);
+      }
       
+      statement.SetResultFieldType(0, ValueType_Integer64);
+
+      while (!statement.IsDone())
+      {
+        target.Add(ReadInteger64(statement, 0));
+        statement.Next();
+      }
+    }
+  }
+
+    
+  void IndexBackend::ReadStrings(IStringsSink& target,
+                                 DatabaseManager::CachedStatement& statement,
+                                 const Dictionary& args)
+  {
+    statement.Execute(args);
+
     if (!statement.IsDone())
     {
       if (statement.GetResultFieldsCount() != 1)
@@ -161,12 +404,21 @@ namespace OrthancDatabases
       
       while (!statement.IsDone())
       {
-        target.push_back(ReadString(statement, 0));
+        target.Add(ReadString(statement, 0));
         statement.Next();
       }
     }
   }
 
+    
+  void IndexBackend::ReadListOfStrings(std::list<std::string>& target,
+                                       DatabaseManager::CachedStatement& statement,
+                                       const Dictionary& args)
+  {
+    ListOfStrings sink(target);
+    ReadStrings(sink, statement, args);
+  }
+
 
   void IndexBackend::ReadChangesInternal(bool& done,
                                          DatabaseManager::CachedStatement& statement,
@@ -239,6 +491,7 @@ namespace OrthancDatabases
       "DELETE FROM DeletedFiles");
 
     statement.Execute();
+    SignalModification("DeletedFiles");
   }
     
 
@@ -249,6 +502,7 @@ namespace OrthancDatabases
       "DELETE FROM DeletedResources");
 
     statement.Execute();
+    SignalModification("DeletedResources");
   }
     
 
@@ -291,8 +545,12 @@ namespace OrthancDatabases
 
     while (!statement.IsDone())
     {
+      std::string publicId = ReadString(statement, 1);
+      resourcesCache_.Invalidate(publicId);
+      publicIdsFilter_.SignalDeletion();
+
       GetOutput().SignalDeletedResource(
-        ReadString(statement, 1),
+        publicId,
         static_cast<OrthancPluginResourceType>(ReadInteger32(statement, 0)));
 
       statement.Next();
@@ -301,8 +559,42 @@ namespace OrthancDatabases
 
 
   IndexBackend::IndexBackend(IDatabaseFactory* factory) :
-    manager_(factory)
+    manager_(factory),
+    pagesIndexEnabled_(true),
+    changesFeed_(NULL),
+    pendingChanges_(false),
+    resourcesCache_(10000),
+    mainDicomTagsCache_(16 * 1024 * 1024),
+    crossCheckMainDicomTags_(false),
+    readAhead_(1000),
+    inTransaction_(false),
+    lookupTimeout_(0),
+    resourceTypeInTags_(false)
+  {
+  }
+
+
+  void IndexBackend::CommitTransaction()
   {
+    ClearReadAhead();
+    inTransaction_ = false;
+
+    try
+    {
+      manager_.CommitTransaction();
+    }
+    catch (Orthanc::OrthancException&)
+    {
+      ClearResourcesCache();
+      ClearMainDicomTagsCache();
+      throw;
+    }
+
+    if (pendingChanges_)
+    {
+      pendingChanges_ = false;
+      changesFeed_->Signal();
+    }
   }
 
     
@@ -333,7 +625,8 @@ namespace OrthancDatabases
     args.SetUtf8Value("hash", attachment.uncompressedHash);
     args.SetUtf8Value("hash-compressed", attachment.compressedHash);
     
-    statement.Execute(args);
+    readAhead_.Invalidate(id);
+    statement.ExecuteWithoutResult(args);
   }
 
     
@@ -351,7 +644,8 @@ namespace OrthancDatabases
     args.SetIntegerValue("parent", parent);
     args.SetIntegerValue("child", child);
     
-    statement.Execute(args);
+    readAhead_.Invalidate(child);
+    statement.ExecuteWithoutResult(args);
   }
 
     
@@ -362,6 +656,7 @@ namespace OrthancDatabases
       "DELETE FROM Changes");
 
     statement.Execute();
+    SignalModification("Changes");
   }
 
     
@@ -372,6 +667,7 @@ namespace OrthancDatabases
       "DELETE FROM ExportedResources");
 
     statement.Execute();
+    SignalModification("ExportedResources");
   }
 
     
@@ -379,6 +675,7 @@ namespace OrthancDatabases
                                       int32_t attachment)
   {
     ClearDeletedFiles();
+    readAhead_.Invalidate(id);
 
     {
       DatabaseManager::CachedStatement statement(
@@ -413,7 +710,8 @@ namespace OrthancDatabases
     args.SetIntegerValue("id", id);
     args.SetIntegerValue("type", static_cast<int>(metadataType));
     
-    statement.Execute(args);
+    readAhead_.Invalidate(id);
+    statement.ExecuteWithoutResult(args);
   }
 
     
@@ -423,6 +721,30 @@ namespace OrthancDatabases
     
     ClearDeletedFiles();
     ClearDeletedResources();
+    ClearPagesIndex();  // The offsets of the pages are shifted
+
+    // The triggers only report the public IDs of the deleted
+    // resources. The internal IDs of the descendants and of the
+    // ancestors are looked up beforehand, so as to remove them from
+    // the caches.
+    const bool caching = IsCachingResources();
+    int32_t level = 0;
+    std::vector<int64_t> ancestors;  // The parent comes first
+
+    if (caching)
+    {
+      level = static_cast<int32_t>(GetResourceType(id));
+
+      int64_t current = id;
+      int64_t parent;
+      while (LookupParent(parent, current))
+      {
+        ancestors.push_back(parent);
+        current = parent;
+      }
+
+      InvalidateDescendants(id, static_cast<OrthancPluginResourceType>(level));
+    }
     
     {
       DatabaseManager::CachedStatement statement(
@@ -430,6 +752,7 @@ namespace OrthancDatabases
         "DELETE FROM RemainingAncestor");
 
       statement.Execute();
+      SignalModification("RemainingAncestor");
     }
       
     {
@@ -443,6 +766,10 @@ namespace OrthancDatabases
       args.SetIntegerValue("id", id);
     
       statement.Execute(args);
+
+      // The deletion cascades to the recycling order of the patients
+      SignalModification("Resources");
+      SignalModification("PatientRecyclingOrder");
     }
 
 
@@ -453,15 +780,33 @@ namespace OrthancDatabases
 
       statement.Execute();
 
+      // Without remaining ancestor, all the ancestors are deleted
+      size_t deletedAncestors = ancestors.size();
+
       if (!statement.IsDone())
       {
+        const int32_t remainingLevel = ReadInteger32(statement, 0);
+
         GetOutput().SignalRemainingAncestor(
           ReadString(statement, 1),
-          static_cast<OrthancPluginResourceType>(ReadInteger32(statement, 0)));
+          static_cast<OrthancPluginResourceType>(remainingLevel));
+
+        if (caching &&
+            remainingLevel < level)
+        {
+          // The ancestor at index "i" has level "level - 1 - i"
+          deletedAncestors = std::min(ancestors.size(),
+                                      static_cast<size_t>(level - 1 - remainingLevel));
+        }
           
         // There is at most 1 remaining ancestor
         assert((statement.Next(), statement.IsDone()));
       }
+
+      for (size_t i = 0; i < deletedAncestors; i++)
+      {
+        InvalidateResource(ancestors[i]);
+      }
     }
     
     SignalDeletedFiles();
@@ -469,62 +814,163 @@ namespace OrthancDatabases
   }
 
 
-  void IndexBackend::GetAllInternalIds(std::list<int64_t>& target,
-                                       OrthancPluginResourceType resourceType)
+  void IndexBackend::GetAllInternalIdsInternal(IIntegersSink& target,
+                                               OrthancPluginResourceType resourceType)
   {
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
       "SELECT internalId FROM Resources WHERE resourceType=${type}");
       
     statement.SetReadOnly(true);
+    statement.SetStreaming(true);
     statement.SetParameterType("type", ValueType_Integer64);
 
     Dictionary args;
     args.SetIntegerValue("type", static_cast<int>(resourceType));
 
-    ReadListOfIntegers<int64_t>(target, statement, args);
+    ReadIntegers(target, statement, args);
   }
 
     
-  void IndexBackend::GetAllPublicIds(std::list<std::string>& target,
-                                     OrthancPluginResourceType resourceType)
+  void IndexBackend::GetAllInternalIds(std::list<int64_t>& target,
+                                       OrthancPluginResourceType resourceType)
+  {
+    ListOfIntegers sink(target);
+    GetAllInternalIdsInternal(sink, resourceType);
+  }
+
+    
+  void IndexBackend::StreamAllInternalIds(OrthancPluginResourceType resourceType)
+  {
+    IntegersOutput sink(GetOutput());
+    GetAllInternalIdsInternal(sink, resourceType);
+  }
+
+    
+  void IndexBackend::GetAllPublicIdsInternal(IStringsSink& target,
+                                             OrthancPluginResourceType resourceType)
   {
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
       "SELECT publicId FROM Resources WHERE resourceType=${type}");
       
     statement.SetReadOnly(true);
+    statement.SetStreaming(true);
     statement.SetParameterType("type", ValueType_Integer64);
 
     Dictionary args;
     args.SetIntegerValue("type", static_cast<int>(resourceType));
 
-    ReadListOfStrings(target, statement, args);
+    ReadStrings(target, statement, args);
   }
 
     
   void IndexBackend::GetAllPublicIds(std::list<std::string>& target,
-                                     OrthancPluginResourceType resourceType,
-                                     uint64_t since,
-                                     uint64_t limit)
+                                     OrthancPluginResourceType resourceType)
+  {
+    ListOfStrings sink(target);
+    GetAllPublicIdsInternal(sink, resourceType);
+  }
+
+    
+  void IndexBackend::StreamAllPublicIds(OrthancPluginResourceType resourceType)
+  {
+    StringsOutput sink(GetOutput());
+    GetAllPublicIdsInternal(sink, resourceType);
+  }
+
+    
+  void IndexBackend::GetAllPublicIdsInternal(IStringsSink& target,
+                                             OrthancPluginResourceType resourceType,
+                                             uint64_t since,
+                                             uint64_t limit)
   {
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
-      "SELECT publicId FROM (SELECT publicId FROM Resources "
-      "WHERE resourceType=${type}) AS tmp "
-      "ORDER BY tmp.publicId LIMIT ${limit} OFFSET ${since}");
+      "SELECT internalId, publicId FROM Resources "
+      "WHERE resourceType=${type} AND internalId>${last} "
+      "ORDER BY internalId LIMIT ${limit} OFFSET ${skip}");
       
     statement.SetReadOnly(true);
     statement.SetParameterType("type", ValueType_Integer64);
+    statement.SetParameterType("last", ValueType_Integer64);
     statement.SetParameterType("limit", ValueType_Integer64);
-    statement.SetParameterType("since", ValueType_Integer64);
+    statement.SetParameterType("skip", ValueType_Integer64);
+
+    /**
+     * Keyset pagination: Skipping "since" rows with "OFFSET" has a
+     * cost that grows linearly with the depth of the page. Instead,
+     * the resources are ordered by "internalId", and the scan starts
+     * after the last "internalId" of the closest page that was
+     * previously returned. "OFFSET" is only used to move forward from
+     * this page, which is a no-op when walking the pages in sequence.
+     **/
+
+    int64_t last = -1;  // Before all the resources
+    uint64_t skip = since;
+
+    PagesIndex::const_iterator closest =
+      pagesIndex_.upper_bound(std::make_pair(static_cast<int32_t>(resourceType), since));
+
+    if (pagesIndexEnabled_ &&
+        closest != pagesIndex_.begin())
+    {
+      --closest;
+      if (closest->first.first == static_cast<int32_t>(resourceType))
+      {
+        assert(closest->first.second <= since);
+        last = closest->second;
+        skip = since - closest->first.second;
+      }
+    }
 
     Dictionary args;
     args.SetIntegerValue("type", static_cast<int>(resourceType));
+    args.SetIntegerValue("last", last);
     args.SetIntegerValue("limit", limit);
-    args.SetIntegerValue("since", since);
+    args.SetIntegerValue("skip", skip);
+
+    statement.Execute(args);
+
+    uint64_t count = 0;
+
+    while (!statement.IsDone())
+    {
+      last = ReadInteger64(statement, 0);
+      target.Add(ReadString(statement, 1));
+      count++;
+      statement.Next();
+    }
+
+    if (pagesIndexEnabled_ &&
+        count > 0)
+    {
+      if (pagesIndex_.size() >= MAX_PAGES_INDEX_SIZE)
+      {
+        pagesIndex_.clear();
+      }
 
-    ReadListOfStrings(target, statement, args);
+      pagesIndex_[std::make_pair(static_cast<int32_t>(resourceType), since + count)] = last;
+    }
+  }
+
+    
+  void IndexBackend::GetAllPublicIds(std::list<std::string>& target,
+                                     OrthancPluginResourceType resourceType,
+                                     uint64_t since,
+                                     uint64_t limit)
+  {
+    ListOfStrings sink(target);
+    GetAllPublicIdsInternal(sink, resourceType, since, limit);
+  }
+
+    
+  void IndexBackend::StreamAllPublicIds(OrthancPluginResourceType resourceType,
+                                        uint64_t since,
+                                        uint64_t limit)
+  {
+    StringsOutput sink(GetOutput());
+    GetAllPublicIdsInternal(sink, resourceType, since, limit);
   }
 
     
@@ -549,8 +995,8 @@ namespace OrthancDatabases
   }
 
     
-  void IndexBackend::GetChildrenInternalId(std::list<int64_t>& target /*out*/,
-                                           int64_t id)
+  void IndexBackend::GetChildrenInternalIdInternal(IIntegersSink& target,
+                                                   int64_t id)
   {
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
@@ -563,12 +1009,27 @@ namespace OrthancDatabases
     Dictionary args;
     args.SetIntegerValue("id", id);
 
-    ReadListOfIntegers<int64_t>(target, statement, args);
+    ReadIntegers(target, statement, args);
   }
 
     
-  void IndexBackend::GetChildrenPublicId(std::list<std::string>& target /*out*/,
-                                         int64_t id)
+  void IndexBackend::GetChildrenInternalId(std::list<int64_t>& target /*out*/,
+                                           int64_t id)
+  {
+    ListOfIntegers sink(target);
+    GetChildrenInternalIdInternal(sink, id);
+  }
+
+    
+  void IndexBackend::StreamChildrenInternalId(int64_t id)
+  {
+    IntegersOutput sink(GetOutput());
+    GetChildrenInternalIdInternal(sink, id);
+  }
+
+    
+  void IndexBackend::GetChildrenPublicIdInternal(IStringsSink& target,
+                                                 int64_t id)
   {
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
@@ -581,7 +1042,22 @@ namespace OrthancDatabases
     Dictionary args;
     args.SetIntegerValue("id", id);
 
-    ReadListOfStrings(target, statement, args);
+    ReadStrings(target, statement, args);
+  }
+
+    
+  void IndexBackend::GetChildrenPublicId(std::list<std::string>& target /*out*/,
+                                         int64_t id)
+  {
+    ListOfStrings sink(target);
+    GetChildrenPublicIdInternal(sink, id);
+  }
+
+    
+  void IndexBackend::StreamChildrenPublicId(int64_t id)
+  {
+    StringsOutput sink(GetOutput());
+    GetChildrenPublicIdInternal(sink, id);
   }
 
     
@@ -638,12 +1114,29 @@ namespace OrthancDatabases
   }
 
     
-  /* Use GetOutput().AnswerDicomTag() */
-  void IndexBackend::GetMainDicomTags(int64_t id)
+  const ReadAheadCache::Resource* IndexBackend::ReadAhead(int64_t id)
   {
+    if (!inTransaction_)
+    {
+      return NULL;
+    }
+
+    const ReadAheadCache::Resource* cached = readAhead_.Lookup(id);
+    if (cached != NULL)
+    {
+      return cached;
+    }
+
+    // The first column tells whether the row is the parent (0), an
+    // attachment (1) or a metadata (2)
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
-      "SELECT * FROM MainDicomTags WHERE id=${id}");
+      "SELECT 0, parentId, NULL, NULL, NULL, NULL, NULL, NULL "
+      "FROM Resources WHERE internalId=${id} "
+      "UNION ALL SELECT 1, fileType, uuid, uncompressedSize, compressionType, compressedSize, "
+      "uncompressedHash, compressedHash FROM AttachedFiles WHERE id=${id} "
+      "UNION ALL SELECT 2, type, value, NULL, NULL, NULL, NULL, NULL "
+      "FROM Metadata WHERE id=${id}");
 
     statement.SetReadOnly(true);
     statement.SetParameterType("id", ValueType_Integer64);
@@ -653,86 +1146,309 @@ namespace OrthancDatabases
 
     statement.Execute(args);
 
+    std::auto_ptr<ReadAheadCache::Resource> resource(new ReadAheadCache::Resource);
+
     while (!statement.IsDone())
     {
-      GetOutput().AnswerDicomTag(static_cast<uint16_t>(ReadInteger64(statement, 1)),
-                                 static_cast<uint16_t>(ReadInteger64(statement, 2)),
-                                 ReadString(statement, 3));
+      switch (ReadInteger32(statement, 0))
+      {
+        case 0:
+          if (statement.GetResultField(1).GetType() != ValueType_Null)
+          {
+            resource->SetParent(ReadInteger64(statement, 1));
+          }
+          break;
+
+        case 1:
+        {
+          ReadAheadCache::Attachment attachment;
+          attachment.uuid_ = ReadString(statement, 2);
+          attachment.uncompressedSize_ = ReadInteger64(statement, 3);
+          attachment.compressionType_ = ReadInteger32(statement, 4);
+          attachment.compressedSize_ = ReadInteger64(statement, 5);
+          attachment.uncompressedHash_ = ReadString(statement, 6);
+          attachment.compressedHash_ = ReadString(statement, 7);
+          resource->AddAttachment(ReadInteger32(statement, 1), attachment);
+          break;
+        }
+
+        case 2:
+          resource->AddMetadata(ReadInteger32(statement, 1), ReadString(statement, 2));
+          break;
+
+        default:
+          throw Orthanc::OrthancException(Orthanc::ErrorCode_InternalError);
+      }
+
       statement.Next();
     }
+
+    const ReadAheadCache::Resource* result = resource.get();
+    readAhead_.Add(id, resource.release());
+    return result;
   }
 
-    
-  std::string IndexBackend::GetPublicId(int64_t resourceId)
+
+  void IndexBackend::BuildPublicIdsFilter(IDatabase& database,
+                                          uint64_t expectedCount)
   {
-    DatabaseManager::CachedStatement statement(
-      STATEMENT_FROM_HERE, manager_,
-      "SELECT publicId FROM Resources WHERE internalId=${id}");
+    try
+    {
+      const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
 
-    statement.SetReadOnly(true);
-    statement.SetParameterType("id", ValueType_Integer64);
+      PublicIdsFilter::Builder builder(expectedCount);
 
-    Dictionary args;
-    args.SetIntegerValue("id", resourceId);
+      Query query("SELECT publicId FROM Resources", true);
+      query.SetStreaming(true);
 
-    statement.Execute(args);
+      std::auto_ptr<IPrecompiledStatement> statement(database.Compile(query));
 
-    if (statement.IsDone())
-    {
-      throw Orthanc::OrthancException(Orthanc::ErrorCode_UnknownResource);
+      {
+        std::auto_ptr<ITransaction> transaction(database.CreateTransaction(false));
+
+        {
+          Dictionary args;
+          std::auto_ptr<IResult> result(transaction->Execute(*statement, args));
+
+          if (!result->IsDone())
+          {
+            result->SetExpectedType(0, ValueType_Utf8String);
+          }
+
+          while (!result->IsDone())
+          {
+            builder.Add(dynamic_cast<const Utf8StringValue&>(result->GetField(0)).GetContent());
+            result->Next();
+          }
+        }
+
+        transaction->Commit();
+      }
+
+      publicIdsFilter_.FinishRebuild(builder);
+
+      LOG(INFO) << "The filter of the public IDs has been built over about " << expectedCount
+                << " resources in " << (boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds() << "ms";
     }
-    else
+    catch (Orthanc::OrthancException&)
     {
-      return ReadString(statement, 0);
+      publicIdsFilter_.CancelRebuild();
+      throw;
     }
   }
 
-    
-  uint64_t IndexBackend::GetResourceCount(OrthancPluginResourceType resourceType)
+
+  void IndexBackend::RebuildPublicIdsFilter()
   {
-    std::auto_ptr<DatabaseManager::CachedStatement> statement;
+    if (!publicIdsFilter_.IsEnabled())
+    {
+      return;
+    }
+
+    DatabaseManager::IdleLock lock(manager_);
+
+    const uint64_t count = (GetResourceCount(OrthancPluginResourceType_Patient) +
+                            GetResourceCount(OrthancPluginResourceType_Study) +
+                            GetResourceCount(OrthancPluginResourceType_Series) +
+                            GetResourceCount(OrthancPluginResourceType_Instance));
+
+    publicIdsFilter_.StartRebuild();
+    BuildPublicIdsFilter(lock.GetDatabase(), count);
+  }
+
+
+  bool IndexBackend::RefreshPublicIdsFilter()
+  {
+    if (!publicIdsFilter_.NeedsRebuild())
+    {
+      return true;
+    }
 
-    switch (manager_.GetDialect())
+    if (publicIdsDatabase_.get() == NULL)
     {
-      case Dialect_MySQL:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT CAST(COUNT(*) AS UNSIGNED INT) FROM Resources WHERE resourceType=${type}"));
-        break;
+      publicIdsDatabase_.reset(OpenMaintenanceDatabase());
+    }
 
-      case Dialect_PostgreSQL:
-        statement.reset(new DatabaseManager::CachedStatement(
-                        STATEMENT_FROM_HERE, GetManager(),
-                        "SELECT CAST(COUNT(*) AS BIGINT) FROM Resources WHERE resourceType=${type}"));
-        break;
+    uint64_t count;
 
-      case Dialect_SQLite:
-        statement.reset(new DatabaseManager::CachedStatement(
-                        STATEMENT_FROM_HERE, GetManager(),
-                        "SELECT COUNT(*) FROM Resources WHERE resourceType=${type}"));
-        break;
+    {
+      DatabaseManager::IdleLock lock(manager_);
 
-      default:
-        throw Orthanc::OrthancException(Orthanc::ErrorCode_NotImplemented);
+      if (!lock.IsIdle())
+      {
+        return false;  // Orthanc is busy, try again at the next round
+      }
+
+      count = (GetResourceCount(OrthancPluginResourceType_Patient) +
+               GetResourceCount(OrthancPluginResourceType_Study) +
+               GetResourceCount(OrthancPluginResourceType_Series) +
+               GetResourceCount(OrthancPluginResourceType_Instance));
+
+      // No transaction of Orthanc is pending: The snapshot that is
+      // read below contains all the resources that are not logged
+      // by the filter from now on
+      publicIdsFilter_.StartRebuild();
+
+      if (publicIdsDatabase_.get() == NULL)
+      {
+        BuildPublicIdsFilter(lock.GetDatabase(), count);
+        return true;
+      }
     }
 
-    statement->SetReadOnly(true);
-    statement->SetParameterType("type", ValueType_Integer64);
+    // Orthanc can access the index (and the current filter) while the
+    // "Resources" table is read on the dedicated connection
+    try
+    {
+      BuildPublicIdsFilter(*publicIdsDatabase_, count);
+      return true;
+    }
+    catch (Orthanc::OrthancException&)
+    {
+      // Reconnect at the next round
+      publicIdsDatabase_.reset(NULL);
+      throw;
+    }
+  }
+
+
+  bool IndexBackend::IsCachingResources()
+  {
+    return (resourcesCache_.GetMaxSize() != 0 ||
+            !mainDicomTagsCache_.IsEmpty() ||
+            !readAhead_.IsEmpty());
+  }
+
+
+  void IndexBackend::InvalidateResource(int64_t id)
+  {
+    readAhead_.Invalidate(id);
+    mainDicomTagsCache_.Invalidate(id);
+
+    std::string publicId;
+    if (resourcesCache_.LookupPublicId(publicId, id))
+    {
+      resourcesCache_.Invalidate(publicId);
+    }
+  }
+
+
+  void IndexBackend::InvalidateDescendants(int64_t id,
+                                           OrthancPluginResourceType level)
+  {
+    // Breadth-first exploration, one level at a time. The children of
+    // the instances are not looked up, as there is none.
+    std::list<int64_t> resources;
+    resources.push_back(id);
+
+    while (!resources.empty())
+    {
+      std::list<int64_t> children;
+
+      for (std::list<int64_t>::const_iterator it = resources.begin();
+           it != resources.end(); ++it)
+      {
+        InvalidateResource(*it);
+
+        if (level != OrthancPluginResourceType_Instance)
+        {
+          std::list<int64_t> tmp;
+          GetChildrenInternalId(tmp, *it);
+          children.splice(children.end(), tmp);
+        }
+      }
+
+      resources.swap(children);
+      level = static_cast<OrthancPluginResourceType>(level + 1);
+    }
+  }
+
+
+  void IndexBackend::ForgetDeletedResources(int64_t id)
+  {
+    if (IsCachingResources())
+    {
+      InvalidateDescendants(id, GetResourceType(id));
+    }
+
+    // At least one resource is deleted
+    publicIdsFilter_.SignalDeletion();
+  }
+
+
+  void IndexBackend::ReadMainDicomTags(MainDicomTagsCache::Tags& target,
+                                       int64_t id)
+  {
+    DatabaseManager::CachedStatement statement(
+      STATEMENT_FROM_HERE, manager_,
+      "SELECT * FROM MainDicomTags WHERE id=${id}");
+
+    statement.SetReadOnly(true);
+    statement.SetParameterType("id", ValueType_Integer64);
 
     Dictionary args;
-    args.SetIntegerValue("type", resourceType);
+    args.SetIntegerValue("id", id);
 
-    statement->Execute(args);
+    statement.Execute(args);
+
+    target.clear();
 
-    return static_cast<uint64_t>(ReadInteger64(*statement, 0));
+    while (!statement.IsDone())
+    {
+      target.push_back(MainDicomTagsCache::Tag(static_cast<uint16_t>(ReadInteger64(statement, 1)),
+                                               static_cast<uint16_t>(ReadInteger64(statement, 2)),
+                                               ReadString(statement, 3)));
+      statement.Next();
+    }
   }
 
     
-  OrthancPluginResourceType IndexBackend::GetResourceType(int64_t resourceId)
+  /* Use GetOutput().AnswerDicomTag() */
+  void IndexBackend::GetMainDicomTags(int64_t id)
+  {
+    MainDicomTagsCache::Tags tags;
+
+    if (mainDicomTagsCache_.Lookup(tags, id))
+    {
+      if (crossCheckMainDicomTags_)
+      {
+        MainDicomTagsCache::Tags expected;
+        ReadMainDicomTags(expected, id);
+
+        std::sort(tags.begin(), tags.end());
+        std::sort(expected.begin(), expected.end());
+
+        if (tags != expected)
+        {
+          LOG(ERROR) << "The cache of the main DICOM tags is not coherent for resource " << id;
+          throw Orthanc::OrthancException(Orthanc::ErrorCode_InternalError);
+        }
+      }
+    }
+    else
+    {
+      ReadMainDicomTags(tags, id);
+      mainDicomTagsCache_.Add(id, tags);
+    }
+
+    for (MainDicomTagsCache::Tags::const_iterator it = tags.begin(); it != tags.end(); ++it)
+    {
+      GetOutput().AnswerDicomTag(it->GetGroup(), it->GetElement(), it->GetValue());
+    }
+  }
+
+    
+  std::string IndexBackend::GetPublicId(int64_t resourceId)
   {
+    std::string publicId;
+    if (resourcesCache_.LookupPublicId(publicId, resourceId))
+    {
+      return publicId;
+    }
+
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
-      "SELECT resourceType FROM Resources WHERE internalId=${id}");
+      "SELECT publicId, resourceType FROM Resources WHERE internalId=${id}");
 
     statement.SetReadOnly(true);
     statement.SetParameterType("id", ValueType_Integer64);
@@ -748,82 +1464,80 @@ namespace OrthancDatabases
     }
     else
     {
-      return static_cast<OrthancPluginResourceType>(ReadInteger32(statement, 0));
+      publicId = ReadString(statement, 0);
+      resourcesCache_.Add(resourceId, publicId,
+                          static_cast<OrthancPluginResourceType>(ReadInteger32(statement, 1)));
+      return publicId;
     }
   }
 
     
-  uint64_t IndexBackend::GetTotalCompressedSize()
+  uint64_t IndexBackend::ReadGlobalInteger(int property)
   {
-    std::auto_ptr<DatabaseManager::CachedStatement> statement;
+    DatabaseManager::CachedStatement statement(
+      STATEMENT_FROM_HERE, GetManager(), READ_GLOBAL_INTEGER);
 
-    // NB: "COALESCE" is used to replace "NULL" by "0" if the number of rows is empty
+    statement.SetReadOnly(true);
 
-    switch (manager_.GetDialect())
-    {
-      case Dialect_MySQL:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT CAST(COALESCE(SUM(compressedSize), 0) AS UNSIGNED INTEGER) FROM AttachedFiles"));
-        break;
-        
-      case Dialect_PostgreSQL:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT CAST(COALESCE(SUM(compressedSize), 0) AS BIGINT) FROM AttachedFiles"));
-        break;
-
-      case Dialect_SQLite:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT COALESCE(SUM(compressedSize), 0) FROM AttachedFiles"));
-        break;
+    StatementTemplate<ReadGlobalIntegerDefinition>::Arguments args;
+    args.SetInteger(ReadGlobalIntegerDefinition::Parameter_Property, property);
 
-      default:
-        throw Orthanc::OrthancException(Orthanc::ErrorCode_NotImplemented);
-    }
+    statement.Execute(args.GetDictionary());
 
-    statement->SetReadOnly(true);
-    statement->Execute();
+    if (statement.IsDone())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+    }
+    else
+    {
+      return static_cast<uint64_t>(ReadInteger64(statement, 0));
+    }
+  }
 
-    return static_cast<uint64_t>(ReadInteger64(*statement, 0));
+    
+  uint64_t IndexBackend::GetResourceCount(OrthancPluginResourceType resourceType)
+  {
+    // Counter maintained by the triggers on the "Resources" table
+    return ReadGlobalInteger(2 + static_cast<int>(resourceType));
   }
 
     
-  uint64_t IndexBackend::GetTotalUncompressedSize()
+  OrthancPluginResourceType IndexBackend::GetResourceType(int64_t resourceId)
   {
-    std::auto_ptr<DatabaseManager::CachedStatement> statement;
+    DatabaseManager::CachedStatement statement(
+      STATEMENT_FROM_HERE, manager_,
+      "SELECT resourceType FROM Resources WHERE internalId=${id}");
 
-    // NB: "COALESCE" is used to replace "NULL" by "0" if the number of rows is empty
+    statement.SetReadOnly(true);
+    statement.SetParameterType("id", ValueType_Integer64);
 
-    switch (manager_.GetDialect())
-    {
-      case Dialect_MySQL:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT CAST(COALESCE(SUM(uncompressedSize), 0) AS UNSIGNED INTEGER) FROM AttachedFiles"));
-        break;
-        
-      case Dialect_PostgreSQL:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT CAST(COALESCE(SUM(uncompressedSize), 0) AS BIGINT) FROM AttachedFiles"));
-        break;
-
-      case Dialect_SQLite:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT COALESCE(SUM(uncompressedSize), 0) FROM AttachedFiles"));
-        break;
+    Dictionary args;
+    args.SetIntegerValue("id", resourceId);
 
-      default:
-        throw Orthanc::OrthancException(Orthanc::ErrorCode_NotImplemented);
+    statement.Execute(args);
+
+    if (statement.IsDone())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_UnknownResource);
     }
+    else
+    {
+      return static_cast<OrthancPluginResourceType>(ReadInteger32(statement, 0));
+    }
+  }
 
-    statement->SetReadOnly(true);
-    statement->Execute();
+    
+  uint64_t IndexBackend::GetTotalCompressedSize()
+  {
+    // Counter maintained by the triggers on the "AttachedFiles" table
+    return ReadGlobalInteger(0);
+  }
 
-    return static_cast<uint64_t>(ReadInteger64(*statement, 0));
+    
+  uint64_t IndexBackend::GetTotalUncompressedSize()
+  {
+    // Counter maintained by the triggers on the "AttachedFiles" table
+    return ReadGlobalInteger(1);
   }
 
     
@@ -866,6 +1580,13 @@ namespace OrthancDatabases
   void IndexBackend::ListAvailableMetadata(std::list<int32_t>& target /*out*/,
                                            int64_t id)
   {
+    const ReadAheadCache::Resource* resource = ReadAhead(id);
+    if (resource != NULL)
+    {
+      resource->ListMetadata(target);
+      return;
+    }
+
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
       "SELECT type FROM Metadata WHERE id=${id}");
@@ -883,6 +1604,13 @@ namespace OrthancDatabases
   void IndexBackend::ListAvailableAttachments(std::list<int32_t>& target /*out*/,
                                               int64_t id)
   {
+    const ReadAheadCache::Resource* resource = ReadAhead(id);
+    if (resource != NULL)
+    {
+      resource->ListAttachments(target);
+      return;
+    }
+
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
       "SELECT fileType FROM AttachedFiles WHERE id=${id}");
@@ -922,7 +1650,20 @@ namespace OrthancDatabases
     args.SetIntegerValue("resourceType", change.resourceType);
     args.SetUtf8Value("date", change.date);
 
-    statement.Execute(args);
+    statement.ExecuteWithoutResult(args);
+    SignalModification("Changes");
+
+    if (changesFeed_ != NULL)
+    {
+      if (manager_.IsTransactionActive())
+      {
+        pendingChanges_ = true;  // Wait for the commit
+      }
+      else
+      {
+        changesFeed_->Signal();
+      }
+    }
   }
 
     
@@ -952,7 +1693,8 @@ namespace OrthancDatabases
     args.SetUtf8Value("instance", resource.sopInstanceUid);
     args.SetUtf8Value("date", resource.date);
 
-    statement.Execute(args);
+    statement.ExecuteWithoutResult(args);
+    SignalModification("ExportedResources");
   }
 
     
@@ -960,6 +1702,27 @@ namespace OrthancDatabases
   bool IndexBackend::LookupAttachment(int64_t id,
                                       int32_t contentType)
   {
+    const ReadAheadCache::Resource* resource = ReadAhead(id);
+    if (resource != NULL)
+    {
+      const ReadAheadCache::Attachment* attachment = resource->LookupAttachment(contentType);
+      if (attachment == NULL)
+      {
+        return false;
+      }
+      else
+      {
+        GetOutput().AnswerAttachment(attachment->uuid_,
+                                     contentType,
+                                     attachment->uncompressedSize_,
+                                     attachment->uncompressedHash_,
+                                     attachment->compressionType_,
+                                     attachment->compressedSize_,
+                                     attachment->compressedHash_);
+        return true;
+      }
+    }
+
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
       "SELECT uuid, uncompressedSize, compressionType, compressedSize, "
@@ -1000,51 +1763,101 @@ namespace OrthancDatabases
   }
 
     
-  void IndexBackend::LookupIdentifier(std::list<int64_t>& target /*out*/,
-                                      OrthancPluginResourceType resourceType,
-                                      uint16_t group,
-                                      uint16_t element,
-                                      OrthancPluginIdentifierConstraint constraint,
-                                      const char* value)
+  void IndexBackend::LookupIdentifierInternal(IIntegersSink& target,
+                                              OrthancPluginResourceType resourceType,
+                                              uint16_t group,
+                                              uint16_t element,
+                                              OrthancPluginIdentifierConstraint constraint,
+                                              const char* value)
   {
     std::auto_ptr<DatabaseManager::CachedStatement> statement;
 
-    std::string header =
-      "SELECT d.id FROM DicomIdentifiers AS d, Resources AS r WHERE "
-      "d.id = r.internalId AND r.resourceType=${type} AND d.tagGroup=${group} "
-      "AND d.tagElement=${element} AND ";
-      
-    switch (constraint)
+    if (resourceTypeInTags_)
     {
-      case OrthancPluginIdentifierConstraint_Equal:
-        header += "d.value = ${value}";
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, manager_, header.c_str()));
-        break;
-        
-      case OrthancPluginIdentifierConstraint_SmallerOrEqual:
-        header += "d.value <= ${value}";
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, manager_, header.c_str()));
-        break;
-        
-      case OrthancPluginIdentifierConstraint_GreaterOrEqual:
-        header += "d.value >= ${value}";
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, manager_, header.c_str()));
-        break;
-        
-      case OrthancPluginIdentifierConstraint_Wildcard:
-        header += "d.value LIKE ${value}";
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, manager_, header.c_str()));
-        break;
-        
-      default:
-        throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+      // The level is stored next to the tag, which restricts the
+      // lookup to one partition of the table without any join
+      switch (constraint)
+      {
+        case OrthancPluginIdentifierConstraint_Equal:
+          statement.reset(new DatabaseManager::CachedStatement(
+                            STATEMENT_FROM_HERE, manager_,
+                            "SELECT d.id FROM DicomIdentifiers AS d WHERE "
+                            "d.resourceType=${type} AND d.tagGroup=${group} "
+                            "AND d.tagElement=${element} AND d.value = ${value}"));
+          break;
+
+        case OrthancPluginIdentifierConstraint_SmallerOrEqual:
+          statement.reset(new DatabaseManager::CachedStatement(
+                            STATEMENT_FROM_HERE, manager_,
+                            "SELECT d.id FROM DicomIdentifiers AS d WHERE "
+                            "d.resourceType=${type} AND d.tagGroup=${group} "
+                            "AND d.tagElement=${element} AND d.value <= ${value}"));
+          break;
+
+        case OrthancPluginIdentifierConstraint_GreaterOrEqual:
+          statement.reset(new DatabaseManager::CachedStatement(
+                            STATEMENT_FROM_HERE, manager_,
+                            "SELECT d.id FROM DicomIdentifiers AS d WHERE "
+                            "d.resourceType=${type} AND d.tagGroup=${group} "
+                            "AND d.tagElement=${element} AND d.value >= ${value}"));
+          break;
+
+        case OrthancPluginIdentifierConstraint_Wildcard:
+          statement.reset(new DatabaseManager::CachedStatement(
+                            STATEMENT_FROM_HERE, manager_,
+                            "SELECT d.id FROM DicomIdentifiers AS d WHERE "
+                            "d.resourceType=${type} AND d.tagGroup=${group} "
+                            "AND d.tagElement=${element} AND d.value LIKE ${value}"));
+          break;
+
+        default:
+          throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+      }
+    }
+    else
+    {
+      switch (constraint)
+      {
+        case OrthancPluginIdentifierConstraint_Equal:
+          statement.reset(new DatabaseManager::CachedStatement(
+                            STATEMENT_FROM_HERE, manager_,
+                            "SELECT d.id FROM DicomIdentifiers AS d, Resources AS r WHERE "
+                            "d.id = r.internalId AND r.resourceType=${type} AND d.tagGroup=${group} "
+                            "AND d.tagElement=${element} AND d.value = ${value}"));
+          break;
+
+        case OrthancPluginIdentifierConstraint_SmallerOrEqual:
+          statement.reset(new DatabaseManager::CachedStatement(
+                            STATEMENT_FROM_HERE, manager_,
+                            "SELECT d.id FROM DicomIdentifiers AS d, Resources AS r WHERE "
+                            "d.id = r.internalId AND r.resourceType=${type} AND d.tagGroup=${group} "
+                            "AND d.tagElement=${element} AND d.value <= ${value}"));
+          break;
+
+        case OrthancPluginIdentifierConstraint_GreaterOrEqual:
+          statement.reset(new DatabaseManager::CachedStatement(
+                            STATEMENT_FROM_HERE, manager_,
+                            "SELECT d.id FROM DicomIdentifiers AS d, Resources AS r WHERE "
+                            "d.id = r.internalId AND r.resourceType=${type} AND d.tagGroup=${group} "
+                            "AND d.tagElement=${element} AND d.value >= ${value}"));
+          break;
+
+        case OrthancPluginIdentifierConstraint_Wildcard:
+          statement.reset(new DatabaseManager::CachedStatement(
+                            STATEMENT_FROM_HERE, manager_,
+                            "SELECT d.id FROM DicomIdentifiers AS d, Resources AS r WHERE "
+                            "d.id = r.internalId AND r.resourceType=${type} AND d.tagGroup=${group} "
+                            "AND d.tagElement=${element} AND d.value LIKE ${value}"));
+          break;
+
+        default:
+          throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+      }
     }
 
     statement->SetReadOnly(true);
+    statement->SetStreaming(true);
+    statement->SetTimeout(lookupTimeout_);
     statement->SetParameterType("type", ValueType_Integer64);
     statement->SetParameterType("group", ValueType_Integer64);
     statement->SetParameterType("element", ValueType_Integer64);
@@ -1066,29 +1879,68 @@ namespace OrthancDatabases
 
     statement->Execute(args);
 
-    target.clear();
     while (!statement->IsDone())
     {
-      target.push_back(ReadInteger64(*statement, 0));
+      target.Add(ReadInteger64(*statement, 0));
       statement->Next();
     }
   }
 
+
+  void IndexBackend::LookupIdentifier(std::list<int64_t>& target /*out*/,
+                                      OrthancPluginResourceType resourceType,
+                                      uint16_t group,
+                                      uint16_t element,
+                                      OrthancPluginIdentifierConstraint constraint,
+                                      const char* value)
+  {
+    ListOfIntegers sink(target);
+    LookupIdentifierInternal(sink, resourceType, group, element, constraint, value);
+  }
+
+
+  void IndexBackend::StreamLookupIdentifier(OrthancPluginResourceType resourceType,
+                                            uint16_t group,
+                                            uint16_t element,
+                                            OrthancPluginIdentifierConstraint constraint,
+                                            const char* value)
+  {
+    IntegersOutput sink(GetOutput());
+    LookupIdentifierInternal(sink, resourceType, group, element, constraint, value);
+  }
+
     
-  void IndexBackend::LookupIdentifierRange(std::list<int64_t>& target /*out*/,
-                                           OrthancPluginResourceType resourceType,
-                                           uint16_t group,
-                                           uint16_t element,
-                                           const char* start,
-                                           const char* end)
+  void IndexBackend::LookupIdentifierRangeInternal(IIntegersSink& target,
+                                                   OrthancPluginResourceType resourceType,
+                                                   uint16_t group,
+                                                   uint16_t element,
+                                                   const char* start,
+                                                   const char* end)
   {
-    DatabaseManager::CachedStatement statement(
-      STATEMENT_FROM_HERE, manager_,
-      "SELECT d.id FROM DicomIdentifiers AS d, Resources AS r WHERE "
-      "d.id = r.internalId AND r.resourceType=${type} AND d.tagGroup=${group} "
-      "AND d.tagElement=${element} AND d.value>=${start} AND d.value<=${end}");
+    std::auto_ptr<DatabaseManager::CachedStatement> tmp;
+
+    if (resourceTypeInTags_)
+    {
+      tmp.reset(new DatabaseManager::CachedStatement(
+                  STATEMENT_FROM_HERE, manager_,
+                  "SELECT d.id FROM DicomIdentifiers AS d WHERE "
+                  "d.resourceType=${type} AND d.tagGroup=${group} "
+                  "AND d.tagElement=${element} AND d.value>=${start} AND d.value<=${end}"));
+    }
+    else
+    {
+      tmp.reset(new DatabaseManager::CachedStatement(
+                  STATEMENT_FROM_HERE, manager_,
+                  "SELECT d.id FROM DicomIdentifiers AS d, Resources AS r WHERE "
+                  "d.id = r.internalId AND r.resourceType=${type} AND d.tagGroup=${group} "
+                  "AND d.tagElement=${element} AND d.value>=${start} AND d.value<=${end}"));
+    }
+
+    DatabaseManager::CachedStatement& statement = *tmp;
       
     statement.SetReadOnly(true);
+    statement.SetStreaming(true);
+    statement.SetTimeout(lookupTimeout_);
     statement.SetParameterType("type", ValueType_Integer64);
     statement.SetParameterType("group", ValueType_Integer64);
     statement.SetParameterType("element", ValueType_Integer64);
@@ -1104,19 +1956,47 @@ namespace OrthancDatabases
 
     statement.Execute(args);
 
-    target.clear();
     while (!statement.IsDone())
     {
-      target.push_back(ReadInteger64(statement, 0));
+      target.Add(ReadInteger64(statement, 0));
       statement.Next();
     }
   }
 
+
+  void IndexBackend::LookupIdentifierRange(std::list<int64_t>& target /*out*/,
+                                           OrthancPluginResourceType resourceType,
+                                           uint16_t group,
+                                           uint16_t element,
+                                           const char* start,
+                                           const char* end)
+  {
+    ListOfIntegers sink(target);
+    LookupIdentifierRangeInternal(sink, resourceType, group, element, start, end);
+  }
+
+
+  void IndexBackend::StreamLookupIdentifierRange(OrthancPluginResourceType resourceType,
+                                                 uint16_t group,
+                                                 uint16_t element,
+                                                 const char* start,
+                                                 const char* end)
+  {
+    IntegersOutput sink(GetOutput());
+    LookupIdentifierRangeInternal(sink, resourceType, group, element, start, end);
+  }
+
     
   bool IndexBackend::LookupMetadata(std::string& target /*out*/,
                                     int64_t id,
                                     int32_t metadataType)
   {
+    const ReadAheadCache::Resource* resource = ReadAhead(id);
+    if (resource != NULL)
+    {
+      return resource->LookupMetadata(target, metadataType);
+    }
+
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
       "SELECT value FROM Metadata WHERE id=${id} and type=${type}");
@@ -1146,6 +2026,12 @@ namespace OrthancDatabases
   bool IndexBackend::LookupParent(int64_t& parentId /*out*/,
                                   int64_t resourceId)
   {
+    const ReadAheadCache::Resource* resource = ReadAhead(resourceId);
+    if (resource != NULL)
+    {
+      return resource->LookupParent(parentId);
+    }
+
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
       "SELECT parentId FROM Resources WHERE internalId=${id}");
@@ -1175,6 +2061,16 @@ namespace OrthancDatabases
                                     OrthancPluginResourceType& type /*out*/,
                                     const char* publicId)
   {
+    if (resourcesCache_.LookupResource(id, type, publicId))
+    {
+      return true;
+    }
+
+    if (!publicIdsFilter_.MayContain(publicId))
+    {
+      return false;
+    }
+
     DatabaseManager::CachedStatement statement(
       STATEMENT_FROM_HERE, manager_,
       "SELECT internalId, resourceType FROM Resources WHERE publicId=${id}");
@@ -1189,12 +2085,14 @@ namespace OrthancDatabases
 
     if (statement.IsDone())
     {
+      publicIdsFilter_.SignalFalsePositive();
       return false;
     }
     else
     {
       id = ReadInteger64(statement, 0);
       type = static_cast<OrthancPluginResourceType>(ReadInteger32(statement, 1));
+      resourcesCache_.Add(id, publicId, type);
       return true;
     }
   }
@@ -1273,7 +2171,7 @@ namespace OrthancDatabases
     args.SetIntegerValue("element", element);
     args.SetUtf8Value("value", value);
         
-    statement.Execute(args);
+    statement.ExecuteWithoutResult(args);
   }
 
     
@@ -1282,11 +2180,27 @@ namespace OrthancDatabases
                                      uint16_t element,
                                      const char* value)
   {
-    DatabaseManager::CachedStatement statement(
-      STATEMENT_FROM_HERE, manager_,
-      "INSERT INTO MainDicomTags VALUES(${id}, ${group}, ${element}, ${value})");
+    mainDicomTagsCache_.Invalidate(id);
+
+    if (resourceTypeInTags_)
+    {
+      DatabaseManager::CachedStatement statement(
+        STATEMENT_FROM_HERE, manager_,
+        "INSERT INTO MainDicomTags VALUES(${id}, ${group}, ${element}, ${value}, "
+        "(SELECT resourceType FROM Resources WHERE internalId=${id}))");
+
+      ExecuteSetTag(statement, id, group, element, value);
+    }
+    else
+    {
+      DatabaseManager::CachedStatement statement(
+        STATEMENT_FROM_HERE, manager_,
+        "INSERT INTO MainDicomTags VALUES(${id}, ${group}, ${element}, ${value})");
+
+      ExecuteSetTag(statement, id, group, element, value);
+    }
 
-    ExecuteSetTag(statement, id, group, element, value);
+    SignalModification("MainDicomTags");
   }
 
     
@@ -1295,69 +2209,42 @@ namespace OrthancDatabases
                                       uint16_t element,
                                       const char* value)
   {
-    DatabaseManager::CachedStatement statement(
-      STATEMENT_FROM_HERE, manager_,
-      "INSERT INTO DicomIdentifiers VALUES(${id}, ${group}, ${element}, ${value})");
-        
-    ExecuteSetTag(statement, id, group, element, value);
-  } 
-
-    
-  void IndexBackend::SetMetadata(int64_t id,
-                                 int32_t metadataType,
-                                 const char* value)
-  {
-    if (manager_.GetDialect() == Dialect_SQLite)
+    if (resourceTypeInTags_)
     {
       DatabaseManager::CachedStatement statement(
         STATEMENT_FROM_HERE, manager_,
-        "INSERT OR REPLACE INTO Metadata VALUES (${id}, ${type}, ${value})");
-        
-      statement.SetParameterType("id", ValueType_Integer64);
-      statement.SetParameterType("type", ValueType_Integer64);
-      statement.SetParameterType("value", ValueType_Utf8String);
-        
-      Dictionary args;
-      args.SetIntegerValue("id", id);
-      args.SetIntegerValue("type", metadataType);
-      args.SetUtf8Value("value", value);
-        
-      statement.Execute(args);
+        "INSERT INTO DicomIdentifiers VALUES(${id}, ${group}, ${element}, ${value}, "
+        "(SELECT resourceType FROM Resources WHERE internalId=${id}))");
+
+      ExecuteSetTag(statement, id, group, element, value);
     }
     else
     {
-      {
-        DatabaseManager::CachedStatement statement(
-          STATEMENT_FROM_HERE, manager_,
-          "DELETE FROM Metadata WHERE id=${id} AND type=${type}");
-        
-        statement.SetParameterType("id", ValueType_Integer64);
-        statement.SetParameterType("type", ValueType_Integer64);
-        
-        Dictionary args;
-        args.SetIntegerValue("id", id);
-        args.SetIntegerValue("type", metadataType);
+      DatabaseManager::CachedStatement statement(
+        STATEMENT_FROM_HERE, manager_,
+        "INSERT INTO DicomIdentifiers VALUES(${id}, ${group}, ${element}, ${value})");
         
-        statement.Execute(args);
-      }
+      ExecuteSetTag(statement, id, group, element, value);
+    }
 
-      {
-        DatabaseManager::CachedStatement statement(
-          STATEMENT_FROM_HERE, manager_,
-          "INSERT INTO Metadata VALUES (${id}, ${type}, ${value})");
-        
-        statement.SetParameterType("id", ValueType_Integer64);
-        statement.SetParameterType("type", ValueType_Integer64);
-        statement.SetParameterType("value", ValueType_Utf8String);
+    SignalModification("DicomIdentifiers");
+  } 
+
+    
+  void IndexBackend::SetMetadata(int64_t id,
+                                 int32_t metadataType,
+                                 const char* value)
+  {
+    DatabaseManager::CachedStatement statement(
+      STATEMENT_FROM_HERE, manager_, SET_METADATA);
         
-        Dictionary args;
-        args.SetIntegerValue("id", id);
-        args.SetIntegerValue("type", metadataType);
-        args.SetUtf8Value("value", value);
+    StatementTemplate<SetMetadataDefinition>::Arguments args;
+    args.SetInteger(SetMetadataDefinition::Parameter_Id, id);
+    args.SetInteger(SetMetadataDefinition::Parameter_Type, metadataType);
+    args.SetUtf8(SetMetadataDefinition::Parameter_Value, value);
         
-        statement.Execute(args);
-      }
-    }
+    readAhead_.Invalidate(id);
+    statement.ExecuteWithoutResult(args.GetDictionary());
   }
 
     
@@ -1375,7 +2262,8 @@ namespace OrthancDatabases
       Dictionary args;
       args.SetIntegerValue("id", internalId);
         
-      statement.Execute(args);
+      statement.ExecuteWithoutResult(args);
+      SignalModification("PatientRecyclingOrder");
     }
     else if (IsProtectedPatient(internalId))
     {
@@ -1388,7 +2276,8 @@ namespace OrthancDatabases
       Dictionary args;
       args.SetIntegerValue("id", internalId);
         
-      statement.Execute(args);
+      statement.ExecuteWithoutResult(args);
+      SignalModification("PatientRecyclingOrder");
     }
     else
     {
@@ -1432,6 +2321,8 @@ namespace OrthancDatabases
     
   void IndexBackend::ClearMainDicomTags(int64_t internalId)
   {
+    mainDicomTagsCache_.Invalidate(internalId);
+
     {
       DatabaseManager::CachedStatement statement(
         STATEMENT_FROM_HERE, manager_,
@@ -1442,7 +2333,7 @@ namespace OrthancDatabases
       Dictionary args;
       args.SetIntegerValue("id", internalId);
         
-      statement.Execute(args);
+      statement.ExecuteWithoutResult(args);
     }
 
     {
@@ -1455,7 +2346,7 @@ namespace OrthancDatabases
       Dictionary args;
       args.SetIntegerValue("id", internalId);
         
-      statement.Execute(args);
+      statement.ExecuteWithoutResult(args);
     }
   }
 
@@ -1463,72 +2354,26 @@ namespace OrthancDatabases
   // For unit testing only!
   uint64_t IndexBackend::GetResourcesCount()
   {
-    std::auto_ptr<DatabaseManager::CachedStatement> statement;
-
-    switch (manager_.GetDialect())
-    {
-      case Dialect_MySQL:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT CAST(COUNT(*) AS UNSIGNED INT) FROM Resources"));
-        break;
-        
-      case Dialect_PostgreSQL:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT CAST(COUNT(*) AS BIGINT) FROM Resources"));
-        break;
-
-      case Dialect_SQLite:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT COUNT(*) FROM Resources"));
-        break;
-
-      default:
-        throw Orthanc::OrthancException(Orthanc::ErrorCode_NotImplemented);
-    }
+    DatabaseManager::CachedStatement statement(
+      STATEMENT_FROM_HERE, GetManager(), COUNT_RESOURCES);
 
-    statement->SetReadOnly(true);
-    statement->Execute();
+    statement.SetReadOnly(true);
+    statement.Execute();
 
-    return static_cast<uint64_t>(ReadInteger64(*statement, 0));
+    return static_cast<uint64_t>(ReadInteger64(statement, 0));
   }    
 
 
   // For unit testing only!
   uint64_t IndexBackend::GetUnprotectedPatientsCount()
   {
-    std::auto_ptr<DatabaseManager::CachedStatement> statement;
-
-    switch (manager_.GetDialect())
-    {
-      case Dialect_MySQL:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT CAST(COUNT(*) AS UNSIGNED INT) FROM PatientRecyclingOrder"));
-        break;
-        
-      case Dialect_PostgreSQL:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT CAST(COUNT(*) AS BIGINT) FROM PatientRecyclingOrder"));
-        break;
-
-      case Dialect_SQLite:
-        statement.reset(new DatabaseManager::CachedStatement(
-                          STATEMENT_FROM_HERE, GetManager(),
-                          "SELECT COUNT(*) FROM PatientRecyclingOrder"));
-        break;
-
-      default:
-        throw Orthanc::OrthancException(Orthanc::ErrorCode_NotImplemented);
-    }
+    DatabaseManager::CachedStatement statement(
+      STATEMENT_FROM_HERE, GetManager(), COUNT_UNPROTECTED_PATIENTS);
 
-    statement->SetReadOnly(true);
-    statement->Execute();
+    statement.SetReadOnly(true);
+    statement.Execute();
 
-    return static_cast<uint64_t>(ReadInteger64(*statement, 0));
+    return static_cast<uint64_t>(ReadInteger64(statement, 0));
   }    
 
 
@@ -1577,4 +2422,231 @@ namespace OrthancDatabases
 
     ReadListOfStrings(childrenPublicIds, statement, args);
   }
+
+
+  void IndexBackend::GetStatistics(Json::Value& target)
+  {
+    target = Json::objectValue;
+    resourcesCache_.GetStatistics(target["ResourcesCache"]);
+    mainDicomTagsCache_.GetStatistics(target["MainDicomTagsCache"]);
+    publicIdsFilter_.GetStatistics(target["PublicIdsFilter"]);
+  }
+
+
+  void IndexBackend::SignalModification(const char* table)
+  {
+    boost::mutex::scoped_lock lock(modificationsMutex_);
+    modifications_[table] += 1;
+  }
+
+
+  void IndexBackend::GetTablesToMaintain(std::list<std::string>& target,
+                                         uint64_t threshold)
+  {
+    boost::mutex::scoped_lock lock(modificationsMutex_);
+
+    target.clear();
+
+    for (std::map<std::string, uint64_t>::const_iterator
+           it = modifications_.begin(); it != modifications_.end(); ++it)
+    {
+      if (it->second >= threshold)
+      {
+        target.push_back(it->first);
+      }
+    }
+  }
+
+
+  bool IndexBackend::MaintainTable(const std::string& table)
+  {
+    if (maintenanceDatabase_.get() == NULL)
+    {
+      maintenanceDatabase_.reset(OpenMaintenanceDatabase());
+    }
+
+    {
+      DatabaseManager::IdleLock lock(manager_);
+
+      if (!lock.IsIdle())
+      {
+        return false;  // Orthanc is busy, try again at the next round
+      }
+
+      {
+        // The modifications that happen during the maintenance will be
+        // considered by the next round
+        boost::mutex::scoped_lock lock2(modificationsMutex_);
+        modifications_.erase(table);
+      }
+
+      if (maintenanceDatabase_.get() == NULL)
+      {
+        OptimizeTable(lock.GetDatabase(), table);
+        return true;
+      }
+    }
+
+    // Orthanc was idle: The maintenance starts on the dedicated
+    // connection, and Orthanc can access the index in the meantime
+    try
+    {
+      OptimizeTable(*maintenanceDatabase_, table);
+      return true;
+    }
+    catch (Orthanc::OrthancException&)
+    {
+      // Reconnect at the next round
+      maintenanceDatabase_.reset(NULL);
+      throw;
+    }
+  }
+
+
+  bool IndexBackend::PruneLogInternal(DatabaseManager::Transaction& transaction,
+                                      const char* table,
+                                      DatabaseManager::CachedStatement& oldest,
+                                      DatabaseManager::CachedStatement& newest,
+                                      DatabaseManager::CachedStatement& remove,
+                                      uint64_t maxCount,
+                                      uint64_t maxAge,
+                                      uint32_t batchSize)
+  {
+    oldest.SetReadOnly(true);
+    oldest.Execute();
+
+    if (oldest.IsDone())
+    {
+      return false;  // The log is empty
+    }
+
+    const int64_t oldestSeq = ReadInteger64(oldest, 0);
+    const std::string oldestDate = ReadString(oldest, 1);
+
+    int64_t seqLimit = 0;  // Keep all the entries
+    if (maxCount != 0)
+    {
+      newest.SetReadOnly(true);
+      newest.Execute();
+
+      if (!newest.IsDone())
+      {
+        seqLimit = ReadInteger64(newest, 0) - static_cast<int64_t>(maxCount) + 1;
+      }
+    }
+
+    std::string dateLimit;  // Keep all the entries (no date is below the empty string)
+    if (maxAge != 0)
+    {
+      // Same format as "Orthanc::SystemToolbox::GetNowIsoString()",
+      // which can be compared lexicographically
+      dateLimit = boost::posix_time::to_iso_string(
+        boost::posix_time::second_clock::local_time() -
+        boost::posix_time::seconds(static_cast<long>(maxAge)));
+    }
+
+    if (oldestSeq >= seqLimit &&
+        oldestDate >= dateLimit)
+    {
+      return false;  // Nothing to be removed
+    }
+
+    if (DropLogPartitions(transaction, table, seqLimit, dateLimit))
+    {
+      return true;  // The oldest entries were removed at once, look again
+    }
+
+    // As "seq" is the primary key, the removal of one batch is a
+    // range scan whose cost does not depend on the size of the log
+    remove.SetParameterType("end", ValueType_Integer64);
+    remove.SetParameterType("seq", ValueType_Integer64);
+    remove.SetParameterType("date", ValueType_Utf8String);
+
+    Dictionary args;
+    args.SetIntegerValue("end", oldestSeq + static_cast<int64_t>(batchSize));
+    args.SetIntegerValue("seq", seqLimit);
+    args.SetUtf8Value("date", dateLimit);
+
+    remove.Execute(args);
+
+    return true;
+  }
+
+
+  bool IndexBackend::PruneChanges(uint64_t maxCount,
+                                  uint64_t maxAge,
+                                  uint32_t batchSize)
+  {
+    DatabaseManager::IdleLock lock(manager_);
+
+    if (!lock.IsIdle())
+    {
+      return false;  // Orthanc is busy, try again at the next round
+    }
+
+    bool more;
+
+    DatabaseManager::Transaction transaction(manager_);
+
+    {
+      DatabaseManager::CachedStatement oldest(
+        STATEMENT_FROM_HERE, transaction,
+        "SELECT seq, date FROM Changes ORDER BY seq LIMIT 1");
+
+      DatabaseManager::CachedStatement newest(
+        STATEMENT_FROM_HERE, transaction,
+        "SELECT seq FROM Changes ORDER BY seq DESC LIMIT 1");
+
+      DatabaseManager::CachedStatement remove(
+        STATEMENT_FROM_HERE, transaction,
+        "DELETE FROM Changes WHERE seq<${end} AND (seq<${seq} OR date<${date})");
+
+      more = PruneLogInternal(transaction, "Changes", oldest, newest, remove,
+                              maxCount, maxAge, batchSize);
+    }
+
+    transaction.Commit();
+    SignalModification("Changes");
+
+    return more;
+  }
+
+
+  bool IndexBackend::PruneExportedResources(uint64_t maxCount,
+                                            uint64_t maxAge,
+                                            uint32_t batchSize)
+  {
+    DatabaseManager::IdleLock lock(manager_);
+
+    if (!lock.IsIdle())
+    {
+      return false;  // Orthanc is busy, try again at the next round
+    }
+
+    bool more;
+
+    DatabaseManager::Transaction transaction(manager_);
+
+    {
+      DatabaseManager::CachedStatement oldest(
+        STATEMENT_FROM_HERE, transaction,
+        "SELECT seq, date FROM ExportedResources ORDER BY seq LIMIT 1");
+
+      DatabaseManager::CachedStatement newest(
+        STATEMENT_FROM_HERE, transaction,
+        "SELECT seq FROM ExportedResources ORDER BY seq DESC LIMIT 1");
+
+      DatabaseManager::CachedStatement remove(
+        STATEMENT_FROM_HERE, transaction,
+        "DELETE FROM ExportedResources WHERE seq<${end} AND (seq<${seq} OR date<${date})");
+
+      more = PruneLogInternal(transaction, "ExportedResources", oldest, newest, remove,
+                              maxCount, maxAge, batchSize);
+    }
+
+    transaction.Commit();
+    SignalModification("ExportedResources");
+
+    return more;
+  }
 }
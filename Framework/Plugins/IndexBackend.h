@@ -22,7 +22,15 @@
 #pragma once
 
 #include "../Common/DatabaseManager.h"
+#include "ChangesFeed.h"
+#include "MainDicomTagsCache.h"
 #include "OrthancCppDatabasePlugin.h"
+#include "PublicIdsFilter.h"
+#include "ReadAheadCache.h"
+#include "ResourcesCache.h"
+
+#include <boost/thread/mutex.hpp>
+#include <map>
 
 
 namespace OrthancDatabases
@@ -30,7 +38,37 @@ namespace OrthancDatabases
   class IndexBackend : public OrthancPlugins::IDatabaseBackend
   {
   private:
-    DatabaseManager   manager_;
+    // Maps the offset of a page returned by "GetAllPublicIds()" (for
+    // some resource type) to the last "internalId" before this offset
+    typedef std::map<std::pair<int32_t, uint64_t>, int64_t>  PagesIndex;
+
+    DatabaseManager     manager_;
+    PagesIndex          pagesIndex_;
+    bool                pagesIndexEnabled_;
+    ChangesFeed*        changesFeed_;     // Not owned
+    bool                pendingChanges_;
+    ResourcesCache      resourcesCache_;
+    MainDicomTagsCache  mainDicomTagsCache_;
+    bool                crossCheckMainDicomTags_;
+    ReadAheadCache      readAhead_;
+    bool                inTransaction_;
+    PublicIdsFilter     publicIdsFilter_;
+    unsigned int        lookupTimeout_;
+    bool                resourceTypeInTags_;
+
+    // Number of the statements that have modified each table since
+    // its last maintenance (cf. "MaintainTable()")
+    boost::mutex                     modificationsMutex_;
+    std::map<std::string, uint64_t>  modifications_;
+
+    // Connection that is dedicated to the maintenance of the tables
+    // (only accessed by the thread of "IndexMaintenance")
+    std::auto_ptr<IDatabase>         maintenanceDatabase_;
+
+    // Connection that is dedicated to the rebuilds of the filter of
+    // the public IDs (only accessed by the thread of
+    // "PublicIdsFilterRebuilder")
+    std::auto_ptr<IDatabase>         publicIdsDatabase_;
 
   protected:
     DatabaseManager& GetManager()
@@ -38,14 +76,55 @@ namespace OrthancDatabases
       return manager_;
     }
     
+    // To be called while opening the database, if the tables
+    // "MainDicomTags" and "DicomIdentifiers" have a 5th column
+    // "resourceType" (typically to partition them by level). The
+    // lookups then avoid joining the "Resources" table.
+    void SetResourceTypeInTags(bool resourceTypeInTags)
+    {
+      resourceTypeInTags_ = resourceTypeInTags;
+    }
+
     static int64_t ReadInteger64(const DatabaseManager::CachedStatement& statement,
                                  size_t field);
 
     static int32_t ReadInteger32(const DatabaseManager::CachedStatement& statement,
                                  size_t field);
     
-    static std::string ReadString(const DatabaseManager::CachedStatement& statement,
-                                  size_t field);
+    // The reference is valid until the statement moves to the next row
+    static const std::string& ReadString(const DatabaseManager::CachedStatement& statement,
+                                         size_t field);
+
+    // Destination of the rows of the statements that list integers:
+    // Either a "std::list", or directly the answers to Orthanc
+    class IIntegersSink : public boost::noncopyable
+    {
+    public:
+      virtual ~IIntegersSink()
+      {
+      }
+
+      virtual void Add(int64_t value) = 0;
+    };
+
+    // Same as "IIntegersSink", for the statements that list strings
+    class IStringsSink : public boost::noncopyable
+    {
+    public:
+      virtual ~IStringsSink()
+      {
+      }
+
+      virtual void Add(const std::string& value) = 0;
+    };
+
+    static void ReadIntegers(IIntegersSink& target,
+                             DatabaseManager::CachedStatement& statement,
+                             const Dictionary& args);
+
+    static void ReadStrings(IStringsSink& target,
+                            DatabaseManager::CachedStatement& statement,
+                            const Dictionary& args);
     
     template <typename T>
     static void ReadListOfIntegers(std::list<T>& target,
@@ -64,7 +143,96 @@ namespace OrthancDatabases
 
     void SignalDeletedResources();
 
+    void ClearPagesIndex()
+    {
+      pagesIndex_.clear();
+    }
+
+    // To be invoked by "CreateResource()"
+    void CacheResource(int64_t id,
+                       const char* publicId,
+                       OrthancPluginResourceType type)
+    {
+      resourcesCache_.Add(id, publicId, type);
+      readAhead_.Invalidate(id);
+      publicIdsFilter_.Add(publicId);
+    }
+
+    void ClearResourcesCache()
+    {
+      resourcesCache_.Clear();
+    }
+
+    void ClearMainDicomTagsCache()
+    {
+      mainDicomTagsCache_.Clear();
+    }
+
+    void ClearReadAhead()
+    {
+      readAhead_.Clear();
+    }
+
+    // Whether one of the caches that are indexed by internal ID has
+    // to be updated when resources are deleted
+    bool IsCachingResources();
+
+    // Removes one resource from the caches that are indexed by
+    // internal ID (SQLite reuses the IDs of the deleted resources)
+    void InvalidateResource(int64_t id);
+
+    // Same as "InvalidateResource()" for "id", whose level is "level",
+    // and all its descendants. To be invoked by "DeleteResource()"
+    // before the deletion, as the descendants are deleted by cascade.
+    void InvalidateDescendants(int64_t id,
+                               OrthancPluginResourceType level);
+
+    // To be invoked by "DeleteResource()" in the backends that do not
+    // report the deleted resources through "SignalDeletedResources()",
+    // with the topmost resource to be deleted, before its deletion
+    void ForgetDeletedResources(int64_t id);
+
+    // To be invoked after each statement that writes to "table"
+    void SignalModification(const char* table);
+
+    // Runs the maintenance commands of the database engine on one
+    // table (e.g. "VACUUM" or "ANALYZE"). This is called outside of
+    // any transaction, on the connection that is returned by
+    // "OpenMaintenanceDatabase()".
+    virtual void OptimizeTable(IDatabase& database,
+                               const std::string& table) = 0;
+
+    // Opens a new connection to the database, that is dedicated to
+    // one background task (the maintenance or the rebuilds of the
+    // filter of the public IDs), so that this task does not block the
+    // accesses of Orthanc to the index. Returns "NULL" if the engine
+    // cannot do this, in which case the task runs on the main
+    // connection, while Orthanc is not accessing the index.
+    virtual IDatabase* OpenMaintenanceDatabase()
+    {
+      return NULL;
+    }
+
+    // Removes at once the oldest entries of the log "table"
+    // ("Changes" or "ExportedResources") that are below "seqLimit" or
+    // older than "dateLimit", if the engine partitions this table.
+    // Returns "true" iff some entries were removed. This is invoked
+    // by "PruneChanges()" and "PruneExportedResources()", before the
+    // removal of the entries row by row.
+    virtual bool DropLogPartitions(DatabaseManager::Transaction& transaction,
+                                   const char* table,
+                                   int64_t seqLimit,
+                                   const std::string& dateLimit)
+    {
+      return false;
+    }
+
   private:
+    class ListOfIntegers;
+    class ListOfStrings;
+    class IntegersOutput;
+    class StringsOutput;
+
     void ReadChangesInternal(bool& done,
                              DatabaseManager::CachedStatement& statement,
                              const Dictionary& args,
@@ -75,16 +243,87 @@ namespace OrthancDatabases
                                        const Dictionary& args,
                                        uint32_t maxResults);
 
+    uint64_t ReadGlobalInteger(int property);
+
+    void ReadMainDicomTags(MainDicomTagsCache::Tags& target,
+                           int64_t id);
+
+    // Reads the parent, the attachments and the metadata of the
+    // resource at once, the first time it is accessed during the
+    // current transaction. Returns "NULL" outside of a transaction.
+    const ReadAheadCache::Resource* ReadAhead(int64_t id);
+
+    // Builds the filter of the public IDs on the main connection
+    // (does nothing if the filter is disabled). To be invoked while
+    // Orthanc is not accessing the index.
+    void RebuildPublicIdsFilter();
+
+    // Streams the "Resources" table from "database" into a new filter
+    // of the public IDs, then swaps it in. To be invoked after
+    // "PublicIdsFilter::StartRebuild()".
+    void BuildPublicIdsFilter(IDatabase& database,
+                              uint64_t expectedCount);
+
+    // The SQL statements that are shared by the list-based and by
+    // the streaming methods of "IDatabaseBackend"
+    void GetAllInternalIdsInternal(IIntegersSink& target,
+                                   OrthancPluginResourceType resourceType);
+
+    void GetAllPublicIdsInternal(IStringsSink& target,
+                                 OrthancPluginResourceType resourceType);
+
+    void GetAllPublicIdsInternal(IStringsSink& target,
+                                 OrthancPluginResourceType resourceType,
+                                 uint64_t since,
+                                 uint64_t limit);
+
+    void GetChildrenInternalIdInternal(IIntegersSink& target,
+                                       int64_t id);
+
+    void GetChildrenPublicIdInternal(IStringsSink& target,
+                                     int64_t id);
+
+    void LookupIdentifierInternal(IIntegersSink& target,
+                                  OrthancPluginResourceType resourceType,
+                                  uint16_t group,
+                                  uint16_t element,
+                                  OrthancPluginIdentifierConstraint constraint,
+                                  const char* value);
+
+    void LookupIdentifierRangeInternal(IIntegersSink& target,
+                                       OrthancPluginResourceType resourceType,
+                                       uint16_t group,
+                                       uint16_t element,
+                                       const char* start,
+                                       const char* end);
+
+    bool PruneLogInternal(DatabaseManager::Transaction& transaction,
+                          const char* table,
+                          DatabaseManager::CachedStatement& oldest,
+                          DatabaseManager::CachedStatement& newest,
+                          DatabaseManager::CachedStatement& remove,
+                          uint64_t maxCount,
+                          uint64_t maxAge,
+                          uint32_t batchSize);
+
   public:
     IndexBackend(IDatabaseFactory* factory);
     
     virtual void Open()
     {
+      ClearPagesIndex();
+      ClearResourcesCache();
+      ClearMainDicomTagsCache();
+      ClearReadAhead();
+      inTransaction_ = false;
       manager_.Open();
+      RebuildPublicIdsFilter();
     }
     
     virtual void Close()
     {
+      ClearReadAhead();
+      inTransaction_ = false;
       manager_.Close();
     }
     
@@ -220,19 +459,23 @@ namespace OrthancDatabases
     virtual void StartTransaction()
     {
       manager_.StartTransaction();
+      inTransaction_ = true;
     }
 
     
     virtual void RollbackTransaction()
     {
+      ClearPagesIndex();
+      ClearResourcesCache();  // The cache might contain resources that are rolled back
+      ClearMainDicomTagsCache();
+      ClearReadAhead();
+      inTransaction_ = false;
+      pendingChanges_ = false;
       manager_.RollbackTransaction();
     }
 
     
-    virtual void CommitTransaction()
-    {
-      manager_.CommitTransaction();
-    }
+    virtual void CommitTransaction();
 
     
     virtual uint32_t GetDatabaseVersion();
@@ -242,6 +485,142 @@ namespace OrthancDatabases
     
     virtual void ClearMainDicomTags(int64_t internalId);
 
+    virtual void StreamAllInternalIds(OrthancPluginResourceType resourceType);
+
+    virtual void StreamAllPublicIds(OrthancPluginResourceType resourceType);
+
+    virtual void StreamAllPublicIds(OrthancPluginResourceType resourceType,
+                                    uint64_t since,
+                                    uint64_t limit);
+
+    virtual void StreamChildrenInternalId(int64_t id);
+
+    virtual void StreamChildrenPublicId(int64_t id);
+
+    virtual void StreamLookupIdentifier(OrthancPluginResourceType resourceType,
+                                        uint16_t group,
+                                        uint16_t element,
+                                        OrthancPluginIdentifierConstraint constraint,
+                                        const char* value);
+
+    virtual void StreamLookupIdentifierRange(OrthancPluginResourceType resourceType,
+                                             uint16_t group,
+                                             uint16_t element,
+                                             const char* start,
+                                             const char* end);
+
+    /**
+     * Removes (at most) "batchSize" of the oldest entries of the
+     * "Changes" table that are not among the "maxCount" most recent
+     * changes, or that are older than "maxAge" seconds ("0" means no
+     * limit). Returns "true" iff another batch should be removed.
+     * This is invoked by the background thread of "LogsRetention",
+     * and does nothing if Orthanc is running a transaction.
+     **/
+    bool PruneChanges(uint64_t maxCount,
+                      uint64_t maxAge,
+                      uint32_t batchSize);
+
+    // Same as "PruneChanges()", for the "ExportedResources" table
+    bool PruneExportedResources(uint64_t maxCount,
+                                uint64_t maxAge,
+                                uint32_t batchSize);
+
+    // Lists the tables that were modified by at least "threshold"
+    // statements since their last maintenance
+    void GetTablesToMaintain(std::list<std::string>& target,
+                             uint64_t threshold);
+
+    /**
+     * Resets the count of the modifications of the table, then calls
+     * "OptimizeTable()". Returns "false" if Orthanc is running a
+     * transaction, in which case the maintenance is to be retried
+     * later. Once it has started, the maintenance does not prevent
+     * Orthanc from accessing the index, if the engine supports
+     * "OpenMaintenanceDatabase()". This is invoked by the background
+     * thread of "IndexMaintenance".
+     **/
+    bool MaintainTable(const std::string& table);
+
+    /**
+     * Rebuilds the filter of the public IDs if it is not sized for
+     * the current content of the index anymore. The "Resources"
+     * table is read on the connection that is returned by
+     * "OpenMaintenanceDatabase()", while the current filter remains
+     * in use. Returns "false" if Orthanc is running a transaction, in
+     * which case the rebuild is to be retried later. This is invoked
+     * by the background thread of "PublicIdsFilterRebuilder".
+     **/
+    bool RefreshPublicIdsFilter();
+
+    // The feed is signalled once the new changes are committed. This
+    // is not needed if the database notifies the changes by itself.
+    void SetChangesFeed(ChangesFeed& feed)
+    {
+      changesFeed_ = &feed;
+    }
+
+    // Cf. "DatabaseManager::SetMaxCachedStatements()"
+    void SetMaxPreparedStatements(unsigned int count)
+    {
+      manager_.SetMaxCachedStatements(count);
+    }
+
+    // Maximum number of resources whose public ID and internal ID are
+    // cached ("0" disables the cache). The cache must be disabled if
+    // other instances of Orthanc write to the same database.
+    void SetResourcesCacheSize(unsigned int size)
+    {
+      resourcesCache_.SetMaxSize(size);
+    }
+
+    // Memory that is used to cache the main DICOM tags of the most
+    // recently read resources ("0" disables the cache). Same remark
+    // as for "SetResourcesCacheSize()".
+    void SetMainDicomTagsCacheSize(size_t bytes)
+    {
+      mainDicomTagsCache_.SetMaxMemory(bytes);
+    }
+
+    // Bloom filter over the public IDs, that avoids the database for
+    // the lookups of new resources. Same remark as for
+    // "SetResourcesCacheSize()".
+    void SetPublicIdsFilter(bool enabled)
+    {
+      publicIdsFilter_.SetEnabled(enabled);
+    }
+
+    // Keyset pagination of "GetAllPublicIds()" (enabled by default).
+    // The offsets of the pages that were returned are only valid as
+    // long as this process is the only writer, which guarantees that
+    // the resources are created in the order of their internal IDs
+    // and that their deletions are seen: It must be disabled if other
+    // instances of Orthanc write to the same database.
+    void SetPagesIndex(bool enabled)
+    {
+      pagesIndexEnabled_ = enabled;
+      ClearPagesIndex();
+    }
+
+    // Maximum execution time of the lookups of identifiers, in
+    // milliseconds ("0" means no limit), after which Orthanc receives
+    // "ErrorCode_Timeout". Prevents a pathological wildcard search
+    // from locking the database. Must be set before the first lookup.
+    void SetLookupTimeout(unsigned int milliseconds)
+    {
+      lookupTimeout_ = milliseconds;
+    }
+
+    // Can be invoked from any thread
+    virtual void GetStatistics(Json::Value& target);
+
+
+    // For unit testing only! Each answer from the cache of the main
+    // DICOM tags is compared with the content of the database.
+    void SetMainDicomTagsCrossCheck(bool crossCheck)
+    {
+      crossCheckMainDicomTags_ = crossCheck;
+    }
 
     // For unit testing only!
     virtual uint64_t GetResourcesCount();
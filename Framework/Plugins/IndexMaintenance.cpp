@@ -0,0 +1,178 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "IndexMaintenance.h"
+
+#include <Core/Logging.h>
+#include <Core/OrthancException.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace OrthancDatabases
+{
+  void IndexMaintenance::RunRound()
+  {
+    const unsigned int hour = static_cast<unsigned int>(
+      boost::posix_time::second_clock::local_time().time_of_day().hours());
+
+    if (!IsQuietHour(hour))
+    {
+      return;
+    }
+
+    std::list<std::string> tables;
+    backend_.GetTablesToMaintain(tables, threshold_);
+
+    for (std::list<std::string>::const_iterator
+           it = tables.begin(); it != tables.end() && !ShouldStop(); ++it)
+    {
+      if (!backend_.MaintainTable(*it))
+      {
+        break;  // Orthanc is busy, try again at the next round
+      }
+    }
+  }
+
+
+  IndexMaintenance::IndexMaintenance(IndexBackend& backend) :
+    PeriodicWorker("maintenance thread of the index"),
+    backend_(backend),
+    threshold_(0),
+    hasQuietHours_(false),
+    startHour_(0),
+    endHour_(0),
+    period_(60)
+  {
+  }
+
+
+  IndexMaintenance::~IndexMaintenance()
+  {
+    Stop();
+  }
+
+
+  void IndexMaintenance::ReadConfiguration(const OrthancPlugins::OrthancConfiguration& configuration)
+  {
+    unsigned int value;
+
+    if (configuration.LookupUnsignedIntegerValue(value, "MaintenanceThreshold"))
+    {
+      SetThreshold(value);
+    }
+
+    unsigned int start, end;
+    if (configuration.LookupUnsignedIntegerValue(start, "MaintenanceStartHour") &&
+        configuration.LookupUnsignedIntegerValue(end, "MaintenanceEndHour"))
+    {
+      SetQuietHours(start, end);
+    }
+    else if (threshold_ != 0)
+    {
+      LOG(WARNING) << "The maintenance of the index is disabled, as the options "
+                   << "\"MaintenanceStartHour\" and \"MaintenanceEndHour\" are not both set";
+    }
+  }
+
+
+  void IndexMaintenance::SetThreshold(uint64_t count)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    threshold_ = count;
+  }
+
+
+  void IndexMaintenance::SetQuietHours(unsigned int start,
+                                       unsigned int end)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+    else if (start >= 24 ||
+             end >= 24)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+    }
+
+    hasQuietHours_ = true;
+    startHour_ = start;
+    endHour_ = end;
+  }
+
+
+  bool IndexMaintenance::IsQuietHour(unsigned int hour) const
+  {
+    if (!hasQuietHours_)
+    {
+      return false;
+    }
+    else if (startHour_ == endHour_)
+    {
+      return true;
+    }
+    else if (startHour_ < endHour_)
+    {
+      return (hour >= startHour_ &&
+              hour < endHour_);
+    }
+    else
+    {
+      // The interval wraps around midnight
+      return (hour >= startHour_ ||
+              hour < endHour_);
+    }
+  }
+
+
+  void IndexMaintenance::SetPeriod(unsigned int seconds)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+    else if (seconds == 0)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+    }
+
+    period_ = seconds;
+  }
+
+
+  void IndexMaintenance::Start()
+  {
+    if (IsEnabled())
+    {
+      StartWorker(1000 * period_);
+    }
+  }
+
+
+  void IndexMaintenance::Stop()
+  {
+    StopWorker();
+  }
+}
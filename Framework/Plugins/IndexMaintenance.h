@@ -0,0 +1,93 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include "IndexBackend.h"
+#include "PeriodicWorker.h"
+
+#include <Plugins/Samples/Common/OrthancPluginCppWrapper.h>
+
+namespace OrthancDatabases
+{
+  /**
+   * Background thread that runs the maintenance commands of the
+   * database engine (e.g. "VACUUM" or "ANALYZE") on the tables that
+   * were modified by many statements, so as to reclaim the space of
+   * the deleted rows and to refresh the statistics of the planner.
+   * The maintenance only runs during the quiet hours, that must be
+   * explicitly configured.
+   **/
+  class IndexMaintenance : public PeriodicWorker
+  {
+  private:
+    IndexBackend&  backend_;
+    uint64_t       threshold_;
+    bool           hasQuietHours_;
+    unsigned int   startHour_;
+    unsigned int   endHour_;
+    unsigned int   period_;
+
+  protected:
+    virtual void RunRound();
+
+  public:
+    explicit IndexMaintenance(IndexBackend& backend);
+
+    virtual ~IndexMaintenance();
+
+    // Parses the "MaintenanceThreshold", "MaintenanceStartHour" and
+    // "MaintenanceEndHour" options
+    void ReadConfiguration(const OrthancPlugins::OrthancConfiguration& configuration);
+
+    // Number of the modifications of a table that trigger its
+    // maintenance ("0" disables the maintenance)
+    void SetThreshold(uint64_t count);
+
+    // The maintenance only runs between these hours of the local
+    // time (from 0 to 23, the end being excluded). The interval can
+    // wrap around midnight. The same start and end hours mean that
+    // the maintenance can run at any time. As long as this method is
+    // not called, the maintenance never runs.
+    void SetQuietHours(unsigned int start,
+                       unsigned int end);
+
+    bool HasQuietHours() const
+    {
+      return hasQuietHours_;
+    }
+
+    bool IsQuietHour(unsigned int hour) const;
+
+    // Number of seconds between two checks of the modified tables
+    void SetPeriod(unsigned int seconds);
+
+    bool IsEnabled() const
+    {
+      return (threshold_ != 0 &&
+              hasQuietHours_);
+    }
+
+    void Start();
+
+    void Stop();
+  };
+}
@@ -0,0 +1,110 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "IndexStatistics.h"
+
+#include <Core/OrthancException.h>
+
+#include <json/writer.h>
+
+namespace OrthancDatabases
+{
+  static IndexStatistics* registeredStatistics_ = NULL;
+
+
+  static OrthancPluginErrorCode ServeIndexStatistics(OrthancPluginRestOutput* output,
+                                                     const char* url,
+                                                     const OrthancPluginHttpRequest* request)
+  {
+    try
+    {
+      if (registeredStatistics_ == NULL)
+      {
+        return OrthancPluginErrorCode_BadSequenceOfCalls;
+      }
+
+      registeredStatistics_->Answer(output, request);
+      return OrthancPluginErrorCode_Success;
+    }
+    catch (Orthanc::OrthancException& e)
+    {
+      return static_cast<OrthancPluginErrorCode>(e.GetErrorCode());
+    }
+    catch (...)
+    {
+      return OrthancPluginErrorCode_Plugin;
+    }
+  }
+
+
+  IndexStatistics::IndexStatistics(OrthancPluginContext* context,
+                                   IndexBackend& backend) :
+    context_(context),
+    backend_(backend)
+  {
+    if (context == NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_NullPointer);
+    }
+  }
+
+
+  IndexStatistics::~IndexStatistics()
+  {
+    if (registeredStatistics_ == this)
+    {
+      registeredStatistics_ = NULL;
+    }
+  }
+
+
+  void IndexStatistics::Register(const std::string& uri)
+  {
+    if (registeredStatistics_ != NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    registeredStatistics_ = this;
+
+    // The statistics are read without the global lock of the plugin,
+    // so that they can be monitored while Orthanc is busy
+    OrthancPluginRegisterRestCallbackNoLock(context_, uri.c_str(), ServeIndexStatistics);
+  }
+
+
+  void IndexStatistics::Answer(OrthancPluginRestOutput* output,
+                               const OrthancPluginHttpRequest* request)
+  {
+    if (request->method != OrthancPluginHttpMethod_Get)
+    {
+      OrthancPluginSendMethodNotAllowed(context_, output, "GET");
+      return;
+    }
+
+    Json::Value statistics;
+    backend_.GetStatistics(statistics);
+
+    Json::StyledWriter writer;
+    const std::string s = writer.write(statistics);
+    OrthancPluginAnswerBuffer(context_, output, s.c_str(), s.size(), "application/json");
+  }
+}
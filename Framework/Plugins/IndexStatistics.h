@@ -0,0 +1,54 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include "IndexBackend.h"
+
+#include <boost/noncopyable.hpp>
+#include <string>
+
+namespace OrthancDatabases
+{
+  /**
+   * The REST route registered by this class answers "GET {uri}" with
+   * the statistics of the caches of the index backend, as a JSON
+   * object (cf. "IndexBackend::GetStatistics()").
+   **/
+  class IndexStatistics : public boost::noncopyable
+  {
+  private:
+    OrthancPluginContext*  context_;
+    IndexBackend&          backend_;
+
+  public:
+    IndexStatistics(OrthancPluginContext* context,
+                    IndexBackend& backend);
+
+    ~IndexStatistics();
+
+    // Only one instance can be registered by a plugin
+    void Register(const std::string& uri);
+
+    void Answer(OrthancPluginRestOutput* output,
+                const OrthancPluginHttpRequest* request);
+  };
+}
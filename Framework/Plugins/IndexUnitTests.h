@@ -32,7 +32,10 @@
 
 static std::auto_ptr<OrthancPluginAttachment>  expectedAttachment;
 static std::list<OrthancPluginDicomTag>  expectedDicomTags;
+static unsigned int  countDicomTags = 0;
 static std::auto_ptr<OrthancPluginExportedResource>  expectedExported;
+static std::list<std::string>  answeredStrings;
+static std::list<int64_t>  answeredIntegers;
 
 static void CheckAttachment(const OrthancPluginAttachment& attachment)
 {
@@ -60,6 +63,8 @@ static void CheckExportedResource(const OrthancPluginExportedResource& exported)
 
 static void CheckDicomTag(const OrthancPluginDicomTag& tag)
 {
+  countDicomTags++;
+
   for (std::list<OrthancPluginDicomTag>::const_iterator
          it = expectedDicomTags.begin(); it != expectedDicomTags.end(); ++it)
   {
@@ -112,6 +117,14 @@ static OrthancPluginErrorCode InvokeService(struct _OrthancPluginContext_t* cont
         break;
       }
 
+      case _OrthancPluginDatabaseAnswerType_String:
+        answeredStrings.push_back(answer.valueString);
+        break;
+
+      case _OrthancPluginDatabaseAnswerType_Int64:
+        answeredIntegers.push_back(answer.valueInt64);
+        break;
+
       default:
         printf("Unhandled message: %d\n", answer.type);
         break;
@@ -147,6 +160,7 @@ TEST(IndexBackend, Basic)
 #endif
 
   db.RegisterOutput(new OrthancPlugins::DatabaseBackendOutput(&context, NULL));
+  db.SetMainDicomTagsCrossCheck(true);
   db.Open();
   
 
@@ -234,6 +248,23 @@ TEST(IndexBackend, Basic)
   ASSERT_TRUE(ci.back() == b || ci.back() == c);
   ASSERT_NE(ci.front(), ci.back());
 
+  // The streaming variants answer the same rows as the lists
+  answeredStrings.clear();
+  db.StreamChildrenPublicId(a);
+  answeredStrings.sort();
+  cp.sort();
+  ASSERT_TRUE(answeredStrings == cp);
+
+  answeredIntegers.clear();
+  db.StreamChildrenInternalId(a);
+  answeredIntegers.sort();
+  ci.sort();
+  ASSERT_TRUE(answeredIntegers == ci);
+
+  answeredStrings.clear();
+  db.StreamAllPublicIds(OrthancPluginResourceType_Series);
+  ASSERT_EQ(2u, answeredStrings.size());
+
   db.SetMetadata(a, Orthanc::MetadataType_ModifiedFrom, "modified");
   db.SetMetadata(a, Orthanc::MetadataType_LastUpdate, "update2");
   ASSERT_FALSE(db.LookupMetadata(s, b, Orthanc::MetadataType_LastUpdate));
@@ -327,9 +358,45 @@ TEST(IndexBackend, Basic)
   db.ListAvailableAttachments(fc, a);
   ASSERT_EQ(1u, fc.size());
   ASSERT_EQ(Orthanc::FileContentType_DicomAsJson, fc.front());
+  ASSERT_EQ(4242u, db.GetTotalCompressedSize());
+  ASSERT_EQ(4242u, db.GetTotalUncompressedSize());
   db.DeleteAttachment(a, Orthanc::FileContentType_DicomAsJson);
   db.ListAvailableAttachments(fc, a);
   ASSERT_EQ(0u, fc.size());
+  ASSERT_EQ(0u, db.GetTotalCompressedSize());
+  ASSERT_EQ(0u, db.GetTotalUncompressedSize());
+
+  {
+    // Within a transaction, the reads are answered by the read-ahead
+    // cache, that must be invalidated by the writes
+    db.StartTransaction();
+
+    int64_t parent;
+    ASSERT_TRUE(db.LookupParent(parent, b));
+    ASSERT_EQ(a, parent);
+    ASSERT_FALSE(db.LookupParent(parent, a));
+
+    db.ListAvailableMetadata(md, a);
+    ASSERT_EQ(1u, md.size());
+    ASSERT_TRUE(db.LookupMetadata(mdd, a, Orthanc::MetadataType_ModifiedFrom));
+    ASSERT_EQ("modified", mdd);
+    ASSERT_FALSE(db.LookupMetadata(mdd, a, Orthanc::MetadataType_LastUpdate));
+    db.SetMetadata(a, Orthanc::MetadataType_LastUpdate, "update3");
+    ASSERT_TRUE(db.LookupMetadata(mdd, a, Orthanc::MetadataType_LastUpdate));
+    ASSERT_EQ("update3", mdd);
+    db.DeleteMetadata(a, Orthanc::MetadataType_LastUpdate);
+    ASSERT_FALSE(db.LookupMetadata(mdd, a, Orthanc::MetadataType_LastUpdate));
+
+    ASSERT_FALSE(db.LookupAttachment(a, Orthanc::FileContentType_DicomAsJson));
+    db.AddAttachment(a, a2);
+    db.ListAvailableAttachments(fc, a);
+    ASSERT_EQ(1u, fc.size());
+    ASSERT_TRUE(db.LookupAttachment(a, Orthanc::FileContentType_DicomAsJson));
+    db.DeleteAttachment(a, Orthanc::FileContentType_DicomAsJson);
+    ASSERT_FALSE(db.LookupAttachment(a, Orthanc::FileContentType_DicomAsJson));
+
+    db.CommitTransaction();
+  }
 
 
   db.SetIdentifierTag(a, 0x0010, 0x0020, "patient");
@@ -346,6 +413,22 @@ TEST(IndexBackend, Basic)
   expectedDicomTags.back().value = "study";
   db.GetMainDicomTags(a);
 
+  db.SetMainDicomTag(b, 0x0010, 0x0020, "patient");
+  db.SetMainDicomTag(b, 0x0020, 0x000d, "study");
+
+  for (unsigned int i = 0; i < 2; i++)
+  {
+    // The second read is answered by the cache of the main DICOM tags
+    countDicomTags = 0;
+    db.GetMainDicomTags(b);
+    ASSERT_EQ(2u, countDicomTags);
+  }
+
+  db.ClearMainDicomTags(b);
+  countDicomTags = 0;
+  db.GetMainDicomTags(b);
+  ASSERT_EQ(0u, countDicomTags);
+
 
   db.LookupIdentifier(ci, OrthancPluginResourceType_Study, 0x0010, 0x0020, 
                       OrthancPluginIdentifierConstraint_Equal, "patient");
@@ -374,6 +457,18 @@ TEST(IndexBackend, Basic)
 
   bool done;
   db.GetExportedResources(done, 0, 10);
+
+  db.LogExportedResource(exp);
+  db.LogExportedResource(exp);
+  ASSERT_TRUE(db.PruneExportedResources(1, 0, 1));   // Removes seq == 1
+  ASSERT_TRUE(db.PruneExportedResources(1, 0, 10));  // Removes seq == 2
+  ASSERT_FALSE(db.PruneExportedResources(1, 0, 10));
+  ASSERT_FALSE(db.PruneExportedResources(0, 0, 10));
+
+  expectedExported->seq = 3;
+  db.GetExportedResources(done, 0, 10);
+  ASSERT_TRUE(done);
+  db.GetLastExportedResource();
   
 
   db.GetAllPublicIds(pub, OrthancPluginResourceType_Patient); ASSERT_EQ(0u, pub.size());
@@ -385,6 +480,10 @@ TEST(IndexBackend, Basic)
   ASSERT_EQ(0u, db.GetUnprotectedPatientsCount());  // No patient was inserted
   ASSERT_TRUE(db.IsExistingResource(c));
 
+  db.AddAttachment(c, a1);  // Removed by the cascaded deletion below
+  ASSERT_EQ(42u, db.GetTotalCompressedSize());
+  ASSERT_EQ(42u, db.GetTotalUncompressedSize());
+
   {
     // A transaction is needed here for MySQL, as it was not possible
     // to implement recursive deletion of resources using pure SQL
@@ -397,12 +496,32 @@ TEST(IndexBackend, Basic)
   ASSERT_FALSE(db.IsExistingResource(c));
   ASSERT_TRUE(db.IsExistingResource(a));
   ASSERT_TRUE(db.IsExistingResource(b));
+  ASSERT_FALSE(db.LookupResource(c, t, "series2"));  // Removed from the cache of resources
+  ASSERT_TRUE(db.LookupResource(c, t, "series"));
+  ASSERT_EQ(b, c);
   ASSERT_EQ(2u, db.GetResourcesCount());
+  ASSERT_EQ(1u, db.GetResourceCount(OrthancPluginResourceType_Study));
+  ASSERT_EQ(1u, db.GetResourceCount(OrthancPluginResourceType_Series));
+  ASSERT_EQ(0u, db.GetTotalCompressedSize());
+  ASSERT_EQ(0u, db.GetTotalUncompressedSize());
   db.DeleteResource(a);
   ASSERT_EQ(0u, db.GetResourcesCount());
+  ASSERT_EQ(0u, db.GetResourceCount(OrthancPluginResourceType_Study));
+  ASSERT_EQ(0u, db.GetResourceCount(OrthancPluginResourceType_Series));
   ASSERT_FALSE(db.IsExistingResource(a));
   ASSERT_FALSE(db.IsExistingResource(b));
   ASSERT_FALSE(db.IsExistingResource(c));
+  ASSERT_FALSE(db.LookupResource(c, t, "study"));
+  ASSERT_FALSE(db.LookupResource(c, t, "series"));
+
+  {
+    Json::Value statistics;
+    db.GetStatistics(statistics);
+    ASSERT_EQ(Json::objectValue, statistics["ResourcesCache"].type());
+    ASSERT_LT(0u, statistics["ResourcesCache"]["PublicIdsHits"].asUInt());
+    ASSERT_EQ(1u, statistics["MainDicomTagsCache"]["Hits"].asUInt());
+    ASSERT_LT(0u, statistics["PublicIdsFilter"]["SkippedLookups"].asUInt());
+  }
 
   ASSERT_EQ(0u, db.GetResourcesCount());
   ASSERT_EQ(0u, db.GetUnprotectedPatientsCount());
@@ -410,6 +529,26 @@ TEST(IndexBackend, Basic)
   int64_t p2 = db.CreateResource("patient2", OrthancPluginResourceType_Patient);
   int64_t p3 = db.CreateResource("patient3", OrthancPluginResourceType_Patient);
   ASSERT_EQ(3u, db.GetUnprotectedPatientsCount());
+
+  db.GetAllPublicIds(pub, OrthancPluginResourceType_Patient, 0, 2);
+  ASSERT_EQ(2u, pub.size());
+  ASSERT_EQ("patient1", pub.front());
+  ASSERT_EQ("patient2", pub.back());
+  db.GetAllPublicIds(pub, OrthancPluginResourceType_Patient, 2, 2);
+  ASSERT_EQ(1u, pub.size());
+  ASSERT_EQ("patient3", pub.front());
+  db.GetAllPublicIds(pub, OrthancPluginResourceType_Patient, 1, 1);
+  ASSERT_EQ(1u, pub.size());
+  ASSERT_EQ("patient2", pub.front());
+  db.GetAllPublicIds(pub, OrthancPluginResourceType_Patient, 3, 2);
+  ASSERT_EQ(0u, pub.size());
+  db.GetAllPublicIds(pub, OrthancPluginResourceType_Study, 0, 10);
+  ASSERT_EQ(0u, pub.size());
+  db.SetPagesIndex(false);  // Plain "OFFSET", as with several writers
+  db.GetAllPublicIds(pub, OrthancPluginResourceType_Patient, 2, 2);
+  ASSERT_EQ(1u, pub.size());
+  ASSERT_EQ("patient3", pub.front());
+  db.SetPagesIndex(true);
   int64_t r;
   ASSERT_TRUE(db.SelectPatientToRecycle(r));
   ASSERT_EQ(p1, r);
@@ -427,4 +566,51 @@ TEST(IndexBackend, Basic)
   db.DeleteResource(p2);
   ASSERT_TRUE(db.SelectPatientToRecycle(r, p3));
   ASSERT_EQ(p1, r);
+
+  {
+    // Deleting a resource only removes the deleted resources from the
+    // cache of the main DICOM tags, not their remaining ancestor
+    int64_t study = db.CreateResource("study4", OrthancPluginResourceType_Study);
+    int64_t series1 = db.CreateResource("series4a", OrthancPluginResourceType_Series);
+    int64_t series2 = db.CreateResource("series4b", OrthancPluginResourceType_Series);
+    db.AttachChild(study, series1);
+    db.AttachChild(study, series2);
+
+    expectedDicomTags.clear();
+    expectedDicomTags.push_back(OrthancPluginDicomTag());
+    expectedDicomTags.push_back(OrthancPluginDicomTag());
+    expectedDicomTags.front().group = 0x0020;
+    expectedDicomTags.front().element = 0x000d;
+    expectedDicomTags.front().value = "study4";
+    expectedDicomTags.back().group = 0x0020;
+    expectedDicomTags.back().element = 0x000e;
+    expectedDicomTags.back().value = "series4a";
+
+    db.SetMainDicomTag(study, 0x0020, 0x000d, "study4");
+    db.SetMainDicomTag(series1, 0x0020, 0x000e, "series4a");
+    db.GetMainDicomTags(study);
+    db.GetMainDicomTags(series1);
+
+    Json::Value before;
+    db.GetStatistics(before);
+
+    db.StartTransaction();
+    db.DeleteResource(series1);
+    db.CommitTransaction();
+
+    countDicomTags = 0;
+    db.GetMainDicomTags(study);
+    ASSERT_EQ(1u, countDicomTags);
+
+    Json::Value after;
+    db.GetStatistics(after);
+    ASSERT_EQ(before["MainDicomTagsCache"]["Hits"].asUInt() + 1,
+              after["MainDicomTagsCache"]["Hits"].asUInt());
+
+    // SQLite might reuse the internal ID of the deleted series
+    int64_t series3 = db.CreateResource("series4c", OrthancPluginResourceType_Series);
+    countDicomTags = 0;
+    db.GetMainDicomTags(series3);
+    ASSERT_EQ(0u, countDicomTags);
+  }
 }
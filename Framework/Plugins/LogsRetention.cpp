@@ -0,0 +1,204 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "LogsRetention.h"
+
+#include <Core/Logging.h>
+#include <Core/OrthancException.h>
+
+namespace OrthancDatabases
+{
+  void LogsRetention::RunRound()
+  {
+    // Pause between two batches, to let Orthanc access the index
+    static const unsigned int PAUSE = 100;  // In milliseconds
+
+    bool more = true;
+
+    while (more &&
+           !ShouldStop())
+    {
+      more = false;
+
+      if (changesMaxCount_ != 0 ||
+          changesMaxAge_ != 0)
+      {
+        more |= backend_.PruneChanges(changesMaxCount_, changesMaxAge_, batchSize_);
+      }
+
+      if (exportedMaxCount_ != 0 ||
+          exportedMaxAge_ != 0)
+      {
+        more |= backend_.PruneExportedResources(exportedMaxCount_, exportedMaxAge_, batchSize_);
+      }
+
+      if (more)
+      {
+        Wait(PAUSE);
+      }
+    }
+  }
+
+
+  LogsRetention::LogsRetention(IndexBackend& backend) :
+    PeriodicWorker("retention thread of the changes and exported resources"),
+    backend_(backend),
+    changesMaxCount_(0),
+    changesMaxAge_(0),
+    exportedMaxCount_(0),
+    exportedMaxAge_(0),
+    batchSize_(1000),
+    period_(60)
+  {
+  }
+
+
+  LogsRetention::~LogsRetention()
+  {
+    Stop();
+  }
+
+
+  void LogsRetention::ReadConfiguration(const OrthancPlugins::OrthancConfiguration& configuration)
+  {
+    static const uint64_t SECONDS_PER_DAY = 24 * 3600;
+
+    unsigned int value;
+
+    if (configuration.LookupUnsignedIntegerValue(value, "ChangesRetentionCount"))
+    {
+      SetChangesMaxCount(value);
+    }
+
+    if (configuration.LookupUnsignedIntegerValue(value, "ChangesRetentionDays"))
+    {
+      SetChangesMaxAge(value * SECONDS_PER_DAY);
+    }
+
+    if (configuration.LookupUnsignedIntegerValue(value, "ExportedResourcesRetentionCount"))
+    {
+      SetExportedResourcesMaxCount(value);
+    }
+
+    if (configuration.LookupUnsignedIntegerValue(value, "ExportedResourcesRetentionDays"))
+    {
+      SetExportedResourcesMaxAge(value * SECONDS_PER_DAY);
+    }
+  }
+
+
+  void LogsRetention::SetChangesMaxCount(uint64_t count)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    changesMaxCount_ = count;
+  }
+
+
+  void LogsRetention::SetChangesMaxAge(uint64_t seconds)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    changesMaxAge_ = seconds;
+  }
+
+
+  void LogsRetention::SetExportedResourcesMaxCount(uint64_t count)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    exportedMaxCount_ = count;
+  }
+
+
+  void LogsRetention::SetExportedResourcesMaxAge(uint64_t seconds)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    exportedMaxAge_ = seconds;
+  }
+
+
+  void LogsRetention::SetBatchSize(uint32_t size)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+    else if (size == 0)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+    }
+
+    batchSize_ = size;
+  }
+
+
+  void LogsRetention::SetPeriod(unsigned int seconds)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+    else if (seconds == 0)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+    }
+
+    period_ = seconds;
+  }
+
+
+  bool LogsRetention::IsEnabled() const
+  {
+    return (changesMaxCount_ != 0 ||
+            changesMaxAge_ != 0 ||
+            exportedMaxCount_ != 0 ||
+            exportedMaxAge_ != 0);
+  }
+
+
+  void LogsRetention::Start()
+  {
+    if (IsEnabled())
+    {
+      StartWorker(1000 * period_);
+    }
+  }
+
+
+  void LogsRetention::Stop()
+  {
+    StopWorker();
+  }
+}
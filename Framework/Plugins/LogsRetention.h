@@ -0,0 +1,82 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include "IndexBackend.h"
+#include "PeriodicWorker.h"
+
+#include <Plugins/Samples/Common/OrthancPluginCppWrapper.h>
+
+namespace OrthancDatabases
+{
+  /**
+   * Background thread that enforces the retention policy of the
+   * "Changes" and "ExportedResources" tables, that would otherwise
+   * grow forever. The oldest entries are removed by small batches,
+   * so that the index is never locked for a long time.
+   **/
+  class LogsRetention : public PeriodicWorker
+  {
+  private:
+    IndexBackend&  backend_;
+    uint64_t       changesMaxCount_;
+    uint64_t       changesMaxAge_;
+    uint64_t       exportedMaxCount_;
+    uint64_t       exportedMaxAge_;
+    uint32_t       batchSize_;
+    unsigned int   period_;
+
+  protected:
+    virtual void RunRound();
+
+  public:
+    explicit LogsRetention(IndexBackend& backend);
+
+    virtual ~LogsRetention();
+
+    // Parses the "ChangesRetentionCount", "ChangesRetentionDays",
+    // "ExportedResourcesRetentionCount" and
+    // "ExportedResourcesRetentionDays" options
+    void ReadConfiguration(const OrthancPlugins::OrthancConfiguration& configuration);
+
+    // "0" means no limit on the number of changes
+    void SetChangesMaxCount(uint64_t count);
+
+    // "0" means no limit on the age of the changes
+    void SetChangesMaxAge(uint64_t seconds);
+
+    void SetExportedResourcesMaxCount(uint64_t count);
+
+    void SetExportedResourcesMaxAge(uint64_t seconds);
+
+    void SetBatchSize(uint32_t size);
+
+    // Number of seconds between two pruning rounds
+    void SetPeriod(unsigned int seconds);
+
+    bool IsEnabled() const;
+
+    void Start();
+
+    void Stop();
+  };
+}
@@ -0,0 +1,189 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "MainDicomTagsCache.h"
+
+#include <cassert>
+
+namespace OrthancDatabases
+{
+  bool MainDicomTagsCache::Tag::operator< (const Tag& other) const
+  {
+    if (group_ != other.group_)
+    {
+      return group_ < other.group_;
+    }
+    else if (element_ != other.element_)
+    {
+      return element_ < other.element_;
+    }
+    else
+    {
+      return value_ < other.value_;
+    }
+  }
+
+
+  size_t MainDicomTagsCache::ComputeMemory(const Tags& tags)
+  {
+    // Rough estimate, that includes the bookkeeping of the entry
+    size_t memory = sizeof(Entry) + sizeof(int64_t) + 4 * sizeof(void*);
+
+    for (Tags::const_iterator it = tags.begin(); it != tags.end(); ++it)
+    {
+      memory += sizeof(Tag) + it->GetValue().size();
+    }
+
+    return memory;
+  }
+
+
+  void MainDicomTagsCache::RemoveInternal(Content::iterator entry)
+  {
+    assert(memory_ >= entry->second.memory_);
+    memory_ -= entry->second.memory_;
+    usage_.erase(entry->second.usage_);
+    content_.erase(entry);
+  }
+
+
+  void MainDicomTagsCache::RemoveOldest()
+  {
+    while (memory_ > maxMemory_)
+    {
+      assert(!usage_.empty());
+      Content::iterator oldest = content_.find(usage_.back());
+      assert(oldest != content_.end());
+      RemoveInternal(oldest);
+    }
+  }
+
+
+  MainDicomTagsCache::MainDicomTagsCache(size_t maxMemory) :
+    maxMemory_(maxMemory),
+    memory_(0),
+    hits_(0),
+    misses_(0)
+  {
+  }
+
+
+  void MainDicomTagsCache::SetMaxMemory(size_t maxMemory)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    maxMemory_ = maxMemory;
+    RemoveOldest();
+  }
+
+
+  void MainDicomTagsCache::Add(int64_t id,
+                               const Tags& tags)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    const size_t memory = ComputeMemory(tags);
+    if (memory > maxMemory_)
+    {
+      return;  // Too large, or cache disabled
+    }
+
+    Content::iterator found = content_.find(id);
+    if (found != content_.end())
+    {
+      RemoveInternal(found);
+    }
+
+    usage_.push_front(id);
+
+    Entry& entry = content_[id];
+    entry.tags_ = tags;
+    entry.memory_ = memory;
+    entry.usage_ = usage_.begin();
+    memory_ += memory;
+
+    RemoveOldest();
+  }
+
+
+  bool MainDicomTagsCache::Lookup(Tags& tags,
+                                  int64_t id)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    Content::iterator found = content_.find(id);
+
+    if (found == content_.end())
+    {
+      misses_++;
+      return false;
+    }
+    else
+    {
+      hits_++;
+      tags = found->second.tags_;
+      usage_.splice(usage_.begin(), usage_, found->second.usage_);
+      return true;
+    }
+  }
+
+
+  void MainDicomTagsCache::Invalidate(int64_t id)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    Content::iterator found = content_.find(id);
+    if (found != content_.end())
+    {
+      RemoveInternal(found);
+    }
+  }
+
+
+  bool MainDicomTagsCache::IsEmpty()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return content_.empty();
+  }
+
+
+  void MainDicomTagsCache::Clear()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    content_.clear();
+    usage_.clear();
+    memory_ = 0;
+  }
+
+
+  void MainDicomTagsCache::GetStatistics(Json::Value& target)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    target = Json::objectValue;
+    target["MaxMemory"] = static_cast<Json::UInt64>(maxMemory_);
+    target["Memory"] = static_cast<Json::UInt64>(memory_);
+    target["Count"] = static_cast<Json::UInt64>(content_.size());
+    target["Hits"] = static_cast<Json::UInt64>(hits_);
+    target["Misses"] = static_cast<Json::UInt64>(misses_);
+    target["HitRate"] = (hits_ + misses_ == 0 ? 0.0 :
+                         static_cast<double>(hits_) / static_cast<double>(hits_ + misses_));
+  }
+}
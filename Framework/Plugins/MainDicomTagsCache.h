@@ -0,0 +1,133 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <json/value.h>
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace OrthancDatabases
+{
+  /**
+   * Cache of the main DICOM tags of the resources, indexed by their
+   * internal ID, with a LRU policy. The size of the cache is bounded
+   * by the (approximate) memory that is used by the cached tags.
+   **/
+  class MainDicomTagsCache : public boost::noncopyable
+  {
+  public:
+    class Tag
+    {
+    private:
+      uint16_t     group_;
+      uint16_t     element_;
+      std::string  value_;
+
+    public:
+      Tag(uint16_t group,
+          uint16_t element,
+          const std::string& value) :
+        group_(group),
+        element_(element),
+        value_(value)
+      {
+      }
+
+      uint16_t GetGroup() const
+      {
+        return group_;
+      }
+
+      uint16_t GetElement() const
+      {
+        return element_;
+      }
+
+      const std::string& GetValue() const
+      {
+        return value_;
+      }
+
+      bool operator< (const Tag& other) const;
+
+      bool operator== (const Tag& other) const
+      {
+        return (group_ == other.group_ &&
+                element_ == other.element_ &&
+                value_ == other.value_);
+      }
+    };
+
+    typedef std::vector<Tag>  Tags;
+
+  private:
+    typedef std::list<int64_t>  Usage;   // The most recently used resources first
+
+    struct Entry
+    {
+      Tags             tags_;
+      size_t           memory_;
+      Usage::iterator  usage_;
+    };
+
+    typedef std::map<int64_t, Entry>  Content;
+
+    boost::mutex  mutex_;
+    size_t        maxMemory_;
+    size_t        memory_;
+    Content       content_;
+    Usage         usage_;
+    uint64_t      hits_;
+    uint64_t      misses_;
+
+    static size_t ComputeMemory(const Tags& tags);
+
+    void RemoveInternal(Content::iterator entry);
+
+    void RemoveOldest();
+
+  public:
+    // "0" disables the cache
+    explicit MainDicomTagsCache(size_t maxMemory);
+
+    void SetMaxMemory(size_t maxMemory);
+
+    void Add(int64_t id,
+             const Tags& tags);
+
+    bool Lookup(Tags& tags /*out*/,
+                int64_t id);
+
+    void Invalidate(int64_t id);
+
+    bool IsEmpty();
+
+    void Clear();
+
+    void GetStatistics(Json::Value& target);
+  };
+}
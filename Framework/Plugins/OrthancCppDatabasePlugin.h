@@ -75,7 +75,9 @@ namespace OrthancPlugins
       AllowedAnswers_Attachment,
       AllowedAnswers_Change,
       AllowedAnswers_DicomTag,
-      AllowedAnswers_ExportedResource
+      AllowedAnswers_ExportedResource,
+      AllowedAnswers_Int64,
+      AllowedAnswers_String
     };
 
     OrthancPluginContext*         context_;
@@ -243,6 +245,28 @@ namespace OrthancPlugins
 
       OrthancPluginDatabaseAnswerExportedResource(context_, database_, &exported);
     }
+
+    void AnswerInt64(int64_t value)
+    {
+      if (allowedAnswers_ != AllowedAnswers_All &&
+          allowedAnswers_ != AllowedAnswers_Int64)
+      {
+        throw std::runtime_error("Cannot answer with an integer in the current state");
+      }
+
+      OrthancPluginDatabaseAnswerInt64(context_, database_, value);
+    }
+
+    void AnswerString(const std::string& value)
+    {
+      if (allowedAnswers_ != AllowedAnswers_All &&
+          allowedAnswers_ != AllowedAnswers_String)
+      {
+        throw std::runtime_error("Cannot answer with a string in the current state");
+      }
+
+      OrthancPluginDatabaseAnswerString(context_, database_, value.c_str());
+    }
   };
 
 
@@ -447,6 +471,98 @@ namespace OrthancPlugins
                                  OrthancPluginStorageArea* storageArea) = 0;
 
     virtual void ClearMainDicomTags(int64_t internalId) = 0;
+
+
+    /**
+     * Streaming variants of the methods that list resources: Each row
+     * is directly answered to Orthanc through "GetOutput()", instead
+     * of being buffered into a "std::list". These are the methods
+     * that are invoked by "DatabaseBackendAdapter". The default
+     * implementations fall back to the list-based methods.
+     **/
+
+    /* Use GetOutput().AnswerInt64() */
+    virtual void StreamAllInternalIds(OrthancPluginResourceType resourceType)
+    {
+      std::list<int64_t> target;
+      GetAllInternalIds(target, resourceType);
+      AnswerIntegers(target);
+    }
+
+    /* Use GetOutput().AnswerString() */
+    virtual void StreamAllPublicIds(OrthancPluginResourceType resourceType)
+    {
+      std::list<std::string> target;
+      GetAllPublicIds(target, resourceType);
+      AnswerStrings(target);
+    }
+
+    /* Use GetOutput().AnswerString() */
+    virtual void StreamAllPublicIds(OrthancPluginResourceType resourceType,
+                                    uint64_t since,
+                                    uint64_t limit)
+    {
+      std::list<std::string> target;
+      GetAllPublicIds(target, resourceType, since, limit);
+      AnswerStrings(target);
+    }
+
+    /* Use GetOutput().AnswerInt64() */
+    virtual void StreamChildrenInternalId(int64_t id)
+    {
+      std::list<int64_t> target;
+      GetChildrenInternalId(target, id);
+      AnswerIntegers(target);
+    }
+
+    /* Use GetOutput().AnswerString() */
+    virtual void StreamChildrenPublicId(int64_t id)
+    {
+      std::list<std::string> target;
+      GetChildrenPublicId(target, id);
+      AnswerStrings(target);
+    }
+
+    /* Use GetOutput().AnswerInt64() */
+    virtual void StreamLookupIdentifier(OrthancPluginResourceType resourceType,
+                                        uint16_t group,
+                                        uint16_t element,
+                                        OrthancPluginIdentifierConstraint constraint,
+                                        const char* value)
+    {
+      std::list<int64_t> target;
+      LookupIdentifier(target, resourceType, group, element, constraint, value);
+      AnswerIntegers(target);
+    }
+
+    /* Use GetOutput().AnswerInt64() */
+    virtual void StreamLookupIdentifierRange(OrthancPluginResourceType resourceType,
+                                             uint16_t group,
+                                             uint16_t element,
+                                             const char* start,
+                                             const char* end)
+    {
+      std::list<int64_t> target;
+      LookupIdentifierRange(target, resourceType, group, element, start, end);
+      AnswerIntegers(target);
+    }
+
+  private:
+    void AnswerIntegers(const std::list<int64_t>& values)
+    {
+      for (std::list<int64_t>::const_iterator it = values.begin(); it != values.end(); ++it)
+      {
+        GetOutput().AnswerInt64(*it);
+      }
+    }
+
+    void AnswerStrings(const std::list<std::string>& values)
+    {
+      for (std::list<std::string>::const_iterator it = values.begin(); it != values.end(); ++it)
+      {
+        GetOutput().AnswerString(*it);
+      }
+    }
   };
 
 
@@ -604,20 +720,11 @@ namespace OrthancPlugins
                                                      OrthancPluginResourceType resourceType)
     {
       IDatabaseBackend* backend = reinterpret_cast<IDatabaseBackend*>(payload);
-      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_None);
+      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_Int64);
 
       try
       {
-        std::list<int64_t> target;
-        backend->GetAllInternalIds(target, resourceType);
-
-        for (std::list<int64_t>::const_iterator
-               it = target.begin(); it != target.end(); ++it)
-        {
-          OrthancPluginDatabaseAnswerInt64(backend->GetOutput().context_,
-                                           backend->GetOutput().database_, *it);
-        }
-
+        backend->StreamAllInternalIds(resourceType);
         return OrthancPluginErrorCode_Success;
       }
       ORTHANC_PLUGINS_DATABASE_CATCH
@@ -629,21 +736,11 @@ namespace OrthancPlugins
                                                    OrthancPluginResourceType resourceType)
     {
       IDatabaseBackend* backend = reinterpret_cast<IDatabaseBackend*>(payload);
-      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_None);
+      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_String);
 
       try
       {
-        std::list<std::string> ids;
-        backend->GetAllPublicIds(ids, resourceType);
-
-        for (std::list<std::string>::const_iterator
-               it = ids.begin(); it != ids.end(); ++it)
-        {
-          OrthancPluginDatabaseAnswerString(backend->GetOutput().context_,
-                                            backend->GetOutput().database_,
-                                            it->c_str());
-        }
-
+        backend->StreamAllPublicIds(resourceType);
         return OrthancPluginErrorCode_Success;
       }
       ORTHANC_PLUGINS_DATABASE_CATCH
@@ -657,21 +754,11 @@ namespace OrthancPlugins
                                                             uint64_t limit)
     {
       IDatabaseBackend* backend = reinterpret_cast<IDatabaseBackend*>(payload);
-      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_None);
+      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_String);
 
       try
       {
-        std::list<std::string> ids;
-        backend->GetAllPublicIds(ids, resourceType, since, limit);
-
-        for (std::list<std::string>::const_iterator
-               it = ids.begin(); it != ids.end(); ++it)
-        {
-          OrthancPluginDatabaseAnswerString(backend->GetOutput().context_,
-                                            backend->GetOutput().database_,
-                                            it->c_str());
-        }
-
+        backend->StreamAllPublicIds(resourceType, since, limit);
         return OrthancPluginErrorCode_Success;
       }
       ORTHANC_PLUGINS_DATABASE_CATCH
@@ -708,20 +795,11 @@ namespace OrthancPlugins
                                                          int64_t id)
     {
       IDatabaseBackend* backend = reinterpret_cast<IDatabaseBackend*>(payload);
-      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_None);
+      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_Int64);
 
       try
       {
-        std::list<int64_t> target;
-        backend->GetChildrenInternalId(target, id);
-
-        for (std::list<int64_t>::const_iterator
-               it = target.begin(); it != target.end(); ++it)
-        {
-          OrthancPluginDatabaseAnswerInt64(backend->GetOutput().context_,
-                                           backend->GetOutput().database_, *it);
-        }
-
+        backend->StreamChildrenInternalId(id);
         return OrthancPluginErrorCode_Success;
       }
       ORTHANC_PLUGINS_DATABASE_CATCH
@@ -733,21 +811,11 @@ namespace OrthancPlugins
                                                        int64_t id)
     {
       IDatabaseBackend* backend = reinterpret_cast<IDatabaseBackend*>(payload);
-      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_None);
+      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_String);
 
       try
       {
-        std::list<std::string> ids;
-        backend->GetChildrenPublicId(ids, id);
-
-        for (std::list<std::string>::const_iterator
-               it = ids.begin(); it != ids.end(); ++it)
-        {
-          OrthancPluginDatabaseAnswerString(backend->GetOutput().context_,
-                                            backend->GetOutput().database_,
-                                            it->c_str());
-        }
-
+        backend->StreamChildrenPublicId(id);
         return OrthancPluginErrorCode_Success;
       }
       ORTHANC_PLUGINS_DATABASE_CATCH
@@ -1067,20 +1135,11 @@ namespace OrthancPlugins
                                                      OrthancPluginIdentifierConstraint constraint)
     {
       IDatabaseBackend* backend = reinterpret_cast<IDatabaseBackend*>(payload);
-      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_None);
+      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_Int64);
 
       try
       {
-        std::list<int64_t> target;
-        backend->LookupIdentifier(target, resourceType, tag->group, tag->element, constraint, tag->value);
-
-        for (std::list<int64_t>::const_iterator
-               it = target.begin(); it != target.end(); ++it)
-        {
-          OrthancPluginDatabaseAnswerInt64(backend->GetOutput().context_,
-                                           backend->GetOutput().database_, *it);
-        }
-
+        backend->StreamLookupIdentifier(resourceType, tag->group, tag->element, constraint, tag->value);
         return OrthancPluginErrorCode_Success;
       }
       ORTHANC_PLUGINS_DATABASE_CATCH
@@ -1096,20 +1155,11 @@ namespace OrthancPlugins
                                                          const char* end)
     {
       IDatabaseBackend* backend = reinterpret_cast<IDatabaseBackend*>(payload);
-      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_None);
+      backend->GetOutput().SetAllowedAnswers(DatabaseBackendOutput::AllowedAnswers_Int64);
 
       try
       {
-        std::list<int64_t> target;
-        backend->LookupIdentifierRange(target, resourceType, group, element, start, end);
-
-        for (std::list<int64_t>::const_iterator
-               it = target.begin(); it != target.end(); ++it)
-        {
-          OrthancPluginDatabaseAnswerInt64(backend->GetOutput().context_,
-                                           backend->GetOutput().database_, *it);
-        }
-
+        backend->StreamLookupIdentifierRange(resourceType, group, element, start, end);
         return OrthancPluginErrorCode_Success;
       }
       ORTHANC_PLUGINS_DATABASE_CATCH
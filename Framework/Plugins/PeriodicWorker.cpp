@@ -0,0 +1,132 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "PeriodicWorker.h"
+
+#include <Core/Logging.h>
+#include <Core/OrthancException.h>
+
+namespace OrthancDatabases
+{
+  void PeriodicWorker::Worker(PeriodicWorker* that)
+  {
+    LOG(WARNING) << "Starting the " << that->name_;
+
+    while (that->Wait(that->period_))
+    {
+      try
+      {
+        that->RunRound();
+      }
+      catch (Orthanc::OrthancException& e)
+      {
+        // The next round will try again
+        LOG(ERROR) << "Error in the " << that->name_ << ": " << e.What();
+      }
+    }
+
+    LOG(WARNING) << "Stopping the " << that->name_;
+  }
+
+
+  bool PeriodicWorker::Wait(unsigned int milliseconds)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (milliseconds != 0)
+    {
+      const boost::system_time deadline = (boost::get_system_time() +
+                                           boost::posix_time::milliseconds(milliseconds));
+
+      while (continue_ &&
+             stopRequested_.timed_wait(lock, deadline))
+      {
+        // Spurious wake up, or stop request (checked by the loop)
+      }
+    }
+
+    return continue_;
+  }
+
+
+  void PeriodicWorker::StartWorker(unsigned int periodMilliseconds)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (running_)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    period_ = periodMilliseconds;
+    continue_ = true;
+    running_ = true;
+    thread_ = boost::thread(Worker, this);
+  }
+
+
+  void PeriodicWorker::StopWorker()
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+
+      if (!running_)
+      {
+        return;
+      }
+
+      continue_ = false;
+    }
+
+    stopRequested_.notify_all();
+
+    if (thread_.joinable())
+    {
+      thread_.join();
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    running_ = false;
+  }
+
+
+  PeriodicWorker::PeriodicWorker(const std::string& name) :
+    name_(name),
+    running_(false),
+    continue_(false),
+    period_(0)
+  {
+  }
+
+
+  PeriodicWorker::~PeriodicWorker()
+  {
+    // The subclass should have stopped the thread already
+    StopWorker();
+  }
+
+
+  bool PeriodicWorker::IsRunning()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return running_;
+  }
+}
@@ -0,0 +1,75 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+#include <string>
+
+namespace OrthancDatabases
+{
+  /**
+   * Thread that runs "RunRound()" periodically, until "StopWorker()"
+   * is called. The pauses of the thread are interrupted as soon as
+   * it is asked to stop. The subclasses must call "StopWorker()" in
+   * their destructor, as the thread uses their members.
+   **/
+  class PeriodicWorker : public boost::noncopyable
+  {
+  private:
+    std::string                name_;
+    boost::mutex               mutex_;
+    boost::condition_variable  stopRequested_;
+    bool                       running_;
+    bool                       continue_;
+    unsigned int               period_;
+    boost::thread              thread_;
+
+    static void Worker(PeriodicWorker* that);
+
+  protected:
+    // Invoked by the thread after each period. The exceptions are
+    // logged, and the next round will try again.
+    virtual void RunRound() = 0;
+
+    // Pause of the thread. Returns "false" if it must stop.
+    bool Wait(unsigned int milliseconds);
+
+    bool ShouldStop()
+    {
+      return !Wait(0);
+    }
+
+    // "0" means that the rounds are run without pause
+    void StartWorker(unsigned int periodMilliseconds);
+
+    void StopWorker();
+
+  public:
+    // "name" is used in the logs, e.g. "maintenance thread of the index"
+    explicit PeriodicWorker(const std::string& name);
+
+    virtual ~PeriodicWorker();
+
+    bool IsRunning();
+  };
+}
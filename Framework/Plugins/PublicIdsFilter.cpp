@@ -0,0 +1,282 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "PublicIdsFilter.h"
+
+#include <Core/OrthancException.h>
+
+#include <algorithm>
+
+namespace OrthancDatabases
+{
+  // About 1% of false positives once the filter is full
+  static const uint64_t BITS_PER_RESOURCE = 10;
+  static const unsigned int HASHES_COUNT = 7;
+  static const uint64_t MIN_CAPACITY = 65536;
+
+
+  void PublicIdsFilter::Hash(uint64_t& h1,
+                             uint64_t& h2,
+                             const std::string& publicId)
+  {
+    // 64-bit FNV-1a, followed by the finalizer of SplitMix64 to
+    // derive the step of double hashing
+    h1 = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < publicId.size(); i++)
+    {
+      h1 ^= static_cast<uint8_t>(publicId[i]);
+      h1 *= 1099511628211ULL;
+    }
+
+    h2 = h1 + 0x9e3779b97f4a7c15ULL;
+    h2 = (h2 ^ (h2 >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h2 = (h2 ^ (h2 >> 27)) * 0x94d049bb133111ebULL;
+    h2 = (h2 ^ (h2 >> 31)) | 1;
+  }
+
+
+  void PublicIdsFilter::Insert(std::vector<uint64_t>& bits,
+                               uint64_t h1,
+                               uint64_t h2)
+  {
+    const uint64_t size = static_cast<uint64_t>(bits.size()) * 64;
+
+    for (unsigned int i = 0; i < HASHES_COUNT; i++)
+    {
+      const uint64_t bit = (h1 + i * h2) % size;
+      bits[bit / 64] |= (static_cast<uint64_t>(1) << (bit % 64));
+    }
+  }
+
+
+  PublicIdsFilter::Builder::Builder(uint64_t expectedCount) :
+    capacity_(std::max(2 * expectedCount, MIN_CAPACITY)),
+    count_(0)
+  {
+    bits_.resize((capacity_ * BITS_PER_RESOURCE + 63) / 64, 0);
+  }
+
+
+  void PublicIdsFilter::Builder::Add(const std::string& publicId)
+  {
+    uint64_t h1, h2;
+    Hash(h1, h2, publicId);
+    Insert(bits_, h1, h2);
+    count_++;
+  }
+
+
+  PublicIdsFilter::PublicIdsFilter() :
+    enabled_(true),
+    ready_(false),
+    building_(false),
+    capacity_(0),
+    count_(0),
+    deletions_(0),
+    deletionsDuringBuild_(0),
+    rebuilds_(0),
+    skipped_(0),
+    falsePositives_(0)
+  {
+  }
+
+
+  void PublicIdsFilter::SetEnabled(bool enabled)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    enabled_ = enabled;
+
+    if (!enabled)
+    {
+      // A pending rebuild will be dropped by "FinishRebuild()"
+      ready_ = false;
+      std::vector<uint64_t>().swap(bits_);  // Release the memory
+    }
+  }
+
+
+  bool PublicIdsFilter::IsEnabled()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return enabled_;
+  }
+
+
+  bool PublicIdsFilter::NeedsRebuild()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    // Rebuild once about a quarter of the resources have been
+    // deleted, but not for a few deletions in a small database
+    return (enabled_ &&
+            ready_ &&
+            !building_ &&
+            (count_ > capacity_ ||
+             deletions_ * 4 > count_ + MIN_CAPACITY / 4));
+  }
+
+
+  void PublicIdsFilter::StartRebuild()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (building_)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    building_ = true;
+    addedDuringBuild_.clear();
+    deletionsDuringBuild_ = 0;
+  }
+
+
+  void PublicIdsFilter::FinishRebuild(Builder& builder)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (!building_)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    building_ = false;
+
+    if (enabled_)
+    {
+      // The resources that were created after "StartRebuild()" might
+      // be missing from the snapshot that has filled the builder
+      for (size_t i = 0; i < addedDuringBuild_.size(); i++)
+      {
+        builder.Add(addedDuringBuild_[i]);
+      }
+
+      bits_.swap(builder.bits_);
+      capacity_ = builder.capacity_;
+      count_ = builder.count_;
+      deletions_ = deletionsDuringBuild_;
+      ready_ = true;
+      rebuilds_++;
+    }
+
+    std::vector<std::string>().swap(addedDuringBuild_);  // Release the memory
+  }
+
+
+  void PublicIdsFilter::CancelRebuild()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    building_ = false;
+    std::vector<std::string>().swap(addedDuringBuild_);
+  }
+
+
+  void PublicIdsFilter::Add(const std::string& publicId)
+  {
+    uint64_t h1, h2;
+    Hash(h1, h2, publicId);
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (building_)
+    {
+      addedDuringBuild_.push_back(publicId);
+    }
+
+    if (!bits_.empty())
+    {
+      Insert(bits_, h1, h2);
+      count_++;
+    }
+  }
+
+
+  bool PublicIdsFilter::MayContain(const std::string& publicId)
+  {
+    uint64_t h1, h2;
+    Hash(h1, h2, publicId);
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (!enabled_ ||
+        !ready_)
+    {
+      return true;
+    }
+
+    const uint64_t size = static_cast<uint64_t>(bits_.size()) * 64;
+
+    for (unsigned int i = 0; i < HASHES_COUNT; i++)
+    {
+      const uint64_t bit = (h1 + i * h2) % size;
+      if ((bits_[bit / 64] & (static_cast<uint64_t>(1) << (bit % 64))) == 0)
+      {
+        skipped_++;
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+
+  void PublicIdsFilter::SignalDeletion()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    deletions_++;
+
+    if (building_)
+    {
+      deletionsDuringBuild_++;
+    }
+  }
+
+
+  void PublicIdsFilter::SignalFalsePositive()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (enabled_ &&
+        ready_)
+    {
+      falsePositives_++;
+    }
+  }
+
+
+  void PublicIdsFilter::GetStatistics(Json::Value& target)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    target = Json::objectValue;
+    target["Enabled"] = enabled_;
+    target["Ready"] = ready_;
+    target["Building"] = building_;
+    target["Capacity"] = static_cast<Json::UInt64>(capacity_);
+    target["Count"] = static_cast<Json::UInt64>(count_);
+    target["Deletions"] = static_cast<Json::UInt64>(deletions_);
+    target["Memory"] = static_cast<Json::UInt64>(bits_.size() * sizeof(uint64_t));
+    target["Rebuilds"] = static_cast<Json::UInt64>(rebuilds_);
+    target["SkippedLookups"] = static_cast<Json::UInt64>(skipped_);
+    target["FalsePositives"] = static_cast<Json::UInt64>(falsePositives_);
+  }
+}
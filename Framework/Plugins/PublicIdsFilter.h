@@ -0,0 +1,125 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <json/value.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace OrthancDatabases
+{
+  /**
+   * Bloom filter over the public IDs of the resources, that allows
+   * "LookupResource()" to skip the database on definite misses (which
+   * is the usual case while receiving new instances). The filter
+   * cannot forget a resource: It must be rebuilt from the database
+   * once too many resources have been deleted, or once it holds more
+   * resources than it was sized for. The new filter is filled by a
+   * "Builder" while the current one remains in use, then swapped in.
+   **/
+  class PublicIdsFilter : public boost::noncopyable
+  {
+  public:
+    // Content of a new filter, that is filled by one thread without
+    // locking the filter that is in use
+    class Builder : public boost::noncopyable
+    {
+      friend class PublicIdsFilter;
+
+    private:
+      std::vector<uint64_t>  bits_;
+      uint64_t               capacity_;
+      uint64_t               count_;
+
+    public:
+      explicit Builder(uint64_t expectedCount);
+
+      void Add(const std::string& publicId);
+    };
+
+  private:
+    boost::mutex              mutex_;
+    bool                      enabled_;
+    bool                      ready_;
+    bool                      building_;
+    std::vector<uint64_t>     bits_;
+    uint64_t                  capacity_;
+    uint64_t                  count_;
+    uint64_t                  deletions_;
+    std::vector<std::string>  addedDuringBuild_;
+    uint64_t                  deletionsDuringBuild_;
+    uint64_t                  rebuilds_;
+    uint64_t                  skipped_;
+    uint64_t                  falsePositives_;
+
+    static void Hash(uint64_t& h1,
+                     uint64_t& h2,
+                     const std::string& publicId);
+
+    static void Insert(std::vector<uint64_t>& bits,
+                       uint64_t h1,
+                       uint64_t h2);
+
+  public:
+    PublicIdsFilter();
+
+    void SetEnabled(bool enabled);
+
+    bool IsEnabled();
+
+    // Must the filter be rebuilt? Always "false" if the filter is
+    // disabled, if it was never built (the first build is done while
+    // opening the database), or if a rebuild is in progress.
+    bool NeedsRebuild();
+
+    /**
+     * Starts a rebuild. From now on, the resources that are added or
+     * deleted are logged, until "FinishRebuild()" replays them into
+     * the new filter. This must be invoked before reading the
+     * snapshot of the database that fills the "Builder", and while
+     * no transaction that creates resources is pending, otherwise
+     * some resources could be missed.
+     **/
+    void StartRebuild();
+
+    // Replays the log into the builder, then swaps it in
+    void FinishRebuild(Builder& builder);
+
+    void CancelRebuild();
+
+    void Add(const std::string& publicId);
+
+    // Returns "false" iff the resource is definitely not in the database
+    bool MayContain(const std::string& publicId);
+
+    void SignalDeletion();
+
+    // To be invoked if the database misses a resource that is
+    // reported by "MayContain()"
+    void SignalFalsePositive();
+
+    void GetStatistics(Json::Value& target);
+  };
+}
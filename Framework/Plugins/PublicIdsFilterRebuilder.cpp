@@ -0,0 +1,73 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "PublicIdsFilterRebuilder.h"
+
+#include <Core/OrthancException.h>
+
+namespace OrthancDatabases
+{
+  void PublicIdsFilterRebuilder::RunRound()
+  {
+    // If Orthanc is busy, the next round will try again
+    backend_.RefreshPublicIdsFilter();
+  }
+
+
+  PublicIdsFilterRebuilder::PublicIdsFilterRebuilder(IndexBackend& backend) :
+    PeriodicWorker("rebuild thread of the filter of the public IDs"),
+    backend_(backend),
+    period_(10)
+  {
+  }
+
+
+  PublicIdsFilterRebuilder::~PublicIdsFilterRebuilder()
+  {
+    Stop();
+  }
+
+
+  void PublicIdsFilterRebuilder::SetPeriod(unsigned int seconds)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+    else if (seconds == 0)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+    }
+
+    period_ = seconds;
+  }
+
+
+  void PublicIdsFilterRebuilder::Start()
+  {
+    StartWorker(1000 * period_);
+  }
+
+
+  void PublicIdsFilterRebuilder::Stop()
+  {
+    StopWorker();
+  }
+}
@@ -0,0 +1,55 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#pragma once
+
+#include "IndexBackend.h"
+#include "PeriodicWorker.h"
+
+namespace OrthancDatabases
+{
+  /**
+   * Background thread that rebuilds the filter of the public IDs of
+   * the index, once too many resources have been deleted or added
+   * since its last build. The rebuild never runs in a transaction of
+   * Orthanc, and the previous filter remains in use meanwhile.
+   **/
+  class PublicIdsFilterRebuilder : public PeriodicWorker
+  {
+  private:
+    IndexBackend&  backend_;
+    unsigned int   period_;
+
+  protected:
+    virtual void RunRound();
+
+  public:
+    explicit PublicIdsFilterRebuilder(IndexBackend& backend);
+
+    virtual ~PublicIdsFilterRebuilder();
+
+    // Number of seconds between two checks of the filter
+    void SetPeriod(unsigned int seconds);
+
+    void Start();
+
+    void Stop();
+  };
+}
@@ -0,0 +1,161 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "ReadAheadCache.h"
+
+#include <Core/OrthancException.h>
+
+#include <memory>
+
+namespace OrthancDatabases
+{
+  bool ReadAheadCache::Resource::LookupParent(int64_t& parentId) const
+  {
+    if (hasParent_)
+    {
+      parentId = parentId_;
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+
+  void ReadAheadCache::Resource::ListAttachments(std::list<int32_t>& target) const
+  {
+    target.clear();
+
+    for (Attachments::const_iterator it = attachments_.begin(); it != attachments_.end(); ++it)
+    {
+      target.push_back(it->first);
+    }
+  }
+
+
+  const ReadAheadCache::Attachment* ReadAheadCache::Resource::LookupAttachment(int32_t contentType) const
+  {
+    Attachments::const_iterator found = attachments_.find(contentType);
+
+    if (found == attachments_.end())
+    {
+      return NULL;
+    }
+    else
+    {
+      return &found->second;
+    }
+  }
+
+
+  void ReadAheadCache::Resource::ListMetadata(std::list<int32_t>& target) const
+  {
+    target.clear();
+
+    for (Metadata::const_iterator it = metadata_.begin(); it != metadata_.end(); ++it)
+    {
+      target.push_back(it->first);
+    }
+  }
+
+
+  bool ReadAheadCache::Resource::LookupMetadata(std::string& target,
+                                                int32_t type) const
+  {
+    Metadata::const_iterator found = metadata_.find(type);
+
+    if (found == metadata_.end())
+    {
+      return false;
+    }
+    else
+    {
+      target = found->second;
+      return true;
+    }
+  }
+
+
+  ReadAheadCache::ReadAheadCache(size_t maxSize) :
+    maxSize_(maxSize)
+  {
+  }
+
+
+  const ReadAheadCache::Resource* ReadAheadCache::Lookup(int64_t id) const
+  {
+    Content::const_iterator found = content_.find(id);
+
+    if (found == content_.end())
+    {
+      return NULL;
+    }
+    else
+    {
+      return found->second;
+    }
+  }
+
+
+  void ReadAheadCache::Add(int64_t id,
+                           Resource* resource)
+  {
+    std::auto_ptr<Resource> protection(resource);
+
+    if (resource == NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_NullPointer);
+    }
+
+    if (content_.size() >= maxSize_)
+    {
+      // Very long transaction: Start over
+      Clear();
+    }
+
+    Invalidate(id);
+    content_[id] = protection.release();
+  }
+
+
+  void ReadAheadCache::Invalidate(int64_t id)
+  {
+    Content::iterator found = content_.find(id);
+
+    if (found != content_.end())
+    {
+      delete found->second;
+      content_.erase(found);
+    }
+  }
+
+
+  void ReadAheadCache::Clear()
+  {
+    for (Content::iterator it = content_.begin(); it != content_.end(); ++it)
+    {
+      delete it->second;
+    }
+
+    content_.clear();
+  }
+}
@@ -0,0 +1,128 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include <boost/noncopyable.hpp>
+#include <list>
+#include <map>
+#include <stdint.h>
+#include <string>
+
+namespace OrthancDatabases
+{
+  /**
+   * Parent, attachments and metadata of the resources that have been
+   * read at once during the current transaction of the index. This
+   * cache is only used from the thread that runs the transaction.
+   **/
+  class ReadAheadCache : public boost::noncopyable
+  {
+  public:
+    struct Attachment
+    {
+      std::string  uuid_;
+      uint64_t     uncompressedSize_;
+      std::string  uncompressedHash_;
+      int32_t      compressionType_;
+      uint64_t     compressedSize_;
+      std::string  compressedHash_;
+    };
+
+    class Resource : public boost::noncopyable
+    {
+    private:
+      typedef std::map<int32_t, Attachment>   Attachments;
+      typedef std::map<int32_t, std::string>  Metadata;
+
+      bool         hasParent_;
+      int64_t      parentId_;
+      Attachments  attachments_;
+      Metadata     metadata_;
+
+    public:
+      Resource() :
+        hasParent_(false),
+        parentId_(0)
+      {
+      }
+
+      void SetParent(int64_t parentId)
+      {
+        hasParent_ = true;
+        parentId_ = parentId;
+      }
+
+      void AddAttachment(int32_t contentType,
+                         const Attachment& attachment)
+      {
+        attachments_[contentType] = attachment;
+      }
+
+      void AddMetadata(int32_t type,
+                       const std::string& value)
+      {
+        metadata_[type] = value;
+      }
+
+      bool LookupParent(int64_t& parentId) const;
+
+      void ListAttachments(std::list<int32_t>& target) const;
+
+      const Attachment* LookupAttachment(int32_t contentType) const;
+
+      void ListMetadata(std::list<int32_t>& target) const;
+
+      bool LookupMetadata(std::string& target,
+                          int32_t type) const;
+    };
+
+  private:
+    typedef std::map<int64_t, Resource*>  Content;
+
+    Content  content_;
+    size_t   maxSize_;
+
+  public:
+    explicit ReadAheadCache(size_t maxSize);
+
+    ~ReadAheadCache()
+    {
+      Clear();
+    }
+
+    // Returns "NULL" if the resource has not been read yet
+    const Resource* Lookup(int64_t id) const;
+
+    // Takes ownership
+    void Add(int64_t id,
+             Resource* resource);
+
+    void Invalidate(int64_t id);
+
+    bool IsEmpty() const
+    {
+      return content_.empty();
+    }
+
+    void Clear();
+  };
+}
@@ -0,0 +1,297 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "ResourcesCache.h"
+
+#include <Core/OrthancException.h>
+
+#include <cassert>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <map>
+
+namespace OrthancDatabases
+{
+  static const size_t SHARDS_COUNT = 16;
+
+
+  template <typename Key, typename Value>
+  class ResourcesCache::Shard : public boost::noncopyable
+  {
+  private:
+    typedef std::list<Key>  Usage;   // The most recently used keys first
+
+    typedef std::map<Key, std::pair<Value, typename Usage::iterator> >  Content;
+
+    boost::mutex  mutex_;
+    size_t        maxSize_;
+    Content       content_;
+    Usage         usage_;
+    uint64_t      hits_;
+    uint64_t      misses_;
+
+    void RemoveOldest()
+    {
+      while (content_.size() > maxSize_)
+      {
+        assert(!usage_.empty());
+        content_.erase(usage_.back());
+        usage_.pop_back();
+      }
+    }
+
+  public:
+    Shard() :
+      maxSize_(0),
+      hits_(0),
+      misses_(0)
+    {
+    }
+
+    void SetMaxSize(size_t maxSize)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      maxSize_ = maxSize;
+      RemoveOldest();
+    }
+
+    void Add(const Key& key,
+             const Value& value)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+
+      if (maxSize_ == 0)
+      {
+        return;
+      }
+
+      typename Content::iterator found = content_.find(key);
+
+      if (found == content_.end())
+      {
+        usage_.push_front(key);
+        content_[key] = std::make_pair(value, usage_.begin());
+        RemoveOldest();
+      }
+      else
+      {
+        found->second.first = value;
+        usage_.splice(usage_.begin(), usage_, found->second.second);
+      }
+    }
+
+    bool Lookup(Value& target,
+                const Key& key)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+
+      typename Content::iterator found = content_.find(key);
+
+      if (found == content_.end())
+      {
+        misses_++;
+        return false;
+      }
+      else
+      {
+        hits_++;
+        target = found->second.first;
+        usage_.splice(usage_.begin(), usage_, found->second.second);
+        return true;
+      }
+    }
+
+    bool Remove(Value& value,
+                const Key& key)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+
+      typename Content::iterator found = content_.find(key);
+
+      if (found == content_.end())
+      {
+        return false;
+      }
+      else
+      {
+        value = found->second.first;
+        usage_.erase(found->second.second);
+        content_.erase(found);
+        return true;
+      }
+    }
+
+    void Clear()
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      content_.clear();
+      usage_.clear();
+    }
+
+    void GetStatistics(uint64_t& size,
+                       uint64_t& hits,
+                       uint64_t& misses)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      size += content_.size();
+      hits += hits_;
+      misses += misses_;
+    }
+  };
+
+
+  ResourcesCache::PublicIdsShard& ResourcesCache::GetShard(const std::string& publicId)
+  {
+    return *publicIds_[boost::hash<std::string>()(publicId) % SHARDS_COUNT];
+  }
+
+
+  ResourcesCache::InternalIdsShard& ResourcesCache::GetShard(int64_t internalId)
+  {
+    return *internalIds_[static_cast<uint64_t>(internalId) % SHARDS_COUNT];
+  }
+
+
+  ResourcesCache::ResourcesCache(size_t maxSize)
+  {
+    for (size_t i = 0; i < SHARDS_COUNT; i++)
+    {
+      publicIds_.push_back(new PublicIdsShard);
+      internalIds_.push_back(new InternalIdsShard);
+    }
+
+    SetMaxSize(maxSize);
+  }
+
+
+  ResourcesCache::~ResourcesCache()
+  {
+    for (size_t i = 0; i < SHARDS_COUNT; i++)
+    {
+      delete publicIds_[i];
+      delete internalIds_[i];
+    }
+  }
+
+
+  void ResourcesCache::SetMaxSize(size_t maxSize)
+  {
+    maxSize_ = maxSize;
+
+    // Round up, so that a small non-zero size does not disable the cache
+    size_t shardSize = (maxSize + SHARDS_COUNT - 1) / SHARDS_COUNT;
+
+    for (size_t i = 0; i < SHARDS_COUNT; i++)
+    {
+      publicIds_[i]->SetMaxSize(shardSize);
+      internalIds_[i]->SetMaxSize(shardSize);
+    }
+  }
+
+
+  void ResourcesCache::Add(int64_t internalId,
+                           const std::string& publicId,
+                           OrthancPluginResourceType type)
+  {
+    GetShard(publicId).Add(publicId, std::make_pair(internalId, type));
+    GetShard(internalId).Add(internalId, publicId);
+  }
+
+
+  bool ResourcesCache::LookupResource(int64_t& internalId,
+                                      OrthancPluginResourceType& type,
+                                      const std::string& publicId)
+  {
+    Resource resource;
+
+    if (GetShard(publicId).Lookup(resource, publicId))
+    {
+      internalId = resource.first;
+      type = resource.second;
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+
+  bool ResourcesCache::LookupPublicId(std::string& publicId,
+                                      int64_t internalId)
+  {
+    return GetShard(internalId).Lookup(publicId, internalId);
+  }
+
+
+  void ResourcesCache::Invalidate(const std::string& publicId)
+  {
+    Resource resource;
+
+    if (GetShard(publicId).Remove(resource, publicId))
+    {
+      std::string removed;
+      GetShard(resource.first).Remove(removed, resource.first);
+    }
+  }
+
+
+  void ResourcesCache::Clear()
+  {
+    for (size_t i = 0; i < SHARDS_COUNT; i++)
+    {
+      publicIds_[i]->Clear();
+      internalIds_[i]->Clear();
+    }
+  }
+
+
+  void ResourcesCache::GetStatistics(Json::Value& target)
+  {
+    uint64_t size = 0, hits = 0, misses = 0;
+
+    for (size_t i = 0; i < SHARDS_COUNT; i++)
+    {
+      publicIds_[i]->GetStatistics(size, hits, misses);
+    }
+
+    uint64_t reverseSize = 0, reverseHits = 0, reverseMisses = 0;
+
+    for (size_t i = 0; i < SHARDS_COUNT; i++)
+    {
+      internalIds_[i]->GetStatistics(reverseSize, reverseHits, reverseMisses);
+    }
+
+    target = Json::objectValue;
+    target["MaxSize"] = static_cast<Json::UInt64>(maxSize_);
+    target["PublicIdsCount"] = static_cast<Json::UInt64>(size);
+    target["PublicIdsHits"] = static_cast<Json::UInt64>(hits);
+    target["PublicIdsMisses"] = static_cast<Json::UInt64>(misses);
+    target["PublicIdsHitRate"] = (hits + misses == 0 ? 0.0 :
+                                  static_cast<double>(hits) / static_cast<double>(hits + misses));
+    target["InternalIdsCount"] = static_cast<Json::UInt64>(reverseSize);
+    target["InternalIdsHits"] = static_cast<Json::UInt64>(reverseHits);
+    target["InternalIdsMisses"] = static_cast<Json::UInt64>(reverseMisses);
+    target["InternalIdsHitRate"] = (reverseHits + reverseMisses == 0 ? 0.0 :
+                                    static_cast<double>(reverseHits) / static_cast<double>(reverseHits + reverseMisses));
+  }
+}
@@ -0,0 +1,88 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include <orthanc/OrthancCPlugin.h>
+
+#include <boost/noncopyable.hpp>
+#include <json/value.h>
+#include <string>
+#include <vector>
+
+namespace OrthancDatabases
+{
+  /**
+   * Cache of the mapping between the public ID of the resources and
+   * their internal ID (together with their type), that never changes
+   * during the life of a resource. The entries are spread over
+   * shards, each having its own mutex and its own LRU policy, in
+   * order to reduce contention.
+   **/
+  class ResourcesCache : public boost::noncopyable
+  {
+  private:
+    template <typename Key, typename Value>
+    class Shard;
+
+    typedef std::pair<int64_t, OrthancPluginResourceType>  Resource;
+    typedef Shard<std::string, Resource>                   PublicIdsShard;
+    typedef Shard<int64_t, std::string>                    InternalIdsShard;
+
+    std::vector<PublicIdsShard*>    publicIds_;
+    std::vector<InternalIdsShard*>  internalIds_;
+    size_t                          maxSize_;
+
+    PublicIdsShard& GetShard(const std::string& publicId);
+
+    InternalIdsShard& GetShard(int64_t internalId);
+
+  public:
+    // "0" disables the cache
+    explicit ResourcesCache(size_t maxSize);
+
+    ~ResourcesCache();
+
+    void SetMaxSize(size_t maxSize);
+
+    size_t GetMaxSize() const
+    {
+      return maxSize_;
+    }
+
+    void Add(int64_t internalId,
+             const std::string& publicId,
+             OrthancPluginResourceType type);
+
+    bool LookupResource(int64_t& internalId /*out*/,
+                        OrthancPluginResourceType& type /*out*/,
+                        const std::string& publicId);
+
+    bool LookupPublicId(std::string& publicId /*out*/,
+                        int64_t internalId);
+
+    void Invalidate(const std::string& publicId);
+
+    void Clear();
+
+    void GetStatistics(Json::Value& target);
+  };
+}
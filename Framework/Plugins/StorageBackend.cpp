@@ -28,6 +28,7 @@
 #include "../../Framework/Common/BinaryStringValue.h"
 #include "../../Framework/Common/FileValue.h"
 
+#include <Core/Logging.h>
 #include <Core/OrthancException.h>
 
 
@@ -75,9 +76,160 @@ namespace OrthancDatabases
   }
 
   
+  class StorageBackend::AdditionalFactory : public IDatabaseFactory
+  {
+  private:
+    StorageBackend&  that_;
+    Dialect          dialect_;
+
+  public:
+    AdditionalFactory(StorageBackend& that,
+                      Dialect dialect) :
+      that_(that),
+      dialect_(dialect)
+    {
+    }
+
+    virtual Dialect GetDialect() const
+    {
+      return dialect_;
+    }
+
+    virtual IDatabase* Open()
+    {
+      return that_.OpenAdditionalConnection();
+    }
+  };
+
+
+  IDatabase* StorageBackend::OpenAdditionalConnection()
+  {
+    LOG(ERROR) << "This storage area does not support more than one connection";
+    throw Orthanc::OrthancException(Orthanc::ErrorCode_NotImplemented);
+  }
+
+  
   StorageBackend::StorageBackend(IDatabaseFactory* factory) :
-    manager_(factory)
+    manager_(factory),
+    groupCommitWindow_(0),
+    nextShared_(0)
+  {
+    pool_.push_back(&manager_);
+    idle_.push_back(&manager_);
+  }
+
+
+  StorageBackend::~StorageBackend()
   {
+    for (size_t i = 1; i < pool_.size(); i++)
+    {
+      assert(pool_[i] != NULL);
+      delete pool_[i];
+    }
+  }
+
+
+  void StorageBackend::SetConnectionsCount(unsigned int count)
+  {
+    boost::mutex::scoped_lock lock(poolMutex_);
+
+    if (count == 0)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+    }
+
+    if (idle_.size() != pool_.size())
+    {
+      // Some connection is in use
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    while (pool_.size() > count)
+    {
+      idle_.remove(pool_.back());
+      delete pool_.back();
+      pool_.pop_back();
+    }
+
+    while (pool_.size() < count)
+    {
+      // The additional connections are only opened on their first use
+      DatabaseManager* manager = new DatabaseManager
+        (new AdditionalFactory(*this, manager_.GetDialect()));
+      manager->SetGroupCommit(groupCommitWindow_);
+      pool_.push_back(manager);
+      idle_.push_back(manager);
+    }
+  }
+
+
+  unsigned int StorageBackend::GetConnectionsCount()
+  {
+    boost::mutex::scoped_lock lock(poolMutex_);
+    return static_cast<unsigned int>(pool_.size());
+  }
+
+
+  void StorageBackend::SetGroupCommit(unsigned int windowMilliseconds)
+  {
+    boost::mutex::scoped_lock lock(poolMutex_);
+
+    if (idle_.size() != pool_.size())
+    {
+      // Some connection is in use
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    groupCommitWindow_ = windowMilliseconds;
+
+    for (size_t i = 0; i < pool_.size(); i++)
+    {
+      pool_[i]->SetGroupCommit(windowMilliseconds);
+    }
+  }
+
+
+  StorageBackend::Accessor::Accessor(StorageBackend& backend) :
+    backend_(backend),
+    shared_(false)
+  {
+    boost::mutex::scoped_lock lock(backend_.poolMutex_);
+
+    if (backend_.groupCommitWindow_ != 0)
+    {
+      // The "DatabaseManager" is locked by each transaction, and
+      // unlocked while a transaction waits for its group commit
+      manager_ = backend_.pool_[backend_.nextShared_ % backend_.pool_.size()];
+      backend_.nextShared_++;
+      shared_ = true;
+      return;
+    }
+
+    while (backend_.idle_.empty())
+    {
+      backend_.poolAvailable_.wait(lock);
+    }
+
+    // The most recently released connection is the most likely to
+    // be still open
+    manager_ = backend_.idle_.front();
+    backend_.idle_.pop_front();
+  }
+
+
+  StorageBackend::Accessor::~Accessor()
+  {
+    if (shared_)
+    {
+      return;
+    }
+
+    {
+      boost::mutex::scoped_lock lock(backend_.poolMutex_);
+      backend_.idle_.push_front(manager_);
+    }
+
+    backend_.poolAvailable_.notify_one();
   }
 
 
@@ -121,7 +273,7 @@ namespace OrthancDatabases
                               OrthancPluginContentType type)
   {
     DatabaseManager::CachedStatement statement(
-      STATEMENT_FROM_HERE, GetManager(),
+      STATEMENT_FROM_HERE, transaction,
       "INSERT INTO StorageArea VALUES (${uuid}, ${content}, ${type})");
      
     statement.SetParameterType("uuid", ValueType_Utf8String);
@@ -130,7 +282,7 @@ namespace OrthancDatabases
 
     Dictionary args;
     args.SetUtf8Value("uuid", uuid);
-    args.SetFileValue("content", content, size);
+    args.SetFileReference("content", content, size);
     args.SetIntegerValue("type", type);
      
     statement.Execute(args);
@@ -144,9 +296,10 @@ namespace OrthancDatabases
                             OrthancPluginContentType type) 
   {
     DatabaseManager::CachedStatement statement(
-      STATEMENT_FROM_HERE, GetManager(),
+      STATEMENT_FROM_HERE, transaction,
       "SELECT content FROM StorageArea WHERE uuid=${uuid} AND type=${type}");
      
+    statement.SetReadOnly(true);
     statement.SetParameterType("uuid", ValueType_Utf8String);
     statement.SetParameterType("type", ValueType_Integer64);
 
@@ -192,7 +345,7 @@ namespace OrthancDatabases
                               OrthancPluginContentType type)
   {
     DatabaseManager::CachedStatement statement(
-      STATEMENT_FROM_HERE, GetManager(),
+      STATEMENT_FROM_HERE, transaction,
       "DELETE FROM StorageArea WHERE uuid=${uuid} AND type=${type}");
      
     statement.SetParameterType("uuid", ValueType_Utf8String);
@@ -218,7 +371,8 @@ namespace OrthancDatabases
   {
     try
     {
-      DatabaseManager::Transaction transaction(backend_->GetManager());
+      StorageBackend::Accessor accessor(*backend_);
+      DatabaseManager::Transaction transaction(accessor.GetManager());
       backend_->Create(transaction, uuid, content, static_cast<size_t>(size), type);
       transaction.Commit();
       return OrthancPluginErrorCode_Success;
@@ -234,7 +388,8 @@ namespace OrthancDatabases
   {
     try
     {
-      DatabaseManager::Transaction transaction(backend_->GetManager());
+      StorageBackend::Accessor accessor(*backend_);
+      DatabaseManager::Transaction transaction(accessor.GetManager(), true /* read-only */);
       size_t tmp;
       backend_->Read(*content, tmp, transaction, uuid, type);
       *size = static_cast<int64_t>(tmp);
@@ -250,7 +405,8 @@ namespace OrthancDatabases
   {
     try
     {
-      DatabaseManager::Transaction transaction(backend_->GetManager());
+      StorageBackend::Accessor accessor(*backend_);
+      DatabaseManager::Transaction transaction(accessor.GetManager());
       backend_->Remove(transaction, uuid, type);
       transaction.Commit();
       return OrthancPluginErrorCode_Success;
@@ -24,34 +24,104 @@
 #include "../Common/DatabaseManager.h"
 #include <orthanc/OrthancCDatabasePlugin.h>
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <vector>
+
 
 namespace OrthancDatabases
 {
   class StorageBackend : public boost::noncopyable
   {
   private:
+    class AdditionalFactory;
+
     DatabaseManager   manager_;
 
+    // Pool of the connections that serve the requests of Orthanc in
+    // parallel. The first one is "manager_", the others are owned.
+    boost::mutex                    poolMutex_;
+    boost::condition_variable       poolAvailable_;
+    std::vector<DatabaseManager*>   pool_;
+    std::list<DatabaseManager*>     idle_;
+    unsigned int                    groupCommitWindow_;
+    size_t                          nextShared_;
+
   protected:
     void ReadFromString(void*& buffer,
                         size_t& size,
                         const std::string& content);
 
+    // Opens one of the connections that are used in addition to the
+    // main one (cf. "SetConnectionsCount()"). Must neither create the
+    // tables, nor take the advisory lock, which belongs to the main
+    // connection. The connections are opened on their first use, so
+    // this method can be invoked by several threads at once, and
+    // while other connections are running statements: It must only
+    // read members that are not modified after the registration.
+    virtual IDatabase* OpenAdditionalConnection();
+
   public:
     StorageBackend(IDatabaseFactory* factory);
 
-    virtual ~StorageBackend()
-    {
-    }
+    virtual ~StorageBackend();
 
     DatabaseManager& GetManager() 
     {
       return manager_;
     }
+
+    // Number of connections to the database, so that reading a large
+    // attachment does not block the other requests (defaults to 1).
+    // Must be called before registering the storage area.
+    void SetConnectionsCount(unsigned int count);
+
+    unsigned int GetConnectionsCount();
+
+    // Group commit of the writes to the storage area, in milliseconds
+    // ("0" means disabled, which is the default). The connections of
+    // the pool are then shared by the requests, so that the writes
+    // that are received in parallel are committed together (cf.
+    // "DatabaseManager::SetGroupCommit()"). Must be called before
+    // registering the storage area.
+    void SetGroupCommit(unsigned int windowMilliseconds);
+
+
+    // Gives exclusive access to one idle connection of the pool,
+    // waiting for one to be released if they are all busy. If group
+    // commit is enabled, the connections are rather shared in turn.
+    class Accessor : public boost::noncopyable
+    {
+    private:
+      StorageBackend&   backend_;
+      DatabaseManager*  manager_;
+      bool              shared_;
+
+    public:
+      explicit Accessor(StorageBackend& backend);
+
+      ~Accessor();
+
+      DatabaseManager& GetManager()
+      {
+        return *manager_;
+      }
+    };
     
-    // NB: These methods will always be invoked in mutual exclusion,
-    // as having access to some "DatabaseManager::Transaction" implies
-    // that the parent "DatabaseManager" is locked
+    /**
+     * Threading rules of the three methods below. They are invoked
+     * by the HTTP threads of Orthanc, in parallel, each call on the
+     * connection of the pool that was given to its "Accessor":
+     *
+     * - The calls that share one connection are serialized by the
+     *   lock of its "DatabaseManager" (with group commit, this lock
+     *   is released only while waiting for the commit), so one
+     *   connection never runs two statements at once.
+     * - The calls on different connections run concurrently. The
+     *   subclasses must therefore only access the database through
+     *   "transaction", and must not modify their own members.
+     **/
     virtual void Create(DatabaseManager::Transaction& transaction,
                         const std::string& uuid,
                         const void* content,
@@ -31,11 +31,23 @@
 
 #include <boost/lexical_cast.hpp>
 
+#if defined(_WIN32)
+#  include <winsock2.h>
+#else
+#  include <sys/select.h>
+#endif
+
 // PostgreSQL includes
 #include <libpq-fe.h>
 #include <c.h>
 #include <catalog/pg_type.h>
 
+#if defined(LIBPQ_HAS_PIPELINING) && LIBPQ_HAS_PIPELINING == 1
+#  define ORTHANC_HAS_LIBPQ_PIPELINING  1
+#else
+#  define ORTHANC_HAS_LIBPQ_PIPELINING  0
+#endif
+
 
 namespace OrthancDatabases
 {
@@ -58,14 +70,246 @@ namespace OrthancDatabases
   }
 
 
+  void PostgreSQLDatabase::ThrowStatementException(const std::string& message,
+                                                   const std::string& sqlState)
+  {
+    if (sqlState == "57014" /* query_canceled */ &&
+        PQstatus(reinterpret_cast<PGconn*>(pg_)) == CONNECTION_OK)
+    {
+      LOG(ERROR) << "PostgreSQL: The statement was cancelled, as it exceeded its timeout";
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_Timeout);
+    }
+    else
+    {
+      LOG(ERROR) << "PostgreSQL error: " << message;
+      ThrowException(false);
+    }
+  }
+
+
+  uint64_t PostgreSQLDatabase::ArmWatchdog(unsigned int milliseconds)
+  {
+    if (milliseconds == 0)
+    {
+      return 0;
+    }
+    else
+    {
+      if (watchdog_.get() == NULL)
+      {
+        watchdog_.reset(new PostgreSQLWatchdog(pg_));
+      }
+
+      return watchdog_->Arm(milliseconds);
+    }
+  }
+
+
+  void PostgreSQLDatabase::DisarmWatchdog(uint64_t generation)
+  {
+    if (generation != 0 &&
+        watchdog_.get() != NULL)
+    {
+      watchdog_->Disarm(generation);
+    }
+  }
+
+
   void PostgreSQLDatabase::Close()
   {
+    // The watchdog refers to the connection
+    watchdog_.reset(NULL);
+
     if (pg_ != NULL)
     {
       LOG(INFO) << "Closing connection to PostgreSQL";
       PQfinish(reinterpret_cast<PGconn*>(pg_));
       pg_ = NULL;
     }
+
+    pipeline_ = false;
+    pipelined_ = 0;
+    deallocations_.clear();
+  }
+
+
+  bool PostgreSQLDatabase::IsPipelineEnabled() const
+  {
+#if ORTHANC_HAS_LIBPQ_PIPELINING == 1
+    return parameters_.IsPipelining();
+#else
+    return false;
+#endif
+  }
+
+
+  void PostgreSQLDatabase::EnterPipeline()
+  {
+#if ORTHANC_HAS_LIBPQ_PIPELINING == 1
+    if (!pipeline_)
+    {
+      if (!PQenterPipelineMode(reinterpret_cast<PGconn*>(pg_)))
+      {
+        ThrowException(true);
+      }
+
+      pipeline_ = true;
+      pipelined_ = 0;
+    }
+#else
+    throw Orthanc::OrthancException(Orthanc::ErrorCode_NotImplemented);
+#endif
+  }
+
+
+  bool PostgreSQLDatabase::SyncPipeline(const char* lastCommand)
+  {
+    if (!pipeline_)
+    {
+      return true;
+    }
+
+#if ORTHANC_HAS_LIBPQ_PIPELINING == 1
+    PGconn* pg = reinterpret_cast<PGconn*>(pg_);
+
+    unsigned int expected = pipelined_;
+    pipelined_ = 0;
+
+    std::string error;
+
+    if (lastCommand != NULL)
+    {
+      if (PQsendQueryParams(pg, lastCommand, 0, NULL, NULL, NULL, NULL, 1))
+      {
+        expected++;
+      }
+      else
+      {
+        error = PQerrorMessage(pg);
+      }
+    }
+
+    if (!PQpipelineSync(pg))
+    {
+      // The connection is lost
+      error = PQerrorMessage(pg);
+      expected = 0;
+    }
+
+    for (unsigned int i = 0; i < expected; i++)
+    {
+      PGresult* result = PQgetResult(pg);
+      if (result == NULL)
+      {
+        error = PQerrorMessage(pg);
+        break;
+      }
+
+      ExecStatusType status = PQresultStatus(result);
+      if (status != PGRES_COMMAND_OK &&
+          status != PGRES_TUPLES_OK &&
+          error.empty())
+      {
+        // The statements after the faulty one are reported as
+        // "PGRES_PIPELINE_ABORTED", keep the first error
+        error = PQresultErrorMessage(result);
+      }
+
+      PQclear(result);
+
+      // In pipeline mode, the results of each statement are
+      // terminated by NULL
+      while ((result = PQgetResult(pg)) != NULL)
+      {
+        PQclear(result);
+      }
+    }
+
+    for (;;)
+    {
+      PGresult* result = PQgetResult(pg);
+      if (result == NULL)
+      {
+        break;
+      }
+
+      bool sync = (PQresultStatus(result) == PGRES_PIPELINE_SYNC);
+      PQclear(result);
+
+      if (sync)
+      {
+        break;
+      }
+    }
+
+    if (!PQexitPipelineMode(pg) &&
+        error.empty())
+    {
+      error = PQerrorMessage(pg);
+    }
+
+    pipeline_ = false;
+
+    std::list<std::string> deallocations;
+    deallocations.swap(deallocations_);
+
+    for (std::list<std::string>::const_iterator it = deallocations.begin();
+         it != deallocations.end(); ++it)
+    {
+      DeallocateStatement(*it);
+    }
+
+    if (error.empty())
+    {
+      return true;
+    }
+    else
+    {
+      LOG(ERROR) << "PostgreSQL error in pipeline mode: " << error;
+      return false;
+    }
+#else
+    throw Orthanc::OrthancException(Orthanc::ErrorCode_InternalError);
+#endif
+  }
+
+
+  void PostgreSQLDatabase::FlushPipeline(const char* lastCommand)
+  {
+    if (!SyncPipeline(lastCommand))
+    {
+      ThrowException(false);
+    }
+  }
+
+
+  void PostgreSQLDatabase::DeallocateStatement(const std::string& id)
+  {
+    if (pg_ == NULL)
+    {
+      // The server has dropped the statement together with the connection
+    }
+    else if (pipeline_)
+    {
+      // Synchronous commands are not allowed in pipeline mode
+      deallocations_.push_back(id);
+    }
+    else
+    {
+      PGconn* pg = reinterpret_cast<PGconn*>(pg_);
+      PGresult* result = PQexec(pg, ("DEALLOCATE \"" + id + "\"").c_str());
+
+      if (result == NULL ||
+          PQresultStatus(result) != PGRES_COMMAND_OK)
+      {
+        LOG(WARNING) << "Cannot deallocate a prepared statement: " << PQerrorMessage(pg);
+      }
+
+      if (result != NULL)
+      {
+        PQclear(result);
+      }
+    }
   }
 
 
@@ -137,6 +381,7 @@ namespace OrthancDatabases
   {
     LOG(TRACE) << "PostgreSQL: " << sql;
     Open();
+    FlushPipeline(NULL);
 
     PGresult* result = PQexec(reinterpret_cast<PGconn*>(pg_), sql.c_str());
     if (result == NULL)
@@ -183,6 +428,62 @@ namespace OrthancDatabases
   }
 
 
+  bool PostgreSQLDatabase::WaitNotifications(unsigned int timeout)
+  {
+    Open();
+
+    PGconn* pg = reinterpret_cast<PGconn*>(pg_);
+
+    int socket = PQsocket(pg);
+    if (socket < 0)
+    {
+      ThrowException(true);
+    }
+
+    fd_set input;
+    FD_ZERO(&input);
+    FD_SET(socket, &input);
+
+    struct timeval tv;
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+
+    if (select(socket + 1, &input, NULL, NULL, &tv) < 0)
+    {
+      LOG(ERROR) << "PostgreSQL: Error while waiting for notifications";
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_DatabaseUnavailable);
+    }
+
+    if (!PQconsumeInput(pg))
+    {
+      ThrowException(true);
+    }
+
+    bool received = false;
+
+    for (;;)
+    {
+      PGnotify* notification = PQnotifies(pg);
+      if (notification == NULL)
+      {
+        return received;
+      }
+      else
+      {
+        received = true;
+        PQfreemem(notification);
+      }
+    }
+  }
+
+
+  int PostgreSQLDatabase::GetServerVersion()
+  {
+    Open();
+    return PQserverVersion(reinterpret_cast<PGconn*>(pg_));
+  }
+
+
   void PostgreSQLDatabase::ClearAll()
   {
     PostgreSQLTransaction transaction(*this);
@@ -207,6 +508,12 @@ namespace OrthancDatabases
   }
 
 
+  void PostgreSQLDatabase::Prepare(const std::vector<IPrecompiledStatement*>& statements)
+  {
+    PostgreSQLStatement::PrepareBatch(*this, statements);
+  }
+
+
   namespace
   {
     class PostgreSQLImplicitTransaction : public ImplicitTransaction
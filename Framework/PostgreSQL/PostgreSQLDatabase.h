@@ -26,8 +26,12 @@
 #endif
 
 #include "PostgreSQLParameters.h"
+#include "PostgreSQLWatchdog.h"
 #include "../Common/IDatabase.h"
 
+#include <list>
+#include <memory>
+
 namespace OrthancDatabases
 {
   class PostgreSQLDatabase : public IDatabase
@@ -35,18 +39,45 @@ namespace OrthancDatabases
   private:
     friend class PostgreSQLStatement;
     friend class PostgreSQLLargeObject;
+    friend class PostgreSQLResult;
+
+    PostgreSQLParameters    parameters_;
+    void*                   pg_;   /* Object of type "PGconn*" */
+    bool                    pipeline_;
+    unsigned int            pipelined_;
+    std::list<std::string>  deallocations_;
 
-    PostgreSQLParameters  parameters_;
-    void*                 pg_;   /* Object of type "PGconn*" */
+    // Cancels the statements that exceed their timeout (created by
+    // the first statement with a timeout)
+    std::auto_ptr<PostgreSQLWatchdog>  watchdog_;
 
     void ThrowException(bool log);
 
+    // Reports "ErrorCode_Timeout" if the statement was cancelled
+    // because of its timeout, or behaves as "ThrowException()"
+    void ThrowStatementException(const std::string& message,
+                                 const std::string& sqlState);
+
+    // Cf. "PostgreSQLWatchdog" ("0" means no timeout). Returns the
+    // generation to be disarmed, or "0" if the watchdog was not armed.
+    uint64_t ArmWatchdog(unsigned int milliseconds);
+
+    void DisarmWatchdog(uint64_t generation);
+
     void Close();
 
+    void EnterPipeline();
+
+    bool SyncPipeline(const char* lastCommand);
+
+    void DeallocateStatement(const std::string& id);
+
   public:
     PostgreSQLDatabase(const PostgreSQLParameters& parameters) :
     parameters_(parameters),
-    pg_(NULL)
+    pg_(NULL),
+    pipeline_(false),
+    pipelined_(0)
     {
     }
 
@@ -60,8 +91,40 @@ namespace OrthancDatabases
 
     bool DoesTableExist(const char* name);
 
+    // Version of the server, e.g. "110005" for PostgreSQL 11.5
+    int GetServerVersion();
+
+    // Waits for at most "timeout" milliseconds for the asynchronous
+    // notifications on the channels this connection is listening to
+    // (cf. "LISTEN"). Returns "true" iff some notification was received.
+    bool WaitNotifications(unsigned int timeout);
+
     void ClearAll();   // Only for unit tests!
 
+    /**
+     * Pipeline mode of libpq >= 14: Inside explicit transactions, the
+     * statements whose result is not needed are only queued, and are
+     * sent at once as soon as some statement returns rows, or at the
+     * commit. Errors are thus reported by "FlushPipeline()", which is
+     * invoked before any other use of the connection.
+     **/
+    bool IsPipelineEnabled() const;
+
+    bool IsPipelineActive() const
+    {
+      return pipeline_;
+    }
+
+    // If "lastCommand" is not NULL, it is appended to the pipeline
+    // before flushing, which saves one round trip (e.g. "COMMIT")
+    void FlushPipeline(const char* lastCommand);
+
+    // Waits for the queued statements, ignoring their errors
+    void DiscardPipeline()
+    {
+      SyncPipeline(NULL);
+    }
+
     virtual Dialect GetDialect() const
     {
       return Dialect_PostgreSQL;
@@ -69,6 +132,9 @@ namespace OrthancDatabases
 
     virtual IPrecompiledStatement* Compile(const Query& query);
 
+    // The statements are sent in one single query of SQL "PREPARE"
+    virtual void Prepare(const std::vector<IPrecompiledStatement*>& statements);
+
     virtual ITransaction* CreateTransaction(bool isImplicit);
   };
 }
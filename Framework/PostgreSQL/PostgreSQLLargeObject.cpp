@@ -34,6 +34,10 @@ namespace OrthancDatabases
 {  
   void PostgreSQLLargeObject::Create()
   {
+    // The functions of libpq related to large objects are not
+    // available in pipeline mode
+    database_.FlushPipeline(NULL);
+
     PGconn* pg = reinterpret_cast<PGconn*>(database_.pg_);
 
     oid_ = lo_creat(pg, INV_WRITE);
@@ -117,6 +121,8 @@ namespace OrthancDatabases
            const std::string& oid) : 
       database_(database)
     {
+      database.FlushPipeline(NULL);
+
       PGconn* pg = reinterpret_cast<PGconn*>(database.pg_);
       Oid id = boost::lexical_cast<Oid>(oid);
 
@@ -219,6 +225,8 @@ namespace OrthancDatabases
   void PostgreSQLLargeObject::Delete(PostgreSQLDatabase& database,
                                      const std::string& oid)
   {
+    database.FlushPipeline(NULL);
+
     PGconn* pg = reinterpret_cast<PGconn*>(database.pg_);
     Oid id = boost::lexical_cast<Oid>(oid);
 
@@ -38,6 +38,7 @@ namespace OrthancDatabases
     database_.clear();
     uri_.clear();
     lock_ = true;
+    pipelining_ = true;
   }
 
 
@@ -87,6 +88,7 @@ namespace OrthancDatabases
     }
 
     lock_ = configuration.GetBooleanValue("Lock", true);  // Use locking by default
+    pipelining_ = configuration.GetBooleanValue("EnablePipelining", true);
   }
 
 
@@ -39,6 +39,7 @@ namespace OrthancDatabases
     std::string  database_;
     std::string  uri_;
     bool         lock_;
+    bool         pipelining_;
 
     void Reset();
 
@@ -101,6 +102,17 @@ namespace OrthancDatabases
       return lock_;
     }
 
+    // Only effective if libpq >= 14 (cf. "PostgreSQLDatabase")
+    void SetPipelining(bool pipelining)
+    {
+      pipelining_ = pipelining;
+    }
+
+    bool IsPipelining() const
+    {
+      return pipelining_;
+    }
+
     void Format(std::string& target) const;
   };
 }
@@ -53,6 +53,74 @@ namespace OrthancDatabases
   }
 
 
+  void PostgreSQLResult::Drain()
+  {
+    // Skip the remaining rows, so that the connection can be reused
+    while (pending_)
+    {
+      PGresult* result = PQgetResult(reinterpret_cast<PGconn*>(database_.pg_));
+
+      if (result == NULL)
+      {
+        pending_ = false;
+        database_.DisarmWatchdog(watchdog_);
+      }
+      else
+      {
+        PQclear(result);
+      }
+    }
+  }
+
+
+  void PostgreSQLResult::FetchStreamedRow()
+  {
+    assert(streaming_ && result_ == NULL);
+
+    if (!pending_)
+    {
+      return;
+    }
+
+    PGresult* result = PQgetResult(reinterpret_cast<PGconn*>(database_.pg_));
+
+    if (result == NULL)
+    {
+      pending_ = false;
+      database_.DisarmWatchdog(watchdog_);
+      return;
+    }
+
+    switch (PQresultStatus(result))
+    {
+      case PGRES_SINGLE_TUPLE:
+        result_ = result;
+        position_ = 0;
+        columnsCount_ = static_cast<unsigned int>(PQnfields(result));
+        break;
+
+      case PGRES_TUPLES_OK:
+      case PGRES_COMMAND_OK:
+        // We are at the end of the result set
+        columnsCount_ = static_cast<unsigned int>(PQnfields(result));
+        PQclear(result);
+        Drain();
+        break;
+
+      default:
+      {
+        std::string message = PQresultErrorMessage(result);
+        const char* state = PQresultErrorField(result, PG_DIAG_SQLSTATE);
+        std::string sqlState = (state == NULL ? "" : state);
+        PQclear(result);
+        Drain();
+
+        database_.ThrowStatementException(message, sqlState);
+      }
+    }
+  }
+
+
   void PostgreSQLResult::CheckDone()
   {
     if (position_ >= PQntuples(reinterpret_cast<PGresult*>(result_)))
@@ -84,18 +152,43 @@ namespace OrthancDatabases
 
 
   PostgreSQLResult::PostgreSQLResult(PostgreSQLStatement& statement) : 
+    result_(NULL),
     position_(0), 
-    database_(statement.GetDatabase())
+    database_(statement.GetDatabase()),
+    columnsCount_(0),
+    streaming_(statement.IsStreaming()),
+    pending_(false),
+    watchdog_(0)
   {
+    if (streaming_)
+    {
+      watchdog_ = statement.Send();
+      pending_ = true;
+      FetchStreamedRow();
+      return;
+    }
+
     result_ = statement.Execute();
     assert(result_ != NULL);   // An exception would have been thrown otherwise
 
     // This is the first call to "Next()"
-    if (PQresultStatus(reinterpret_cast<PGresult*>(result_)) == PGRES_TUPLES_OK)
+    ExecStatusType status = PQresultStatus(reinterpret_cast<PGresult*>(result_));
+    if (status == PGRES_TUPLES_OK)
     {
       CheckDone();
       columnsCount_ = static_cast<unsigned int>(PQnfields(reinterpret_cast<PGresult*>(result_)));
     }
+    else if (status == PGRES_FATAL_ERROR ||
+             status == PGRES_BAD_RESPONSE)
+    {
+      PGresult* result = reinterpret_cast<PGresult*>(result_);
+      std::string message = PQresultErrorMessage(result);
+      const char* state = PQresultErrorField(result, PG_DIAG_SQLSTATE);
+      std::string sqlState = (state == NULL ? "" : state);
+      Clear();
+
+      database_.ThrowStatementException(message, sqlState);
+    }
     else
     {
       // This is not a SELECT request, we're done
@@ -110,6 +203,7 @@ namespace OrthancDatabases
     try
     {
       Clear();
+      Drain();
     }
     catch (Orthanc::OrthancException&)
     {
@@ -120,8 +214,16 @@ namespace OrthancDatabases
 
   void PostgreSQLResult::Next()
   {
-    position_++;
-    CheckDone();
+    if (streaming_)
+    {
+      Clear();
+      FetchStreamedRow();
+    }
+    else
+    {
+      position_++;
+      CheckDone();
+    }
   }
 
 
@@ -179,6 +281,13 @@ namespace OrthancDatabases
   {
     CheckColumn(column, OIDOID);
 
+    if (streaming_)
+    {
+      // The connection is busy with the rows that are still pending
+      LOG(ERROR) << "Cannot read a large object from a streamed result";
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
     Oid oid;
     assert(PQfsize(reinterpret_cast<PGresult*>(result_), column) == sizeof(oid));
 
@@ -195,6 +304,13 @@ namespace OrthancDatabases
   {
     CheckColumn(column, OIDOID);
 
+    if (streaming_)
+    {
+      // The connection is busy with the rows that are still pending
+      LOG(ERROR) << "Cannot read a large object from a streamed result";
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
     Oid oid;
     assert(PQfsize(reinterpret_cast<PGresult*>(result_), column) == sizeof(oid));
 
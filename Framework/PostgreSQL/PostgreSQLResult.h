@@ -36,9 +36,16 @@ namespace OrthancDatabases
     int                  position_;
     PostgreSQLDatabase&  database_;
     unsigned int         columnsCount_;
+    bool                 streaming_;
+    bool                 pending_;   // Streaming, and "PQgetResult()" has not returned NULL yet
+    uint64_t             watchdog_;  // Generation of the watchdog while streaming
 
     void Clear();
 
+    void Drain();
+
+    void FetchStreamedRow();
+
     void CheckDone();
 
     void CheckColumn(unsigned int column, /*Oid*/ unsigned int expectedType) const;
@@ -33,7 +33,9 @@
 #include <Core/OrthancException.h>
 #include <Core/Toolbox.h>
 
+#include <algorithm>
 #include <cassert>
+#include <set>
 
 // PostgreSQL includes
 #include <libpq-fe.h>
@@ -50,6 +52,7 @@ namespace OrthancDatabases
   private:
     std::vector<char*> values_;
     std::vector<int> sizes_;
+    std::vector<bool> borrowed_;  // Items pointing to memory owned by the caller
 
     static char* Allocate(const void* source, int size)
     {
@@ -75,12 +78,25 @@ namespace OrthancDatabases
       // Shrinking of the vector
       for (size_t i = size; i < values_.size(); i++)
       {
-        if (values_[i] != NULL)
-          free(values_[i]);
+        Release(i);
       }
 
       values_.resize(size, NULL);
       sizes_.resize(size, 0);
+      borrowed_.resize(size, false);
+    }
+
+    void Release(size_t pos)
+    {
+      if (values_[pos] != NULL &&
+          !borrowed_[pos])
+      {
+        free(values_[pos]);
+      }
+
+      values_[pos] = NULL;
+      sizes_[pos] = 0;
+      borrowed_[pos] = false;
     }
 
     void EnlargeForIndex(size_t index)
@@ -106,7 +122,8 @@ namespace OrthancDatabases
     {
       EnlargeForIndex(pos);
 
-      if (sizes_[pos] == size)
+      if (sizes_[pos] == size &&
+          !borrowed_[pos])
       {
         if (source && size != 0)
         {
@@ -115,16 +132,24 @@ namespace OrthancDatabases
       }
       else
       {
-        if (values_[pos] != NULL)
-        {
-          free(values_[pos]);
-        }
-
+        Release(pos);
         values_[pos] = Allocate(source, size);
         sizes_[pos] = size;
       }
     }
 
+    // The item points directly to "source", that must remain valid
+    // until the statement has been sent to the server
+    void SetBorrowedItem(size_t pos, const void* source, int size)
+    {
+      EnlargeForIndex(pos);
+      Release(pos);
+
+      values_[pos] = const_cast<char*>(reinterpret_cast<const char*>(source));
+      sizes_[pos] = size;
+      borrowed_[pos] = true;
+    }
+
     void SetItem(size_t pos, int size)
     {
       SetItem(pos, NULL, size);
@@ -169,6 +194,9 @@ namespace OrthancDatabases
       }
     }
 
+    // "PQprepare()" is not allowed in pipeline mode
+    database_.FlushPipeline(NULL);
+
     id_ = Orthanc::Toolbox::GenerateUuid();
 
     const unsigned int* tmp = oids_.size() ? &oids_[0] : NULL;
@@ -198,14 +226,129 @@ namespace OrthancDatabases
   }
 
 
+  static const char* GetTypeName(unsigned int /*Oid*/ type)
+  {
+    switch (type)
+    {
+      case INT4OID:
+        return "int4";
+
+      case INT8OID:
+        return "int8";
+
+      case TEXTOID:
+        return "text";
+
+      case BYTEAOID:
+        return "bytea";
+
+      case OIDOID:
+        return "oid";
+
+      default:
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_InternalError);
+    }
+  }
+
+
+  void PostgreSQLStatement::PrepareBatch(PostgreSQLDatabase& database,
+                                         const std::vector<IPrecompiledStatement*>& statements)
+  {
+    std::vector<PostgreSQLStatement*> batch;
+    std::string sql;
+
+    for (size_t i = 0; i < statements.size(); i++)
+    {
+      PostgreSQLStatement& statement = dynamic_cast<PostgreSQLStatement&>(*statements[i]);
+
+      if (&statement.database_ != &database ||
+          statement.id_.size() > 0 ||
+          std::find(statement.oids_.begin(), statement.oids_.end(), 0u) != statement.oids_.end())
+      {
+        // Already prepared, or the type of an input parameter is
+        // not set: Let "Prepare()" handle this statement
+        continue;
+      }
+
+      statement.id_ = Orthanc::Toolbox::GenerateUuid();
+      batch.push_back(&statement);
+
+      sql += "PREPARE \"" + statement.id_ + "\"";
+
+      for (size_t j = 0; j < statement.oids_.size(); j++)
+      {
+        sql += (j == 0 ? "(" : ", ");
+        sql += GetTypeName(statement.oids_[j]);
+      }
+
+      sql += (statement.oids_.empty() ? " AS " : ") AS ");
+      sql += statement.sql_ + ";\n";
+    }
+
+    if (batch.empty())
+    {
+      return;
+    }
+
+    database.FlushPipeline(NULL);
+
+    PGconn* pg = reinterpret_cast<PGconn*>(database.pg_);
+
+    PGresult* result = PQexec(pg, sql.c_str());
+
+    bool ok = (result != NULL &&
+               PQresultStatus(result) == PGRES_COMMAND_OK);
+
+    if (result != NULL)
+    {
+      PQclear(result);
+    }
+
+    if (!ok)
+    {
+      LOG(WARNING) << "Cannot prepare the statements at once, they will be prepared "
+                   << "on their first use: " << PQerrorMessage(pg);
+
+      // The statements before the faulty one are prepared, and
+      // DEALLOCATE is needed for them
+      std::set<std::string> prepared;
+
+      result = PQexec(pg, "SELECT name FROM pg_prepared_statements");
+
+      if (result != NULL &&
+          PQresultStatus(result) == PGRES_TUPLES_OK)
+      {
+        for (int i = 0; i < PQntuples(result); i++)
+        {
+          prepared.insert(PQgetvalue(result, i, 0));
+        }
+      }
+
+      if (result != NULL)
+      {
+        PQclear(result);
+      }
+
+      for (size_t i = 0; i < batch.size(); i++)
+      {
+        if (prepared.find(batch[i]->id_) == prepared.end())
+        {
+          batch[i]->id_.clear();
+        }
+      }
+    }
+  }
+
+
   void PostgreSQLStatement::Unprepare()
   {
     if (id_.size() > 0)
     {
       // "Although there is no libpq function for deleting a
       // prepared statement, the SQL DEALLOCATE statement can be
-      // used for that purpose."
-      //database_.Execute("DEALLOCATE " + id_);
+      // used for that purpose." The connection is not reopened if it
+      // was lost, as the server has dropped the statement in this case.
+      database_.DeallocateStatement(id_);
     }
 
     id_.clear();
@@ -261,6 +404,8 @@ namespace OrthancDatabases
   void* /* PGresult* */ PostgreSQLStatement::Execute()
   {
     Prepare();
+    database_.FlushPipeline(NULL);
+    const uint64_t generation = database_.ArmWatchdog(timeout_);
 
     PGresult* result;
 
@@ -282,6 +427,8 @@ namespace OrthancDatabases
                               1);
     }
 
+    database_.DisarmWatchdog(generation);
+
     if (result == NULL)
     {
       database_.ThrowException(true);
@@ -291,11 +438,92 @@ namespace OrthancDatabases
   }
 
 
+  uint64_t PostgreSQLStatement::Send()
+  {
+    Prepare();
+    database_.FlushPipeline(NULL);
+    const uint64_t generation = database_.ArmWatchdog(timeout_);  // Disarmed by "PostgreSQLResult"
+
+    PGconn* pg = reinterpret_cast<PGconn*>(database_.pg_);
+
+    int ok;
+
+    if (oids_.size() == 0)
+    {
+      // No parameter
+      ok = PQsendQueryPrepared(pg, id_.c_str(), 0, NULL, NULL, NULL, 1);
+    }
+    else
+    {
+      // At least 1 parameter
+      ok = PQsendQueryPrepared(pg,
+                               id_.c_str(),
+                               oids_.size(),
+                               &inputs_->GetValues()[0],
+                               &inputs_->GetSizes()[0],
+                               &binary_[0],
+                               1);
+    }
+
+    if (!ok ||
+        !PQsetSingleRowMode(pg))
+    {
+      database_.DisarmWatchdog(generation);
+      database_.ThrowException(true);
+    }
+
+    return generation;
+  }
+
+
+  void PostgreSQLStatement::Enqueue()
+  {
+    // The statement must be prepared before entering pipeline mode,
+    // which is only the case of its first execution on the connection
+    Prepare();
+    database_.EnterPipeline();
+
+    PGconn* pg = reinterpret_cast<PGconn*>(database_.pg_);
+
+    int ok;
+
+    if (oids_.size() == 0)
+    {
+      ok = PQsendQueryPrepared(pg, id_.c_str(), 0, NULL, NULL, NULL, 1);
+    }
+    else
+    {
+      ok = PQsendQueryPrepared(pg,
+                               id_.c_str(),
+                               oids_.size(),
+                               &inputs_->GetValues()[0],
+                               &inputs_->GetSizes()[0],
+                               &binary_[0],
+                               1);
+    }
+
+    if (!ok)
+    {
+      database_.ThrowException(true);
+    }
+
+    database_.pipelined_++;
+  }
+
+
+  bool PostgreSQLStatement::HasLargeObjectParameter() const
+  {
+    return (std::find(oids_.begin(), oids_.end(), static_cast<unsigned int>(OIDOID)) != oids_.end());
+  }
+
+
   PostgreSQLStatement::PostgreSQLStatement(PostgreSQLDatabase& database,
                                            const std::string& sql,
                                            bool readOnly) :
     database_(database),
     readOnly_(readOnly),
+    streaming_(false),
+    timeout_(0),
     sql_(sql),
     inputs_(new Inputs),
     formatter_(Dialect_PostgreSQL)
@@ -308,6 +536,8 @@ namespace OrthancDatabases
                                            const Query& query) :
     database_(database),
     readOnly_(query.IsReadOnly()),
+    streaming_(query.IsStreaming()),
+    timeout_(query.GetTimeout()),
     inputs_(new Inputs),
     formatter_(Dialect_PostgreSQL)
   {
@@ -450,6 +680,24 @@ namespace OrthancDatabases
   }
 
 
+  void PostgreSQLStatement::BindStringReference(unsigned int param,
+                                                const std::string& value)
+  {
+    if (param >= oids_.size())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+    }
+
+    if (oids_[param] != TEXTOID && oids_[param] != BYTEAOID)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadParameterType);
+    }
+
+    // "c_str()" is guaranteed to be followed by the end-of-string character
+    inputs_->SetBorrowedItem(param, value.c_str(), value.size() + 1);
+  }
+
+
   void PostgreSQLStatement::BindLargeObject(unsigned int param,
                                             const PostgreSQLLargeObject& value)
   {
@@ -500,8 +748,7 @@ namespace OrthancDatabases
   };
 
 
-  IResult* PostgreSQLStatement::Execute(ITransaction& transaction,
-                                        const Dictionary& parameters)
+  void PostgreSQLStatement::Bind(const Dictionary& parameters)
   {
     for (size_t i = 0; i < formatter_.GetParametersCount(); i++)
     {
@@ -518,13 +765,13 @@ namespace OrthancDatabases
           break;
 
         case ValueType_Utf8String:
-          BindString(i, dynamic_cast<const Utf8StringValue&>
-                     (parameters.GetValue(name)).GetContent());
+          BindStringReference(i, dynamic_cast<const Utf8StringValue&>
+                              (parameters.GetValue(name)).GetContent());
           break;
 
         case ValueType_BinaryString:
-          BindString(i, dynamic_cast<const BinaryStringValue&>
-                     (parameters.GetValue(name)).GetContent());
+          BindStringReference(i, dynamic_cast<const BinaryStringValue&>
+                              (parameters.GetValue(name)).GetContent());
           break;
 
         case ValueType_File:
@@ -532,7 +779,7 @@ namespace OrthancDatabases
           const FileValue& blob =
             dynamic_cast<const FileValue&>(parameters.GetValue(name));
 
-          PostgreSQLLargeObject largeObject(database_, blob.GetContent());
+          PostgreSQLLargeObject largeObject(database_, blob.GetBuffer(), blob.GetSize());
           BindLargeObject(i, largeObject);
           break;
         }
@@ -541,7 +788,13 @@ namespace OrthancDatabases
           throw Orthanc::OrthancException(Orthanc::ErrorCode_InternalError);
       }
     }
+  }
+
 
+  IResult* PostgreSQLStatement::Execute(ITransaction& transaction,
+                                        const Dictionary& parameters)
+  {
+    Bind(parameters);
     return new ResultWrapper(*this);
   }
 
@@ -549,6 +802,17 @@ namespace OrthancDatabases
   void PostgreSQLStatement::ExecuteWithoutResult(ITransaction& transaction,
                                                  const Dictionary& parameters)
   {
-    std::auto_ptr<IResult> dummy(Execute(transaction, parameters));
+    if (!transaction.IsImplicit() &&
+        !HasLargeObjectParameter() &&
+        database_.IsPipelineEnabled() &&
+        timeout_ == 0)  // The watchdog needs the end of the statement
+    {
+      Bind(parameters);
+      Enqueue();
+    }
+    else
+    {
+      std::auto_ptr<IResult> dummy(Execute(transaction, parameters));
+    }
   }
 }
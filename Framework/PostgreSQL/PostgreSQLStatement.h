@@ -48,6 +48,8 @@ namespace OrthancDatabases
 
     PostgreSQLDatabase& database_;
     bool readOnly_;
+    bool streaming_;
+    unsigned int timeout_;
     std::string id_;
     std::string sql_;
     std::vector<unsigned int /*Oid*/>  oids_;
@@ -64,11 +66,31 @@ namespace OrthancDatabases
 
     void* /* PGresult* */ Execute();
 
+    // Sends the statement in single-row mode: The rows are then
+    // retrieved one by one with "PQgetResult()". Returns the
+    // generation of the watchdog (cf. "PostgreSQLDatabase::ArmWatchdog()").
+    uint64_t Send();
+
+    // Queues the statement in the pipeline of the connection
+    void Enqueue();
+
+    bool HasLargeObjectParameter() const;
+
+    // Contrarily to "BindString()", the value is not copied, and must
+    // outlive the execution of the statement
+    void BindStringReference(unsigned int param, const std::string& value);
+
+    void Bind(const Dictionary& parameters);
+
   public:
     PostgreSQLStatement(PostgreSQLDatabase& database,
                         const std::string& sql,
                         bool readOnly);
 
+    // Cf. "PostgreSQLDatabase::Prepare()"
+    static void PrepareBatch(PostgreSQLDatabase& database,
+                             const std::vector<IPrecompiledStatement*>& statements);
+
     PostgreSQLStatement(PostgreSQLDatabase& database,
                         const Query& query);
 
@@ -79,6 +101,11 @@ namespace OrthancDatabases
       return readOnly_;
     }
 
+    bool IsStreaming() const
+    {
+      return streaming_;
+    }
+
     void DeclareInputInteger(unsigned int param);
     
     void DeclareInputInteger64(unsigned int param);
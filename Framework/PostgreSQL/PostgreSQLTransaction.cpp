@@ -45,6 +45,7 @@ namespace OrthancDatabases
 
       try
       {
+        database_.DiscardPipeline();
         database_.Execute("ABORT");
       }
       catch (Orthanc::OrthancException&)
@@ -79,6 +80,7 @@ namespace OrthancDatabases
       throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
     }
 
+    database_.DiscardPipeline();
     database_.Execute("ABORT");
     isOpen_ = false;
   }
@@ -93,7 +95,17 @@ namespace OrthancDatabases
       throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
     }
 
-    database_.Execute("COMMIT");
+    if (database_.IsPipelineActive())
+    {
+      // Send "COMMIT" together with the queued statements, which
+      // saves one round trip
+      database_.FlushPipeline("COMMIT");
+    }
+    else
+    {
+      database_.Execute("COMMIT");
+    }
+
     isOpen_ = false;
   }
 
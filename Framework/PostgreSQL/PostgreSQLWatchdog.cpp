@@ -0,0 +1,132 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "PostgreSQLWatchdog.h"
+
+#include <Core/Logging.h>
+#include <Core/OrthancException.h>
+
+// PostgreSQL includes
+#include <libpq-fe.h>
+
+namespace OrthancDatabases
+{
+  void PostgreSQLWatchdog::Worker(PostgreSQLWatchdog* that)
+  {
+    boost::mutex::scoped_lock lock(that->mutex_);
+
+    while (that->continue_)
+    {
+      if (!that->armed_)
+      {
+        that->changed_.wait(lock);
+      }
+      else
+      {
+        const uint64_t generation = that->generation_;
+        that->changed_.timed_wait(lock, that->deadline_);
+
+        if (that->armed_ &&
+            that->generation_ == generation &&
+            boost::get_system_time() >= that->deadline_)
+        {
+          // The statement is still running after its deadline. The
+          // mutex is kept, so that "Disarm()" waits for the request:
+          // If the statement has finished in the meantime, the server
+          // receives the cancel while it is idle and ignores it,
+          // before the next statement is sent.
+          char error[256];
+          if (!PQcancel(reinterpret_cast<PGcancel*>(that->cancel_), error, sizeof(error)))
+          {
+            LOG(WARNING) << "PostgreSQL: Cannot cancel a statement after its timeout: " << error;
+          }
+
+          that->armed_ = false;
+        }
+      }
+    }
+  }
+
+
+  PostgreSQLWatchdog::PostgreSQLWatchdog(void* pg) :
+    cancel_(PQgetCancel(reinterpret_cast<PGconn*>(pg))),
+    continue_(true),
+    armed_(false),
+    generation_(0)
+  {
+    if (cancel_ == NULL)
+    {
+      LOG(ERROR) << "PostgreSQL: Cannot create the object to cancel the statements";
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+    }
+
+    thread_ = boost::thread(Worker, this);
+  }
+
+
+  PostgreSQLWatchdog::~PostgreSQLWatchdog()
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      continue_ = false;
+    }
+
+    changed_.notify_one();
+
+    if (thread_.joinable())
+    {
+      thread_.join();
+    }
+
+    PQfreeCancel(reinterpret_cast<PGcancel*>(cancel_));
+  }
+
+
+  uint64_t PostgreSQLWatchdog::Arm(unsigned int milliseconds)
+  {
+    uint64_t generation;
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      generation_++;
+      generation = generation_;
+      armed_ = true;
+      deadline_ = boost::get_system_time() + boost::posix_time::milliseconds(milliseconds);
+    }
+
+    changed_.notify_one();
+    return generation;
+  }
+
+
+  void PostgreSQLWatchdog::Disarm(uint64_t generation)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (generation_ == generation)
+    {
+      armed_ = false;
+    }
+
+    // No need to wake up the thread: It ignores its deadline, as it
+    // is no longer armed
+  }
+}
@@ -0,0 +1,75 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#if ORTHANC_ENABLE_POSTGRESQL != 1
+#  error PostgreSQL support must be enabled to use this file
+#endif
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+#include <stdint.h>
+
+namespace OrthancDatabases
+{
+  /**
+   * Thread that cancels the statement that is running on one
+   * connection to PostgreSQL, once it exceeds its timeout (cf.
+   * "Query::SetTimeout()"). Contrarily to "statement_timeout", this
+   * costs no round trip to the server, and works the same way inside
+   * and outside of the explicit transactions. The server then reports
+   * the error "query_canceled".
+   *
+   * Each call to "Arm()" starts a new generation, that must be given
+   * back to "Disarm()". The thread only cancels the generation it has
+   * waited for, and "Disarm()" ignores an outdated generation, so that
+   * a late cancel or a late disarm never hits the next statement.
+   **/
+  class PostgreSQLWatchdog : public boost::noncopyable
+  {
+  private:
+    void*                      cancel_;   /* Object of type "PGcancel*" */
+    boost::mutex               mutex_;
+    boost::condition_variable  changed_;
+    bool                       continue_;
+    bool                       armed_;
+    uint64_t                   generation_;
+    boost::system_time         deadline_;
+    boost::thread              thread_;
+
+    static void Worker(PostgreSQLWatchdog* that);
+
+  public:
+    // "pg" is an object of type "PGconn*" that must be connected
+    explicit PostgreSQLWatchdog(void* pg);
+
+    ~PostgreSQLWatchdog();
+
+    // To be called right before sending the statement. Returns the
+    // generation of the statement, which is never zero.
+    uint64_t Arm(unsigned int milliseconds);
+
+    // To be called once the statement is over, before the connection
+    // is used by another statement
+    void Disarm(uint64_t generation);
+  };
+}
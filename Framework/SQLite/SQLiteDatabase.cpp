@@ -25,8 +25,14 @@
 #include "SQLiteTransaction.h"
 #include "../Common/ImplicitTransaction.h"
 
+#include <Core/Logging.h>
 #include <Core/OrthancException.h>
 
+#include <Core/SystemToolbox.h>
+
+#include <boost/filesystem.hpp>
+#include <sqlite3.h>
+
 namespace OrthancDatabases
 {
   void SQLiteDatabase::Execute(const std::string& sql)
@@ -38,6 +44,164 @@ namespace OrthancDatabases
   }
     
 
+  bool SQLiteDatabase::Checkpoint(int& walFrames,
+                                  int& checkpointedFrames,
+                                  bool truncate)
+  {
+    sqlite3* db = connection_.GetWrappedObject();
+
+    int code = sqlite3_wal_checkpoint_v2(
+      db, NULL /* all the attached databases */,
+      truncate ? SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_PASSIVE,
+      &walFrames, &checkpointedFrames);
+
+    switch (code)
+    {
+      case SQLITE_OK:
+        return true;
+
+      case SQLITE_BUSY:
+        return false;
+
+      default:
+        LOG(ERROR) << "SQLite: Cannot checkpoint the write-ahead log: "
+                   << sqlite3_errmsg(db);
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+    }
+  }
+
+
+  void SQLiteDatabase::LoadSnapshot(const std::string& path)
+  {
+    sqlite3* source = NULL;
+
+    if (sqlite3_open_v2(path.c_str(), &source, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+    {
+      LOG(ERROR) << "SQLite: Cannot open the snapshot: " << path;
+      sqlite3_close(source);
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+    }
+
+    sqlite3_backup* backup = sqlite3_backup_init(connection_.GetWrappedObject(), "main", source, "main");
+    
+    int code = SQLITE_ERROR;
+    if (backup != NULL)
+    {
+      sqlite3_backup_step(backup, -1);
+      code = sqlite3_backup_finish(backup);
+    }
+
+    sqlite3_close(source);
+
+    if (code != SQLITE_OK)
+    {
+      LOG(ERROR) << "SQLite: Cannot load the snapshot: " << path;
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+    }
+  }
+
+
+  SQLiteDatabase::SnapshotWriter::SnapshotWriter(SQLiteDatabase& source,
+                                                 const std::string& path) :
+    source_(source),
+    path_(path),
+    temporary_(path + ".tmp"),
+    target_(NULL),
+    backup_(NULL)
+  {
+    if (sqlite3_open(temporary_.c_str(), &target_) != SQLITE_OK)
+    {
+      LOG(ERROR) << "SQLite: Cannot create the snapshot: " << temporary_;
+      sqlite3_close(target_);
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_CannotWriteFile);
+    }
+
+    backup_ = sqlite3_backup_init(target_, "main", source_.connection_.GetWrappedObject(), "main");
+    if (backup_ == NULL)
+    {
+      LOG(ERROR) << "SQLite: Cannot start the snapshot: " << sqlite3_errmsg(target_);
+      sqlite3_close(target_);
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+    }
+  }
+
+
+  SQLiteDatabase::SnapshotWriter::~SnapshotWriter()
+  {
+    if (target_ != NULL)
+    {
+      // The snapshot was not committed
+      if (backup_ != NULL)
+      {
+        sqlite3_backup_finish(backup_);
+      }
+
+      sqlite3_close(target_);
+      Orthanc::SystemToolbox::RemoveFile(temporary_);
+    }
+  }
+
+
+  bool SQLiteDatabase::SnapshotWriter::Step(int pages)
+  {
+    if (target_ == NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    switch (sqlite3_backup_step(backup_, pages))
+    {
+      case SQLITE_DONE:
+        return true;
+
+      case SQLITE_OK:
+      case SQLITE_BUSY:
+      case SQLITE_LOCKED:
+        return false;  // Copy the next pages at the next step
+
+      default:
+        LOG(ERROR) << "SQLite: Error while writing the snapshot: " << sqlite3_errmsg(target_);
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_CannotWriteFile);
+    }
+  }
+
+
+  void SQLiteDatabase::SnapshotWriter::Commit()
+  {
+    if (target_ == NULL)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    int code = sqlite3_backup_finish(backup_);
+    backup_ = NULL;
+
+    if (code != SQLITE_OK)
+    {
+      LOG(ERROR) << "SQLite: Cannot finish the snapshot: " << sqlite3_errmsg(target_);
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_CannotWriteFile);
+    }
+
+    code = sqlite3_close(target_);
+    target_ = NULL;
+
+    boost::system::error_code error;
+    if (code == SQLITE_OK)
+    {
+      // Atomic replacement of the previous snapshot
+      boost::filesystem::rename(temporary_, path_, error);
+    }
+
+    if (code != SQLITE_OK ||
+        error)
+    {
+      LOG(ERROR) << "SQLite: Cannot replace the snapshot: " << path_;
+      Orthanc::SystemToolbox::RemoveFile(temporary_);
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_CannotWriteFile);
+    }
+  }
+
+
   IPrecompiledStatement* SQLiteDatabase::Compile(const Query& query)
   {
     return new SQLiteStatement(*this, query);
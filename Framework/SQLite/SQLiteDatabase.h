@@ -29,6 +29,8 @@
 
 #include <Core/SQLite/Connection.h>
 
+struct sqlite3_backup;
+
 namespace OrthancDatabases
 {
   class SQLiteDatabase : public IDatabase
@@ -63,6 +65,60 @@ namespace OrthancDatabases
     {
       return connection_.GetLastInsertRowId();
     }
+
+    /**
+     * Copies the pages of the write-ahead log back into the database
+     * file. If "truncate" is "true", the log file is also truncated
+     * to zero bytes. "walFrames" receives the size of the log (in
+     * frames), and "checkpointedFrames" the number of its frames that
+     * are now in the database file. Returns "false" if the checkpoint
+     * could not complete because of another connection. A passive
+     * checkpoint never waits for the other connections, so it is best
+     * run on a connection that is dedicated to the checkpoints.
+     **/
+    bool Checkpoint(int& walFrames,
+                    int& checkpointedFrames,
+                    bool truncate);
+
+    // Copies the whole content of a database file into this database
+    // (typically opened in memory), with the online backup API
+    void LoadSnapshot(const std::string& path);
+
+    /**
+     * Incremental copy of this database into a file, with the online
+     * backup API. The snapshot is written to a temporary file, that
+     * only replaces the target file on "Commit()", so that a crash
+     * never leaves a partial snapshot. The modifications of the
+     * source through its own connection during the copy are applied
+     * to the snapshot as well.
+     **/
+    class SnapshotWriter : public boost::noncopyable
+    {
+    private:
+      SQLiteDatabase&  source_;
+      std::string      path_;
+      std::string      temporary_;
+      sqlite3*         target_;
+      sqlite3_backup*  backup_;
+
+    public:
+      SnapshotWriter(SQLiteDatabase& source,
+                     const std::string& path);
+
+      ~SnapshotWriter();
+
+      SQLiteDatabase& GetSource() const
+      {
+        return source_;
+      }
+
+      // Copies at most "pages" pages (a negative value copies all the
+      // remaining pages). Returns "true" iff the copy is complete.
+      // Must only be called while the source is not in a transaction.
+      bool Step(int pages);
+
+      void Commit();
+    };
     
     virtual Dialect GetDialect() const
     {
@@ -71,6 +127,11 @@ namespace OrthancDatabases
 
     virtual IPrecompiledStatement* Compile(const Query& query);
 
+    virtual void Prepare(const std::vector<IPrecompiledStatement*>& statements)
+    {
+      // The statements are prepared by "Compile()"
+    }
+
     virtual ITransaction* CreateTransaction(bool isImplicit);
   };
 }
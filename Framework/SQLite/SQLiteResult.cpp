@@ -47,6 +47,12 @@ namespace OrthancDatabases
   }
 
 
+  SQLiteResult::~SQLiteResult()
+  {
+    statement_.GetObject().Reset();
+  }
+
+
   IValue* SQLiteResult::FetchField(size_t index)
   {
     switch (statement_.GetObject().GetColumnType(index))
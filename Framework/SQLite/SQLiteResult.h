@@ -43,6 +43,11 @@ namespace OrthancDatabases
     
   public:
     SQLiteResult(SQLiteStatement& statement);
+
+    // Resets the statement, so that a result set that is not read
+    // until its end does not keep a read transaction open (which
+    // would prevent the checkpoints of the write-ahead log)
+    virtual ~SQLiteResult();
     
     virtual bool IsDone() const
     {
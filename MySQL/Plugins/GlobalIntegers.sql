@@ -0,0 +1,79 @@
+-- Counters maintained by triggers, so that the statistics about the
+-- resources and the attachments are read in constant time instead of
+-- scanning the "Resources" and "AttachedFiles" tables.
+--
+--   property = 0                 => Total compressed size of the attachments
+--   property = 1                 => Total uncompressed size of the attachments
+--   property = 2 + resourceType  => Number of resources at this level
+
+CREATE TABLE GlobalIntegers(
+       property INTEGER NOT NULL,
+       value BIGINT NOT NULL,
+       PRIMARY KEY(property)
+       );
+
+-- Initialization from the current content of the database (if upgrading)
+INSERT INTO GlobalIntegers VALUES
+  (0, (SELECT COALESCE(SUM(compressedSize), 0) FROM AttachedFiles)),
+  (1, (SELECT COALESCE(SUM(uncompressedSize), 0) FROM AttachedFiles)),
+  (2, (SELECT COUNT(*) FROM Resources WHERE resourceType = 0)),
+  (3, (SELECT COUNT(*) FROM Resources WHERE resourceType = 1)),
+  (4, (SELECT COUNT(*) FROM Resources WHERE resourceType = 2)),
+  (5, (SELECT COUNT(*) FROM Resources WHERE resourceType = 3));
+
+
+-- NB: Character "@" is used to replace the semicolon characters in triggers
+
+-- MySQL does not fire the triggers on cascaded deletions, and older
+-- versions of MySQL do not allow several triggers for the same event
+-- on the same table: The triggers of "PrepareIndex.sql" are replaced
+-- by versions that also update the counters
+
+CREATE TRIGGER AttachedFileAdded
+AFTER INSERT ON AttachedFiles
+FOR EACH ROW
+BEGIN
+  UPDATE GlobalIntegers SET value = value + COALESCE(new.compressedSize, 0) WHERE property = 0@
+  UPDATE GlobalIntegers SET value = value + COALESCE(new.uncompressedSize, 0) WHERE property = 1@
+END;
+
+
+DROP TRIGGER AttachedFileDeleted;
+
+-- In MySQL, this trigger is only used if replacing some attachment
+CREATE TRIGGER AttachedFileDeleted
+AFTER DELETE ON AttachedFiles
+FOR EACH ROW
+BEGIN
+  INSERT INTO DeletedFiles VALUES(old.uuid, old.filetype, old.compressedSize,
+                                  old.uncompressedSize, old.compressionType,
+                                  old.uncompressedHash, old.compressedHash)@
+  UPDATE GlobalIntegers SET value = value - COALESCE(old.compressedSize, 0) WHERE property = 0@
+  UPDATE GlobalIntegers SET value = value - COALESCE(old.uncompressedSize, 0) WHERE property = 1@
+END;
+
+
+DROP TRIGGER ResourceDeleted;
+
+CREATE TRIGGER ResourceDeleted
+BEFORE DELETE ON Resources   -- WARNING: Must be "BEFORE", otherwise the attached file is already deleted
+FOR EACH ROW
+BEGIN
+   INSERT INTO DeletedFiles SELECT uuid, fileType, compressedSize, uncompressedSize, compressionType, uncompressedHash, compressedHash FROM AttachedFiles WHERE id=old.internalId@
+   UPDATE GlobalIntegers SET value = value - (SELECT COALESCE(SUM(compressedSize), 0) FROM AttachedFiles WHERE id=old.internalId) WHERE property = 0@
+   UPDATE GlobalIntegers SET value = value - (SELECT COALESCE(SUM(uncompressedSize), 0) FROM AttachedFiles WHERE id=old.internalId) WHERE property = 1@
+   UPDATE GlobalIntegers SET value = value - 1 WHERE property = 2 + old.resourceType@
+END;
+
+
+DROP TRIGGER PatientAdded;
+
+CREATE TRIGGER PatientAdded
+AFTER INSERT ON Resources
+FOR EACH ROW
+BEGIN
+  IF new.resourceType = 0 THEN  -- The "0" corresponds to "OrthancPluginResourceType_Patient"
+    INSERT INTO PatientRecyclingOrder VALUES (NULL, new.internalId)@
+  END IF@
+  UPDATE GlobalIntegers SET value = value + 1 WHERE property = 2 + new.resourceType@
+END;
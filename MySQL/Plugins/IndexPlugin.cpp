@@ -21,13 +21,22 @@
 
 #include "MySQLIndex.h"
 #include "../../Framework/MySQL/MySQLDatabase.h"
+#include "../../Framework/Plugins/IndexMaintenance.h"
+#include "../../Framework/Plugins/IndexStatistics.h"
+#include "../../Framework/Plugins/LogsRetention.h"
 #include "../../Framework/Plugins/PluginInitialization.h"
+#include "../../Framework/Plugins/PublicIdsFilterRebuilder.h"
 
 #include <Core/HttpClient.h>
 #include <Core/Logging.h>
 #include <Core/Toolbox.h>
 
 static std::auto_ptr<OrthancDatabases::MySQLIndex> backend_;
+static std::auto_ptr<OrthancDatabases::LogsRetention> retention_;
+static std::auto_ptr<OrthancDatabases::IndexMaintenance> maintenance_;
+static std::auto_ptr<OrthancDatabases::PublicIdsFilterRebuilder> filterRebuilder_;
+static std::auto_ptr<OrthancDatabases::ChangesFeed> changesFeed_;
+static std::auto_ptr<OrthancDatabases::IndexStatistics> statistics_;
 
 
 extern "C"
@@ -69,8 +78,82 @@ extern "C"
       /* Create the database back-end */
       backend_.reset(new OrthancDatabases::MySQLIndex(parameters));
 
+      unsigned int maxStatements;
+      if (mysql.LookupUnsignedIntegerValue(maxStatements, "MaxPreparedStatements"))
+      {
+        backend_->SetMaxPreparedStatements(maxStatements);
+      }
+
+      unsigned int lookupTimeout;
+      if (mysql.LookupUnsignedIntegerValue(lookupTimeout, "LookupTimeout"))
+      {
+        // The configuration option is expressed in seconds
+        backend_->SetLookupTimeout(lookupTimeout * 1000);
+      }
+
+      unsigned int cacheSize;
+      if (mysql.LookupUnsignedIntegerValue(cacheSize, "ResourcesCacheSize"))
+      {
+        backend_->SetResourcesCacheSize(cacheSize);
+      }
+      else if (!parameters.HasLock())
+      {
+        // Other instances of Orthanc might modify the database
+        backend_->SetResourcesCacheSize(0);
+      }
+
+      unsigned int tagsCacheSize;  // In megabytes
+      if (mysql.LookupUnsignedIntegerValue(tagsCacheSize, "MainDicomTagsCacheSize"))
+      {
+        backend_->SetMainDicomTagsCacheSize(static_cast<size_t>(tagsCacheSize) * 1024 * 1024);
+      }
+      else if (!parameters.HasLock())
+      {
+        backend_->SetMainDicomTagsCacheSize(0);
+      }
+
+      bool filter;
+      if (mysql.LookupBooleanValue(filter, "EnablePublicIdsFilter"))
+      {
+        backend_->SetPublicIdsFilter(filter);
+      }
+      else if (!parameters.HasLock())
+      {
+        backend_->SetPublicIdsFilter(false);
+      }
+
+      if (!parameters.HasLock())
+      {
+        // The keyset pagination needs a single writer
+        backend_->SetPagesIndex(false);
+      }
+
       /* Register the MySQL index into Orthanc */
       OrthancPlugins::DatabaseBackendAdapter::Register(context, *backend_);
+
+      /* Long polling on the changes, signalled by the index on commits */
+      changesFeed_.reset(new OrthancDatabases::ChangesFeed(context));
+      changesFeed_->ReadConfiguration(mysql);
+      changesFeed_->Register("/mysql/changes");
+      backend_->SetChangesFeed(*changesFeed_);
+
+      /* Start the removal of the old changes and exported resources */
+      retention_.reset(new OrthancDatabases::LogsRetention(*backend_));
+      retention_->ReadConfiguration(mysql);
+      retention_->Start();
+
+      /* Start the maintenance of the most modified tables */
+      maintenance_.reset(new OrthancDatabases::IndexMaintenance(*backend_));
+      maintenance_->ReadConfiguration(mysql);
+      maintenance_->Start();
+
+      /* Rebuilds of the filter of the public IDs, out of the transactions of Orthanc */
+      filterRebuilder_.reset(new OrthancDatabases::PublicIdsFilterRebuilder(*backend_));
+      filterRebuilder_->Start();
+
+      /* Statistics about the caches of the index */
+      statistics_.reset(new OrthancDatabases::IndexStatistics(context, *backend_));
+      statistics_->Register("/mysql/statistics");
     }
     catch (Orthanc::OrthancException& e)
     {
@@ -91,7 +174,12 @@ extern "C"
   {
     LOG(WARNING) << "MySQL index is finalizing";
 
+    statistics_.reset(NULL);
+    maintenance_.reset(NULL);
+    filterRebuilder_.reset(NULL);
+    retention_.reset(NULL);
     backend_.reset(NULL);
+    changesFeed_.reset(NULL);
     OrthancDatabases::MySQLDatabase::GlobalFinalization();
     Orthanc::HttpClient::GlobalFinalize();
     Orthanc::Toolbox::FinalizeOpenSsl();
@@ -119,7 +119,20 @@ namespace OrthancDatabases
       if (revision != 1)
       {
         LOG(ERROR) << "MySQL plugin is incompatible with database schema revision: " << revision;
-        throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);        
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+      }
+
+      if (!db->DoesTableExist(t, "GlobalIntegers"))
+      {
+        // Counters of the resources and of the attachments, that are
+        // maintained by triggers (also applies to older databases)
+        LOG(WARNING) << "Adding the counters of the resources and attachments to the MySQL database";
+
+        std::string query;
+
+        Orthanc::EmbeddedResources::GetFileResource
+          (query, Orthanc::EmbeddedResources::MYSQL_GLOBAL_INTEGERS);
+        db->Execute(query, true);
       }
 
       t.Commit();
@@ -163,7 +176,10 @@ namespace OrthancDatabases
 
       statement.Execute();
       
-      return ReadInteger64(statement, 0);
+      int64_t id = ReadInteger64(statement, 0);
+      CacheResource(id, publicId, type);
+      SignalModification("Resources");
+      return id;
     }
   }
 
@@ -171,6 +187,7 @@ namespace OrthancDatabases
   void MySQLIndex::DeleteResource(int64_t id)
   {
     ClearDeletedFiles();
+    ClearPagesIndex();  // The offsets of the pages are shifted
 
     // Recursive exploration of resources to be deleted, from the "id"
     // resource to the top of the tree of resources
@@ -234,6 +251,9 @@ namespace OrthancDatabases
       }
     }
 
+    // "id" is now the topmost resource to be deleted
+    ForgetDeletedResources(id);  // The deleted resources are not reported by MySQL
+
     {
       DatabaseManager::CachedStatement deleteHierarchy(
         STATEMENT_FROM_HERE, GetManager(),
@@ -245,8 +265,45 @@ namespace OrthancDatabases
       args.SetIntegerValue("id", id);
     
       deleteHierarchy.Execute(args);
+
+      // The deletion cascades to the recycling order of the patients
+      SignalModification("Resources");
+      SignalModification("PatientRecyclingOrder");
     }
 
     SignalDeletedFiles();
   }
+
+
+  IDatabase* MySQLIndex::OpenMaintenanceDatabase()
+  {
+    // Unlike "OpenInternal()", this connection takes no advisory lock
+    std::auto_ptr<MySQLDatabase> db(new MySQLDatabase(parameters_));
+    db->Open();
+    return db.release();
+  }
+
+
+  void MySQLIndex::OptimizeTable(IDatabase& database,
+                                 const std::string& table)
+  {
+    MySQLDatabase& db = dynamic_cast<MySQLDatabase&>(database);
+
+    if (table == "Resources" ||
+        table == "MainDicomTags" ||
+        table == "DicomIdentifiers")
+    {
+      // These tables are too large to be rebuilt in the background
+      LOG(INFO) << "Analyzing MySQL table: " << table;
+      db.Execute("ANALYZE TABLE " + table, false);
+    }
+    else
+    {
+      // With InnoDB, "OPTIMIZE TABLE" rebuilds the table (which gives
+      // back the space of the deleted rows), then updates its
+      // statistics
+      LOG(INFO) << "Optimizing MySQL table: " << table;
+      db.Execute("OPTIMIZE TABLE " + table, false);
+    }
+  }
 }
@@ -57,6 +57,12 @@ namespace OrthancDatabases
 
     IDatabase* OpenInternal();
 
+  protected:
+    virtual void OptimizeTable(IDatabase& database,
+                               const std::string& table);
+
+    virtual IDatabase* OpenMaintenanceDatabase();
+
   public:
     MySQLIndex(const MySQLParameters& parameters);
 
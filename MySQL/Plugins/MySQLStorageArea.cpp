@@ -74,6 +74,10 @@ namespace OrthancDatabases
       t.Commit();
     }
 
+    // The connection is reopened after a failure, while Orthanc may
+    // have written to the storage area in the meantime
+    clearAll_ = false;
+
     return db.release();
   }
 
@@ -63,8 +63,19 @@ extern "C"
     try
     {
       OrthancDatabases::MySQLParameters parameters(mysql);
-      OrthancDatabases::StorageBackend::Register
-        (context, new OrthancDatabases::MySQLStorageArea(parameters));
+
+      std::auto_ptr<OrthancDatabases::MySQLStorageArea> storage
+        (new OrthancDatabases::MySQLStorageArea(parameters));
+
+      // Window during which the writes are grouped into one commit,
+      // in milliseconds (disabled by default)
+      unsigned int window;
+      if (mysql.LookupUnsignedIntegerValue(window, "StorageGroupCommit"))
+      {
+        storage->SetGroupCommit(window);
+      }
+
+      OrthancDatabases::StorageBackend::Register(context, storage.release());
     }
     catch (Orthanc::OrthancException& e)
     {
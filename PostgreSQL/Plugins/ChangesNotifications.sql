@@ -0,0 +1,17 @@
+-- Asynchronous notification on the "changes" channel whenever new
+-- changes are committed, which drives the long polling of the log of
+-- changes. PostgreSQL folds the identical notifications of a
+-- transaction, and only delivers them at commit time.
+
+CREATE FUNCTION ChangeAddedFunc()
+RETURNS TRIGGER AS $body$
+BEGIN
+  NOTIFY changes;
+  RETURN NULL;
+END;
+$body$ LANGUAGE plpgsql;
+
+CREATE TRIGGER ChangeAdded
+AFTER INSERT ON Changes
+FOR EACH STATEMENT
+EXECUTE PROCEDURE ChangeAddedFunc();
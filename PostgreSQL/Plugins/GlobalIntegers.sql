@@ -0,0 +1,77 @@
+-- Counters maintained by triggers, so that the statistics about the
+-- resources and the attachments are read in constant time instead of
+-- scanning the "Resources" and "AttachedFiles" tables.
+--
+--   property = 0                 => Total compressed size of the attachments
+--   property = 1                 => Total uncompressed size of the attachments
+--   property = 2 + resourceType  => Number of resources at this level
+--
+-- Each counter is split into 8 "stripes". A transaction only updates
+-- the stripe that corresponds to its backend process, which avoids
+-- concurrent transactions to serialize on a single hot row. The value
+-- of a counter is the sum of its stripes.
+
+CREATE TABLE GlobalIntegers(
+       property INTEGER NOT NULL,
+       stripe INTEGER NOT NULL,
+       value BIGINT NOT NULL,
+       PRIMARY KEY(property, stripe)
+       );
+
+INSERT INTO GlobalIntegers
+  SELECT property, stripe, 0 FROM generate_series(0, 5) AS property, generate_series(0, 7) AS stripe;
+
+-- Initialization from the current content of the database (if upgrading)
+UPDATE GlobalIntegers SET value = (SELECT COALESCE(SUM(compressedSize), 0) FROM AttachedFiles)
+  WHERE property = 0 AND stripe = 0;
+UPDATE GlobalIntegers SET value = (SELECT COALESCE(SUM(uncompressedSize), 0) FROM AttachedFiles)
+  WHERE property = 1 AND stripe = 0;
+UPDATE GlobalIntegers SET value = (SELECT COUNT(*) FROM Resources WHERE resourceType = property - 2)
+  WHERE property >= 2 AND stripe = 0;
+
+
+CREATE FUNCTION IncrementGlobalInteger(counter INTEGER, delta BIGINT)
+RETURNS VOID AS $body$
+BEGIN
+  UPDATE GlobalIntegers SET value = value + delta
+    WHERE property = counter AND stripe = pg_backend_pid() % 8;
+END;
+$body$ LANGUAGE plpgsql;
+
+
+CREATE FUNCTION AttachedFileCountersFunc()
+RETURNS TRIGGER AS $body$
+BEGIN
+  IF TG_OP = 'INSERT' THEN
+    PERFORM IncrementGlobalInteger(0, COALESCE(new.compressedSize, 0));
+    PERFORM IncrementGlobalInteger(1, COALESCE(new.uncompressedSize, 0));
+  ELSE
+    PERFORM IncrementGlobalInteger(0, -COALESCE(old.compressedSize, 0));
+    PERFORM IncrementGlobalInteger(1, -COALESCE(old.uncompressedSize, 0));
+  END IF;
+  RETURN NULL;
+END;
+$body$ LANGUAGE plpgsql;
+
+CREATE TRIGGER AttachedFileCounters
+AFTER INSERT OR DELETE ON AttachedFiles
+FOR EACH ROW
+EXECUTE PROCEDURE AttachedFileCountersFunc();
+
+
+CREATE FUNCTION ResourceCountersFunc()
+RETURNS TRIGGER AS $body$
+BEGIN
+  IF TG_OP = 'INSERT' THEN
+    PERFORM IncrementGlobalInteger(2 + new.resourceType, 1);
+  ELSE
+    PERFORM IncrementGlobalInteger(2 + old.resourceType, -1);
+  END IF;
+  RETURN NULL;
+END;
+$body$ LANGUAGE plpgsql;
+
+CREATE TRIGGER ResourceCounters
+AFTER INSERT OR DELETE ON Resources
+FOR EACH ROW
+EXECUTE PROCEDURE ResourceCountersFunc();
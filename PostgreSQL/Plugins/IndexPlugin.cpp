@@ -19,12 +19,23 @@
  **/
 
 
+#include "PostgreSQLChangesListener.h"
 #include "PostgreSQLIndex.h"
+#include "../../Framework/Plugins/IndexMaintenance.h"
+#include "../../Framework/Plugins/IndexStatistics.h"
+#include "../../Framework/Plugins/LogsRetention.h"
 #include "../../Framework/Plugins/PluginInitialization.h"
+#include "../../Framework/Plugins/PublicIdsFilterRebuilder.h"
 
 #include <Core/Logging.h>
 
 static std::auto_ptr<OrthancDatabases::PostgreSQLIndex> backend_;
+static std::auto_ptr<OrthancDatabases::LogsRetention> retention_;
+static std::auto_ptr<OrthancDatabases::IndexMaintenance> maintenance_;
+static std::auto_ptr<OrthancDatabases::PublicIdsFilterRebuilder> filterRebuilder_;
+static std::auto_ptr<OrthancDatabases::ChangesFeed> changesFeed_;
+static std::auto_ptr<OrthancDatabases::PostgreSQLChangesListener> changesListener_;
+static std::auto_ptr<OrthancDatabases::IndexStatistics> statistics_;
 
 
 extern "C"
@@ -63,8 +74,95 @@ extern "C"
       /* Create the database back-end */
       backend_.reset(new OrthancDatabases::PostgreSQLIndex(parameters));
 
+      unsigned int maxStatements;
+      if (postgresql.LookupUnsignedIntegerValue(maxStatements, "MaxPreparedStatements"))
+      {
+        backend_->SetMaxPreparedStatements(maxStatements);
+      }
+
+      bool partitioning;
+      if (postgresql.LookupBooleanValue(partitioning, "EnablePartitioning"))
+      {
+        backend_->SetPartitioning(partitioning);
+      }
+
+      bool synchronousCommit;
+      if (postgresql.LookupBooleanValue(synchronousCommit, "SynchronousCommit"))
+      {
+        backend_->SetSynchronousCommit(synchronousCommit);
+      }
+
+      unsigned int lookupTimeout;
+      if (postgresql.LookupUnsignedIntegerValue(lookupTimeout, "LookupTimeout"))
+      {
+        // The configuration option is expressed in seconds
+        backend_->SetLookupTimeout(lookupTimeout * 1000);
+      }
+
+      unsigned int cacheSize;
+      if (postgresql.LookupUnsignedIntegerValue(cacheSize, "ResourcesCacheSize"))
+      {
+        backend_->SetResourcesCacheSize(cacheSize);
+      }
+      else if (!parameters.HasLock())
+      {
+        // Other instances of Orthanc might modify the database
+        backend_->SetResourcesCacheSize(0);
+      }
+
+      unsigned int tagsCacheSize;  // In megabytes
+      if (postgresql.LookupUnsignedIntegerValue(tagsCacheSize, "MainDicomTagsCacheSize"))
+      {
+        backend_->SetMainDicomTagsCacheSize(static_cast<size_t>(tagsCacheSize) * 1024 * 1024);
+      }
+      else if (!parameters.HasLock())
+      {
+        backend_->SetMainDicomTagsCacheSize(0);
+      }
+
+      bool filter;
+      if (postgresql.LookupBooleanValue(filter, "EnablePublicIdsFilter"))
+      {
+        backend_->SetPublicIdsFilter(filter);
+      }
+      else if (!parameters.HasLock())
+      {
+        backend_->SetPublicIdsFilter(false);
+      }
+
+      if (!parameters.HasLock())
+      {
+        // The keyset pagination needs a single writer
+        backend_->SetPagesIndex(false);
+      }
+
       /* Register the PostgreSQL index into Orthanc */
       OrthancPlugins::DatabaseBackendAdapter::Register(context, *backend_);
+
+      /* Start the removal of the old changes and exported resources */
+      retention_.reset(new OrthancDatabases::LogsRetention(*backend_));
+      retention_->ReadConfiguration(postgresql);
+      retention_->Start();
+
+      /* Start the maintenance of the most modified tables */
+      maintenance_.reset(new OrthancDatabases::IndexMaintenance(*backend_));
+      maintenance_->ReadConfiguration(postgresql);
+      maintenance_->Start();
+
+      /* Rebuilds of the filter of the public IDs, out of the transactions of Orthanc */
+      filterRebuilder_.reset(new OrthancDatabases::PublicIdsFilterRebuilder(*backend_));
+      filterRebuilder_->Start();
+
+      /* Long polling on the changes, driven by PostgreSQL notifications */
+      changesFeed_.reset(new OrthancDatabases::ChangesFeed(context));
+      changesFeed_->ReadConfiguration(postgresql);
+      changesFeed_->Register("/postgresql/changes");
+      changesListener_.reset(new OrthancDatabases::PostgreSQLChangesListener(parameters, *changesFeed_));
+      changesListener_->Start();
+
+      /* Statistics about the caches of the index */
+      statistics_.reset(new OrthancDatabases::IndexStatistics(context, *backend_));
+      statistics_->Register("/postgresql/statistics");
     }
     catch (Orthanc::OrthancException& e)
     {
@@ -84,7 +182,13 @@ extern "C"
   ORTHANC_PLUGINS_API void OrthancPluginFinalize()
   {
     LOG(WARNING) << "PostgreSQL index is finalizing";
+    changesListener_.reset(NULL);
+    statistics_.reset(NULL);
+    maintenance_.reset(NULL);
+    filterRebuilder_.reset(NULL);
+    retention_.reset(NULL);
     backend_.reset(NULL);
+    changesFeed_.reset(NULL);
   }
 
 
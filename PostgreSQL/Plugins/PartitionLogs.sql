@@ -0,0 +1,135 @@
+-- Patch level 3 (optional, requires PostgreSQL >= 11): The tables
+-- "Changes" and "ExportedResources" are range-partitioned on "seq", by
+-- chunks of "LogPartitionSize()" entries. The retention of the logs
+-- drops the oldest partitions at once, instead of deleting their
+-- entries row by row. The partitions are created in advance by
+-- "PrepareLogPartitions()", that is invoked by the plugin while the
+-- entries are added.
+
+CREATE FUNCTION LogPartitionSize()
+RETURNS BIGINT AS $body$
+BEGIN
+  RETURN 100000;
+END;
+$body$ LANGUAGE plpgsql IMMUTABLE;
+
+-- Creates the partition of "logTable" (in lowercase) that contains
+-- the chunk "k", if it does not exist yet. Returns 1 iff the
+-- partition was created.
+CREATE FUNCTION CreateLogPartition(logTable TEXT, k BIGINT)
+RETURNS INTEGER AS $body$
+BEGIN
+  IF to_regclass(logTable || '_p' || k) IS NULL THEN
+    EXECUTE format('CREATE TABLE %I PARTITION OF %I FOR VALUES FROM (%s) TO (%s)',
+                   logTable || '_p' || k, logTable,
+                   k * LogPartitionSize(), (k + 1) * LogPartitionSize());
+    RETURN 1;
+  ELSE
+    RETURN 0;
+  END IF;
+END;
+$body$ LANGUAGE plpgsql;
+
+-- Creates the partitions of "logTable" for the current and for the
+-- next chunks of the sequence. Returns the number of new partitions.
+CREATE FUNCTION PrepareLogPartitions(logTable TEXT)
+RETURNS INTEGER AS $body$
+DECLARE
+  lastSeq BIGINT;
+BEGIN
+  EXECUTE format('SELECT last_value FROM %I', logTable || '_seq_seq') INTO lastSeq;
+  RETURN (CreateLogPartition(logTable, lastSeq / LogPartitionSize()) +
+          CreateLogPartition(logTable, lastSeq / LogPartitionSize() + 1));
+END;
+$body$ LANGUAGE plpgsql;
+
+-- Drops the oldest partitions of "logTable" whose entries are all
+-- below "seqLimit", or are all older than "dateLimit" (same
+-- conditions as the removal of the entries row by row). The
+-- partitions that can still receive new entries are never dropped.
+-- Returns the number of dropped partitions.
+CREATE FUNCTION DropLogPartitions(logTable TEXT, seqLimit BIGINT, dateLimit TEXT)
+RETURNS INTEGER AS $body$
+DECLARE
+  lastSeq BIGINT;
+  k BIGINT;
+  newest TEXT;
+  dropped INTEGER := 0;
+BEGIN
+  EXECUTE format('SELECT last_value FROM %I', logTable || '_seq_seq') INTO lastSeq;
+
+  LOOP
+    SELECT MIN(substring(c.relname FROM '_p([0-9]+)$')::BIGINT) INTO k
+      FROM pg_inherits AS i, pg_class AS c
+      WHERE c.oid = i.inhrelid AND i.inhparent = logTable::regclass;
+
+    EXIT WHEN k IS NULL OR (k + 1) * LogPartitionSize() > lastSeq;
+
+    IF (k + 1) * LogPartitionSize() > seqLimit THEN
+      EXECUTE format('SELECT MAX(date) FROM %I', logTable || '_p' || k) INTO newest;
+      EXIT WHEN newest IS NOT NULL AND newest >= dateLimit;
+    END IF;
+
+    EXECUTE format('DROP TABLE %I', logTable || '_p' || k);
+    dropped := dropped + 1;
+  END LOOP;
+
+  RETURN dropped;
+END;
+$body$ LANGUAGE plpgsql;
+
+
+-- The sequences survive the tables, so that the numbering of the
+-- entries goes on
+ALTER SEQUENCE changes_seq_seq OWNED BY NONE;
+ALTER SEQUENCE exportedresources_seq_seq OWNED BY NONE;
+
+CREATE TEMPORARY TABLE ChangesCopy AS SELECT * FROM Changes;
+CREATE TEMPORARY TABLE ExportedResourcesCopy AS SELECT * FROM ExportedResources;
+
+-- This also drops the trigger of the notifications, that is
+-- installed again by the plugin, together with its function
+DROP TABLE Changes;
+DROP TABLE ExportedResources;
+DROP FUNCTION IF EXISTS ChangeAddedFunc();
+
+CREATE TABLE Changes(
+       seq BIGINT NOT NULL DEFAULT nextval('changes_seq_seq'),
+       changeType INTEGER,
+       internalId BIGINT REFERENCES Resources(internalId) ON DELETE CASCADE,
+       resourceType INTEGER,
+       date VARCHAR(64),
+       PRIMARY KEY(seq)
+       ) PARTITION BY RANGE (seq);
+
+CREATE TABLE ExportedResources(
+       seq BIGINT NOT NULL DEFAULT nextval('exportedresources_seq_seq'),
+       resourceType INTEGER,
+       publicId VARCHAR(64),
+       remoteModality TEXT,
+       patientId VARCHAR(64),
+       studyInstanceUid TEXT,
+       seriesInstanceUid TEXT,
+       sopInstanceUid TEXT,
+       date VARCHAR(64),
+       PRIMARY KEY(seq)
+       ) PARTITION BY RANGE (seq);
+
+ALTER SEQUENCE changes_seq_seq OWNED BY Changes.seq;
+ALTER SEQUENCE exportedresources_seq_seq OWNED BY ExportedResources.seq;
+
+SELECT CreateLogPartition('changes', k)
+  FROM (SELECT DISTINCT seq / LogPartitionSize() AS k FROM ChangesCopy) AS chunks;
+SELECT CreateLogPartition('exportedresources', k)
+  FROM (SELECT DISTINCT seq / LogPartitionSize() AS k FROM ExportedResourcesCopy) AS chunks;
+SELECT PrepareLogPartitions('changes');
+SELECT PrepareLogPartitions('exportedresources');
+
+INSERT INTO Changes SELECT * FROM ChangesCopy;
+INSERT INTO ExportedResources SELECT * FROM ExportedResourcesCopy;
+
+DROP TABLE ChangesCopy;
+DROP TABLE ExportedResourcesCopy;
+
+-- Same index as in "PrepareIndex.sql", created on each partition
+CREATE INDEX ChangesIndex ON Changes(internalId);
@@ -0,0 +1,57 @@
+-- Patch level 2 (optional, requires PostgreSQL >= 11): The tables
+-- "MainDicomTags" and "DicomIdentifiers" are list-partitioned by the
+-- level of the resource, that is copied into a "resourceType" column.
+-- The lookups of identifiers thus only scan the indexes of the level
+-- they target, without joining the "Resources" table.
+
+CREATE TEMPORARY TABLE MainDicomTagsCopy AS
+  SELECT t.id, t.tagGroup, t.tagElement, t.value, r.resourceType
+  FROM MainDicomTags AS t, Resources AS r WHERE t.id = r.internalId;
+
+CREATE TEMPORARY TABLE DicomIdentifiersCopy AS
+  SELECT t.id, t.tagGroup, t.tagElement, t.value, r.resourceType
+  FROM DicomIdentifiers AS t, Resources AS r WHERE t.id = r.internalId;
+
+-- This also drops the indexes, including the trigram index
+DROP TABLE MainDicomTags;
+DROP TABLE DicomIdentifiers;
+
+CREATE TABLE MainDicomTags(
+       id BIGINT REFERENCES Resources(internalId) ON DELETE CASCADE,
+       tagGroup INTEGER,
+       tagElement INTEGER,
+       value TEXT,
+       resourceType INTEGER NOT NULL,
+       PRIMARY KEY(resourceType, id, tagGroup, tagElement)
+       ) PARTITION BY LIST (resourceType);
+
+CREATE TABLE MainDicomTagsPatients PARTITION OF MainDicomTags FOR VALUES IN (0);
+CREATE TABLE MainDicomTagsStudies PARTITION OF MainDicomTags FOR VALUES IN (1);
+CREATE TABLE MainDicomTagsSeries PARTITION OF MainDicomTags FOR VALUES IN (2);
+CREATE TABLE MainDicomTagsInstances PARTITION OF MainDicomTags FOR VALUES IN (3);
+
+CREATE TABLE DicomIdentifiers(
+       id BIGINT REFERENCES Resources(internalId) ON DELETE CASCADE,
+       tagGroup INTEGER,
+       tagElement INTEGER,
+       value TEXT,
+       resourceType INTEGER NOT NULL,
+       PRIMARY KEY(resourceType, id, tagGroup, tagElement)
+       ) PARTITION BY LIST (resourceType);
+
+CREATE TABLE DicomIdentifiersPatients PARTITION OF DicomIdentifiers FOR VALUES IN (0);
+CREATE TABLE DicomIdentifiersStudies PARTITION OF DicomIdentifiers FOR VALUES IN (1);
+CREATE TABLE DicomIdentifiersSeries PARTITION OF DicomIdentifiers FOR VALUES IN (2);
+CREATE TABLE DicomIdentifiersInstances PARTITION OF DicomIdentifiers FOR VALUES IN (3);
+
+INSERT INTO MainDicomTags SELECT * FROM MainDicomTagsCopy;
+INSERT INTO DicomIdentifiers SELECT * FROM DicomIdentifiersCopy;
+
+DROP TABLE MainDicomTagsCopy;
+DROP TABLE DicomIdentifiersCopy;
+
+-- Same indexes as in "PrepareIndex.sql", created on each partition
+CREATE INDEX MainDicomTagsIndex ON MainDicomTags(id);
+CREATE INDEX DicomIdentifiersIndex1 ON DicomIdentifiers(id);
+CREATE INDEX DicomIdentifiersIndex2 ON DicomIdentifiers(tagGroup, tagElement);
+CREATE INDEX DicomIdentifiersIndexValues ON DicomIdentifiers(value);
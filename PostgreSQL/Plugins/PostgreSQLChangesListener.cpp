@@ -0,0 +1,94 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "PostgreSQLChangesListener.h"
+
+#include <Core/Logging.h>
+#include <Core/OrthancException.h>
+
+namespace OrthancDatabases
+{
+  void PostgreSQLChangesListener::RunRound()
+  {
+    // Granularity of the checks for the termination of the thread
+    static const unsigned int TIMEOUT = 100;  // In milliseconds
+
+    // Pause before reconnecting to PostgreSQL
+    static const unsigned int RECONNECT = 1000;  // In milliseconds
+
+    try
+    {
+      if (db_.get() == NULL)
+      {
+        db_.reset(new PostgreSQLDatabase(parameters_));
+        db_->Open();
+        db_->Execute("LISTEN changes");
+
+        // Some notifications might have been lost while the
+        // connection was down: Wake up the clients to be safe
+        feed_.Signal();
+      }
+
+      if (db_->WaitNotifications(TIMEOUT))
+      {
+        feed_.Signal();
+      }
+    }
+    catch (Orthanc::OrthancException& e)
+    {
+      LOG(ERROR) << "Lost the connection listening to the PostgreSQL changes, "
+                 << "will reconnect: " << e.What();
+      db_.reset(NULL);
+      Wait(RECONNECT);
+    }
+  }
+
+
+  PostgreSQLChangesListener::PostgreSQLChangesListener(const PostgreSQLParameters& parameters,
+                                                       ChangesFeed& feed) :
+    PeriodicWorker("thread listening to the PostgreSQL changes"),
+    parameters_(parameters),
+    feed_(feed)
+  {
+  }
+
+
+  PostgreSQLChangesListener::~PostgreSQLChangesListener()
+  {
+    Stop();
+  }
+
+
+  void PostgreSQLChangesListener::Start()
+  {
+    // No pause between the rounds, as they wait for the notifications
+    StartWorker(0);
+  }
+
+
+  void PostgreSQLChangesListener::Stop()
+  {
+    StopWorker();
+
+    // The thread is over, the connection can be closed
+    db_.reset(NULL);
+  }
+}
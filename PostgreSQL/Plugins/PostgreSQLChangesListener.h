@@ -0,0 +1,59 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include "../../Framework/Plugins/ChangesFeed.h"
+#include "../../Framework/Plugins/PeriodicWorker.h"
+#include "../../Framework/PostgreSQL/PostgreSQLDatabase.h"
+
+#include <memory>
+
+namespace OrthancDatabases
+{
+  /**
+   * Thread that owns a dedicated connection to PostgreSQL, that
+   * listens to the "changes" channel (cf. "ChangesNotifications.sql")
+   * and that signals the changes feed. Contrarily to MySQL and SQLite,
+   * this also catches the changes committed by other instances of
+   * Orthanc that share the same database.
+   **/
+  class PostgreSQLChangesListener : public PeriodicWorker
+  {
+  private:
+    PostgreSQLParameters               parameters_;
+    ChangesFeed&                       feed_;
+    std::auto_ptr<PostgreSQLDatabase>  db_;  // Only used by the thread
+
+  protected:
+    virtual void RunRound();
+
+  public:
+    PostgreSQLChangesListener(const PostgreSQLParameters& parameters,
+                              ChangesFeed& feed);
+
+    virtual ~PostgreSQLChangesListener();
+
+    void Start();
+
+    void Stop();
+  };
+}
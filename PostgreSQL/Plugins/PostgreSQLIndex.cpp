@@ -35,11 +35,18 @@ namespace Orthanc
 {
   // Some aliases for internal properties
   static const GlobalProperty GlobalProperty_HasTrigramIndex = GlobalProperty_DatabaseInternal0;
+  static const GlobalProperty GlobalProperty_HasChangesNotifications = GlobalProperty_DatabaseInternal1;
 }
 
 
 namespace OrthancDatabases
 {
+  // The partitions of the logs are chunks of 100000 entries (cf.
+  // "PartitionLogs.sql"), so each instance of Orthanc that shares the
+  // database can add this number of entries without preparing them
+  static const unsigned int LOG_PARTITIONS_PERIOD = 1000;
+
+
   IDatabase* PostgreSQLIndex::OpenInternal()
   {
     uint32_t expectedVersion = 6;
@@ -66,6 +73,11 @@ namespace OrthancDatabases
 
     db->Open();
 
+    if (!synchronousCommit_)
+    {
+      db->Execute("SET synchronous_commit TO off");
+    }
+
     if (parameters_.HasLock())
     {
       db->AdvisoryLock(42 /* some arbitrary constant */);
@@ -113,6 +125,53 @@ namespace OrthancDatabases
         SetGlobalIntegerProperty(*db, t, Orthanc::GlobalProperty_DatabasePatchLevel, revision);
       }
 
+      if (revision == 1 &&
+          partitioning_)
+      {
+        if (db->GetServerVersion() < 110000)
+        {
+          LOG(WARNING) << "The partitioning of the PostgreSQL tables requires PostgreSQL >= 11, ignoring";
+        }
+        else
+        {
+          LOG(WARNING) << "Partitioning the tables of the DICOM tags in the PostgreSQL database "
+                       << "by resource level. This may take several minutes";
+
+          std::string query;
+
+          Orthanc::EmbeddedResources::GetFileResource
+            (query, Orthanc::EmbeddedResources::POSTGRESQL_PARTITION_TAGS);
+          db->Execute(query);
+
+          revision = 2;
+          SetGlobalIntegerProperty(*db, t, Orthanc::GlobalProperty_DatabasePatchLevel, revision);
+
+          // The trigram index was dropped together with the former table
+          SetGlobalIntegerProperty(*db, t, Orthanc::GlobalProperty_HasTrigramIndex, 0);
+        }
+      }
+
+      if (revision == 2 &&
+          partitioning_)
+      {
+        // Patch level 2 implies PostgreSQL >= 11
+        LOG(WARNING) << "Partitioning the tables of the changes and of the exported resources "
+                     << "in the PostgreSQL database. This may take several minutes";
+
+        std::string query;
+
+        Orthanc::EmbeddedResources::GetFileResource
+          (query, Orthanc::EmbeddedResources::POSTGRESQL_PARTITION_LOGS);
+        db->Execute(query);
+
+        revision = 3;
+        SetGlobalIntegerProperty(*db, t, Orthanc::GlobalProperty_DatabasePatchLevel, revision);
+
+        // The trigger of the notifications was dropped together with
+        // the former table of the changes
+        SetGlobalIntegerProperty(*db, t, Orthanc::GlobalProperty_HasChangesNotifications, 0);
+      }
+
       int hasTrigram = 0;
       if (!LookupGlobalIntegerProperty(hasTrigram, *db, t, Orthanc::GlobalProperty_HasTrigramIndex) ||
           hasTrigram != 1)
@@ -134,7 +193,7 @@ namespace OrthancDatabases
                     << "to speed up wildcard searches. This may take several minutes";
 
           db->Execute(
-            "CREATE EXTENSION pg_trgm; "
+            "CREATE EXTENSION IF NOT EXISTS pg_trgm; "
             "CREATE INDEX DicomIdentifiersIndexValues2 ON DicomIdentifiers USING gin(value gin_trgm_ops);");
 
           SetGlobalIntegerProperty(*db, t, Orthanc::GlobalProperty_HasTrigramIndex, 1);
@@ -149,10 +208,54 @@ namespace OrthancDatabases
         }
       }
 
-      if (revision != 1)
+      if (revision != 1 &&
+          revision != 2 &&
+          revision != 3)
       {
         LOG(ERROR) << "PostgreSQL plugin is incompatible with database schema revision: " << revision;
-        throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);        
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+      }
+
+      // Patch level 2 stores the level of the resources in the tables
+      // of the DICOM tags
+      SetResourceTypeInTags(revision >= 2);
+
+      logsPartitioned_ = (revision == 3);
+      logsSincePrepare_ = 0;
+
+      if (logsPartitioned_)
+      {
+        // Another instance of Orthanc may have filled the partitions
+        db->Execute("SELECT PrepareLogPartitions('changes'), "
+                    "PrepareLogPartitions('exportedresources')");
+      }
+
+      if (!db->DoesTableExist("GlobalIntegers"))
+      {
+        // Counters of the resources and of the attachments, that are
+        // maintained by triggers (also applies to older databases)
+        LOG(WARNING) << "Adding the counters of the resources and attachments to the PostgreSQL database";
+
+        std::string query;
+
+        Orthanc::EmbeddedResources::GetFileResource
+          (query, Orthanc::EmbeddedResources::POSTGRESQL_GLOBAL_INTEGERS);
+        db->Execute(query);
+      }
+
+      int hasNotifications = 0;
+      if (!LookupGlobalIntegerProperty(hasNotifications, *db, t, Orthanc::GlobalProperty_HasChangesNotifications) ||
+          hasNotifications != 1)
+      {
+        // Trigger that notifies the "PostgreSQLChangesListener" (also
+        // applies to older databases)
+        std::string query;
+
+        Orthanc::EmbeddedResources::GetFileResource
+          (query, Orthanc::EmbeddedResources::POSTGRESQL_CHANGES_NOTIFICATIONS);
+        db->Execute(query);
+
+        SetGlobalIntegerProperty(*db, t, Orthanc::GlobalProperty_HasChangesNotifications, 1);
       }
 
       t.Commit();
@@ -166,7 +269,11 @@ namespace OrthancDatabases
     IndexBackend(new Factory(*this)),
     context_(NULL),
     parameters_(parameters),
-    clearAll_(false)
+    clearAll_(false),
+    partitioning_(false),
+    synchronousCommit_(true),
+    logsPartitioned_(false),
+    logsSincePrepare_(0)
   {
   }
 
@@ -187,6 +294,105 @@ namespace OrthancDatabases
      
     statement.Execute(args);
 
-    return ReadInteger64(statement, 0);
+    int64_t id = ReadInteger64(statement, 0);
+    CacheResource(id, publicId, type);
+    SignalModification("Resources");
+    return id;
+  }
+
+
+  void PostgreSQLIndex::PrepareLogPartitions()
+  {
+    logsSincePrepare_ ++;
+
+    if (logsSincePrepare_ >= LOG_PARTITIONS_PERIOD)
+    {
+      DatabaseManager::CachedStatement statement(
+        STATEMENT_FROM_HERE, GetManager(),
+        "SELECT PrepareLogPartitions('changes'), PrepareLogPartitions('exportedresources')");
+
+      statement.Execute();
+      logsSincePrepare_ = 0;
+    }
+  }
+
+
+  void PostgreSQLIndex::LogChange(const OrthancPluginChange& change)
+  {
+    if (logsPartitioned_)
+    {
+      PrepareLogPartitions();
+    }
+
+    IndexBackend::LogChange(change);
+  }
+
+
+  void PostgreSQLIndex::LogExportedResource(const OrthancPluginExportedResource& resource)
+  {
+    if (logsPartitioned_)
+    {
+      PrepareLogPartitions();
+    }
+
+    IndexBackend::LogExportedResource(resource);
+  }
+
+
+  bool PostgreSQLIndex::DropLogPartitions(DatabaseManager::Transaction& transaction,
+                                          const char* table,
+                                          int64_t seqLimit,
+                                          const std::string& dateLimit)
+  {
+    if (!logsPartitioned_)
+    {
+      return false;
+    }
+
+    DatabaseManager::CachedStatement statement(
+      STATEMENT_FROM_HERE, transaction,
+      "SELECT DropLogPartitions(lower(${table}), ${seq}, ${date})");
+
+    statement.SetParameterType("table", ValueType_Utf8String);
+    statement.SetParameterType("seq", ValueType_Integer64);
+    statement.SetParameterType("date", ValueType_Utf8String);
+
+    Dictionary args;
+    args.SetUtf8Value("table", table);
+    args.SetIntegerValue("seq", seqLimit);
+    args.SetUtf8Value("date", dateLimit);
+
+    statement.Execute(args);
+
+    const int32_t dropped = ReadInteger32(statement, 0);
+    if (dropped > 0)
+    {
+      LOG(INFO) << "Dropped " << dropped << " partition(s) of the PostgreSQL table: " << table;
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+
+  IDatabase* PostgreSQLIndex::OpenMaintenanceDatabase()
+  {
+    // Opened as the connection of "PostgreSQLChangesListener": No
+    // advisory lock, and no timeout of the statements
+    std::auto_ptr<PostgreSQLDatabase> db(new PostgreSQLDatabase(parameters_));
+    db->Open();
+    return db.release();
+  }
+
+
+  void PostgreSQLIndex::OptimizeTable(IDatabase& database,
+                                      const std::string& table)
+  {
+    PostgreSQLDatabase& db = dynamic_cast<PostgreSQLDatabase&>(database);
+
+    LOG(INFO) << "Vacuuming and analyzing PostgreSQL table: " << table;
+    db.Execute("VACUUM (ANALYZE) " + table);
   }
 }
@@ -54,9 +54,28 @@ namespace OrthancDatabases
     OrthancPluginContext*  context_;
     PostgreSQLParameters   parameters_;
     bool                   clearAll_;
+    bool                   partitioning_;
+    bool                   synchronousCommit_;
+    bool                   logsPartitioned_;
+    unsigned int           logsSincePrepare_;
 
     IDatabase* OpenInternal();
 
+    // Creates the partitions of the logs that will receive the next
+    // entries, once every "LOG_PARTITIONS_PERIOD" new entries
+    void PrepareLogPartitions();
+
+  protected:
+    virtual void OptimizeTable(IDatabase& database,
+                               const std::string& table);
+
+    virtual IDatabase* OpenMaintenanceDatabase();
+
+    virtual bool DropLogPartitions(DatabaseManager::Transaction& transaction,
+                                   const char* table,
+                                   int64_t seqLimit,
+                                   const std::string& dateLimit);
+
   public:
     PostgreSQLIndex(const PostgreSQLParameters& parameters);
 
@@ -65,12 +84,43 @@ namespace OrthancDatabases
       context_ = context;
     }
 
+    const PostgreSQLParameters& GetParameters() const
+    {
+      return parameters_;
+    }
+
     void SetClearAll(bool clear)
     {
       clearAll_ = clear;
     }
 
+    // Upgrades the database to the optional patch level 2, where the
+    // tables "MainDicomTags" and "DicomIdentifiers" are partitioned
+    // by resource level, then to the patch level 3, where the tables
+    // "Changes" and "ExportedResources" are partitioned on "seq"
+    // (requires PostgreSQL >= 11). This cannot be reverted. Must be
+    // called before "Open()".
+    void SetPartitioning(bool partitioning)
+    {
+      partitioning_ = partitioning;
+    }
+
+    // If "false", the commits of the index return before their WAL
+    // records are flushed to the disk, which lets the server flush
+    // the commits of several transactions at once. A crash of the
+    // server may then lose the last committed transactions (at most
+    // 3 times "wal_writer_delay"), but never corrupts the database.
+    // Must be called before "Open()".
+    void SetSynchronousCommit(bool synchronous)
+    {
+      synchronousCommit_ = synchronous;
+    }
+
     virtual int64_t CreateResource(const char* publicId,
                                    OrthancPluginResourceType type);
+
+    virtual void LogChange(const OrthancPluginChange& change);
+
+    virtual void LogExportedResource(const OrthancPluginExportedResource& resource);
   };
 }
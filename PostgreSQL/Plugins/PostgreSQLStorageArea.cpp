@@ -43,6 +43,10 @@ namespace OrthancDatabases
     if (clearAll_)
     {
       db->ClearAll();
+
+      // The main connection is reopened after a failure, possibly
+      // while the other connections of the pool are in use
+      clearAll_ = false;
     }
 
     {
@@ -67,6 +71,15 @@ namespace OrthancDatabases
   }
 
 
+  IDatabase* PostgreSQLStorageArea::OpenAdditionalConnection()
+  {
+    // The table and the advisory lock are handled by the main connection
+    std::auto_ptr<PostgreSQLDatabase> db(new PostgreSQLDatabase(parameters_));
+    db->Open();
+    return db.release();
+  }
+
+
   PostgreSQLStorageArea::PostgreSQLStorageArea(const PostgreSQLParameters& parameters) :
     StorageBackend(new Factory(*this)),
     parameters_(parameters),
@@ -57,6 +57,9 @@ namespace OrthancDatabases
 
     IDatabase* OpenInternal();
 
+  protected:
+    virtual IDatabase* OpenAdditionalConnection();
+
   public:
     PostgreSQLStorageArea(const PostgreSQLParameters& parameters);
 
@@ -56,8 +56,26 @@ extern "C"
     try
     {
       OrthancDatabases::PostgreSQLParameters parameters(postgresql);
-      OrthancDatabases::StorageBackend::Register
-        (context, new OrthancDatabases::PostgreSQLStorageArea(parameters));
+
+      std::auto_ptr<OrthancDatabases::PostgreSQLStorageArea> storage
+        (new OrthancDatabases::PostgreSQLStorageArea(parameters));
+
+      // Number of attachments that can be read or written in parallel
+      unsigned int count;
+      if (postgresql.LookupUnsignedIntegerValue(count, "StorageConnectionsCount"))
+      {
+        storage->SetConnectionsCount(count);
+      }
+
+      // Window during which the writes are grouped into one commit,
+      // in milliseconds (disabled by default)
+      unsigned int window;
+      if (postgresql.LookupUnsignedIntegerValue(window, "StorageGroupCommit"))
+      {
+        storage->SetGroupCommit(window);
+      }
+
+      OrthancDatabases::StorageBackend::Register(context, storage.release());
     }
     catch (Orthanc::OrthancException& e)
     {
@@ -38,10 +38,15 @@
 #include "../../Framework/PostgreSQL/PostgreSQLTransaction.h"
 #include "../../Framework/PostgreSQL/PostgreSQLResult.h"
 #include "../../Framework/PostgreSQL/PostgreSQLLargeObject.h"
+#include "../../Framework/Common/Integer64Value.h"
 
 #include <Core/OrthancException.h>
 
 #include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+
+// PostgreSQL includes
+#include <libpq-fe.h>
 
 using namespace OrthancDatabases;
 
@@ -393,6 +398,41 @@ TEST(PostgreSQL, StorageArea)
 }
 
 
+TEST(PostgreSQL, StorageAreaConnections)
+{
+  PostgreSQLStorageArea storageArea(globalParameters_);
+  storageArea.SetClearAll(true);
+  storageArea.GetManager().Open();
+
+  storageArea.SetConnectionsCount(2);
+  ASSERT_EQ(2u, storageArea.GetConnectionsCount());
+
+  {
+    StorageBackend::Accessor accessor1(storageArea);
+    StorageBackend::Accessor accessor2(storageArea);
+    ASSERT_NE(&accessor1.GetManager(), &accessor2.GetManager());
+
+    // Both connections can run a transaction at the same time
+    DatabaseManager::Transaction transaction1(accessor1.GetManager());
+    DatabaseManager::Transaction transaction2(accessor2.GetManager());
+
+    std::string value = "Hello";
+    storageArea.Create(transaction1, "a", value.c_str(), value.size(), OrthancPluginContentType_Unknown);
+    transaction1.Commit();
+
+    std::string content;
+    storageArea.ReadToString(content, transaction2, "a", OrthancPluginContentType_Unknown);
+    ASSERT_EQ(value, content);
+    storageArea.Remove(transaction2, "a", OrthancPluginContentType_Unknown);
+    transaction2.Commit();
+  }
+
+  ASSERT_THROW(storageArea.SetConnectionsCount(0), Orthanc::OrthancException);
+  storageArea.SetConnectionsCount(1);
+  ASSERT_EQ(1u, storageArea.GetConnectionsCount());
+}
+
+
 TEST(PostgreSQL, ImplicitTransaction)
 {
   std::auto_ptr<PostgreSQLDatabase> db(CreateTestDatabase());
@@ -437,3 +477,194 @@ TEST(PostgreSQL, ImplicitTransaction)
   ASSERT_TRUE(db->DoesTableExist("test2"));
 }
 
+
+TEST(PostgreSQL, ResultErrors)
+{
+  std::auto_ptr<PostgreSQLDatabase> db(CreateTestDatabase());
+
+  db->Execute("CREATE TABLE Test(id INTEGER PRIMARY KEY)");
+  db->Execute("INSERT INTO Test VALUES(1)");
+
+  Query failing("SELECT 1 / (id - 1) FROM Test", true);
+  std::auto_ptr<IPrecompiledStatement> s(db->Compile(failing));
+
+  Query failingStreamed("SELECT 1 / (id - 1) FROM Test", true);
+  failingStreamed.SetStreaming(true);
+  std::auto_ptr<IPrecompiledStatement> u(db->Compile(failingStreamed));
+
+  Query insert("INSERT INTO Test VALUES(1)", false);
+  std::auto_ptr<IPrecompiledStatement> v(db->Compile(insert));
+
+  Query count("SELECT COUNT(*) FROM Test", true);
+  std::auto_ptr<IPrecompiledStatement> c(db->Compile(count));
+
+  {
+    // The errors are reported whether the result is streamed or not,
+    // and whether the statement is a SELECT or not
+    std::auto_ptr<ITransaction> t(db->CreateTransaction(true));
+    Dictionary args;
+    ASSERT_THROW(std::auto_ptr<IResult> r(t->Execute(*s, args)), Orthanc::OrthancException);
+    ASSERT_THROW(std::auto_ptr<IResult> r(t->Execute(*u, args)), Orthanc::OrthancException);
+    ASSERT_THROW(std::auto_ptr<IResult> r(t->Execute(*v, args)), Orthanc::OrthancException);
+  }
+
+  {
+    // The connection is still usable
+    std::auto_ptr<ITransaction> t(db->CreateTransaction(true));
+    Dictionary args;
+    std::auto_ptr<IResult> r(t->Execute(*c, args));
+    ASSERT_EQ(1, dynamic_cast<const Integer64Value&>(r->GetField(0)).GetValue());
+  }
+}
+
+TEST(PostgreSQL, StatementTimeout)
+{
+  std::auto_ptr<PostgreSQLDatabase> db(CreateTestDatabase());
+
+  Query slow("SELECT pg_sleep(2)", true);
+  slow.SetTimeout(100);
+  std::auto_ptr<IPrecompiledStatement> s(db->Compile(slow));
+
+  Query slowStreamed("SELECT pg_sleep(2)", true);
+  slowStreamed.SetTimeout(100);
+  slowStreamed.SetStreaming(true);
+  std::auto_ptr<IPrecompiledStatement> u(db->Compile(slowStreamed));
+
+  Query fast("SELECT 42", true);
+  std::auto_ptr<IPrecompiledStatement> t(db->Compile(fast));
+
+  for (unsigned int i = 0; i < 4; i++)
+  {
+    // Implicit and explicit transactions, streamed or not
+    std::auto_ptr<ITransaction> transaction(db->CreateTransaction(i < 2));
+
+    Dictionary args;
+
+    try
+    {
+      std::auto_ptr<IResult> result(transaction->Execute(i % 2 == 0 ? *s : *u, args));
+      ASSERT_TRUE(false);
+    }
+    catch (Orthanc::OrthancException& e)
+    {
+      ASSERT_EQ(Orthanc::ErrorCode_Timeout, e.GetErrorCode());
+    }
+
+    if (i >= 2)
+    {
+      // The explicit transaction is aborted by the cancellation
+      transaction->Rollback();
+      transaction.reset(db->CreateTransaction(true));
+    }
+
+    // The connection and the other statements are still usable, and
+    // are not cancelled
+    std::auto_ptr<IResult> result(transaction->Execute(*t, args));
+    ASSERT_FALSE(result->IsDone());
+  }
+}
+
+
+static bool IsCancelled(PGconn* pg,
+                        const char* sql)
+{
+  PGresult* result = PQexec(pg, sql);
+  const char* state = PQresultErrorField(result, PG_DIAG_SQLSTATE);
+  bool cancelled = (PQresultStatus(result) == PGRES_FATAL_ERROR &&
+                    state != NULL &&
+                    std::string(state) == "57014" /* query_canceled */);
+  PQclear(result);
+  return cancelled;
+}
+
+
+TEST(PostgreSQL, WatchdogGeneration)
+{
+  std::string uri;
+  globalParameters_.Format(uri);
+
+  PGconn* pg = PQconnectdb(uri.c_str());
+  ASSERT_EQ(CONNECTION_OK, PQstatus(pg));
+
+  {
+    PostgreSQLWatchdog watchdog(pg);
+
+    // Disarming an outdated generation leaves the current statement armed
+    uint64_t a = watchdog.Arm(60000);
+    uint64_t b = watchdog.Arm(100);
+    ASSERT_NE(0u, a);
+    ASSERT_LT(a, b);
+    watchdog.Disarm(a);
+    ASSERT_TRUE(IsCancelled(pg, "SELECT pg_sleep(2)"));
+    watchdog.Disarm(b);
+
+    // A disarmed generation is never cancelled, even if the deadline
+    // of the statement has passed
+    uint64_t c = watchdog.Arm(100);
+    watchdog.Disarm(c);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(300));
+    ASSERT_FALSE(IsCancelled(pg, "SELECT pg_sleep(0.5)"));
+    watchdog.Disarm(c);
+  }
+
+  PQfinish(pg);
+}
+
+TEST(PostgreSQL, Pipeline)
+{
+  std::auto_ptr<PostgreSQLDatabase> db(CreateTestDatabase());
+
+  db->Execute("CREATE TABLE Test(id INTEGER PRIMARY KEY)");
+
+  Query insert("INSERT INTO Test VALUES(${id})", false);
+  insert.SetType("id", ValueType_Integer64);
+  std::auto_ptr<IPrecompiledStatement> s(db->Compile(insert));
+
+  Query count("SELECT COUNT(*) FROM Test", true);
+  std::auto_ptr<IPrecompiledStatement> c(db->Compile(count));
+
+  {
+    std::auto_ptr<ITransaction> t(db->CreateTransaction(false));
+
+    for (int i = 0; i < 3; i++)
+    {
+      Dictionary args;
+      args.SetIntegerValue("id", i);
+      t->ExecuteWithoutResult(*s, args);
+      ASSERT_EQ(db->IsPipelineEnabled(), db->IsPipelineActive());
+    }
+
+    {
+      // Reading a result flushes the pipeline
+      Dictionary args;
+      std::auto_ptr<IResult> r(t->Execute(*c, args));
+      ASSERT_FALSE(db->IsPipelineActive());
+      ASSERT_EQ(3, dynamic_cast<const Integer64Value&>(r->GetField(0)).GetValue());
+    }
+
+    Dictionary args;
+    args.SetIntegerValue("id", 3);
+    t->ExecuteWithoutResult(*s, args);
+    t->Commit();
+    ASSERT_FALSE(db->IsPipelineActive());
+  }
+
+  {
+    // The error of a queued statement is reported at the latest by the commit
+    std::auto_ptr<ITransaction> t(db->CreateTransaction(false));
+
+    Dictionary args;
+    args.SetIntegerValue("id", 0);
+    ASSERT_THROW({ t->ExecuteWithoutResult(*s, args); t->Commit(); }, Orthanc::OrthancException);
+    t->Rollback();
+  }
+
+  {
+    std::auto_ptr<ITransaction> t(db->CreateTransaction(false));
+    Dictionary args;
+    std::auto_ptr<IResult> r(t->Execute(*c, args));
+    ASSERT_EQ(4, dynamic_cast<const Integer64Value&>(r->GetField(0)).GetValue());
+    r.reset(NULL);
+    t->Commit();
+  }
+}
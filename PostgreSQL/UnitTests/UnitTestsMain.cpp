@@ -20,10 +20,15 @@
 
 
 #include "../Plugins/PostgreSQLIndex.h"
+#include "../../Framework/PostgreSQL/PostgreSQLDatabase.h"
+#include "../../Framework/PostgreSQL/PostgreSQLResult.h"
 
 #include <Core/Logging.h>
 #include <gtest/gtest.h>
 
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+
 OrthancDatabases::PostgreSQLParameters  globalParameters_;
 
 #include "../../Framework/Plugins/IndexUnitTests.h"
@@ -106,6 +111,208 @@ TEST(PostgreSQLIndex, Lock)
 }
 
 
+TEST(PostgreSQLIndex, Partitioning)
+{
+  OrthancPluginChange change;
+  change.changeType = 0;
+  change.resourceType = OrthancPluginResourceType_Patient;
+  change.publicId = "patient";
+  change.date = "20180101T000000";
+
+  {
+    OrthancDatabases::PostgreSQLIndex db(globalParameters_);
+    db.SetClearAll(true);
+    db.Open();
+
+    db.CreateResource("patient", OrthancPluginResourceType_Patient);
+    db.LogChange(change);
+    db.LogChange(change);
+  }
+
+  {
+    // The upgrade keeps the changes, and their numbering
+    OrthancDatabases::PostgreSQLIndex db(globalParameters_);
+    db.SetPartitioning(true);
+    db.Open();
+    db.LogChange(change);
+
+    OrthancDatabases::PostgreSQLDatabase pg(globalParameters_);
+    pg.Open();
+
+    OrthancDatabases::PostgreSQLStatement s(pg, "SELECT MIN(seq), MAX(seq), COUNT(*) FROM Changes", true);
+    OrthancDatabases::PostgreSQLResult r(s);
+    ASSERT_EQ(1, r.GetInteger64(0));
+    ASSERT_EQ(3, r.GetInteger64(1));
+    ASSERT_EQ(3, r.GetInteger64(2));
+  }
+
+  {
+    OrthancDatabases::PostgreSQLIndex db(globalParameters_);
+    db.SetClearAll(true);
+    db.SetPartitioning(true);
+    db.Open();
+
+    int64_t patient = db.CreateResource("patient", OrthancPluginResourceType_Patient);
+    int64_t study = db.CreateResource("study", OrthancPluginResourceType_Study);
+    db.SetIdentifierTag(patient, 0x0010, 0x0020, "hello");
+    db.SetIdentifierTag(study, 0x0010, 0x0020, "hello");
+    db.SetMainDicomTag(study, 0x0008, 0x1030, "world");
+
+    std::list<int64_t> ids;
+    db.LookupIdentifier(ids, OrthancPluginResourceType_Study, 0x0010, 0x0020,
+                        OrthancPluginIdentifierConstraint_Equal, "hello");
+    ASSERT_EQ(1u, ids.size());
+    ASSERT_EQ(study, ids.front());
+
+    db.LookupIdentifierRange(ids, OrthancPluginResourceType_Patient, 0x0010, 0x0020, "a", "z");
+    ASSERT_EQ(1u, ids.size());
+    ASSERT_EQ(patient, ids.front());
+
+    db.LookupIdentifier(ids, OrthancPluginResourceType_Series, 0x0010, 0x0020,
+                        OrthancPluginIdentifierConstraint_Wildcard, "h*");
+    ASSERT_TRUE(ids.empty());
+
+    // The log of changes is partitioned by chunks of 100000 entries
+    db.LogChange(change);
+    db.LogChange(change);
+
+    OrthancDatabases::PostgreSQLDatabase pg(globalParameters_);
+    pg.Open();
+    pg.Execute("SELECT setval('changes_seq_seq', 250000), PrepareLogPartitions('changes')");
+
+    db.LogChange(change);
+
+    {
+      OrthancDatabases::PostgreSQLStatement s(
+        pg, "SELECT COUNT(*) FROM pg_inherits WHERE inhparent = 'changes'::regclass", true);
+      OrthancDatabases::PostgreSQLResult r(s);
+      ASSERT_EQ(4, r.GetInteger64(0));
+    }
+
+    // The chunks 0 and 1 are dropped at once, the chunks 2 and 3 can
+    // still receive new changes
+    ASSERT_TRUE(db.PruneChanges(1, 0, 10));
+    ASSERT_FALSE(db.PruneChanges(1, 0, 10));
+
+    {
+      OrthancDatabases::PostgreSQLStatement s(
+        pg, "SELECT COUNT(*) FROM pg_inherits WHERE inhparent = 'changes'::regclass", true);
+      OrthancDatabases::PostgreSQLResult r(s);
+      ASSERT_EQ(2, r.GetInteger64(0));
+    }
+
+    {
+      OrthancDatabases::PostgreSQLStatement s(pg, "SELECT MIN(seq), COUNT(*) FROM Changes", true);
+      OrthancDatabases::PostgreSQLResult r(s);
+      ASSERT_EQ(250001, r.GetInteger64(0));
+      ASSERT_EQ(1, r.GetInteger64(1));
+    }
+  }
+
+  {
+    // Back to a non-partitioned database for the other tests
+    OrthancDatabases::PostgreSQLIndex db(globalParameters_);
+    db.SetClearAll(true);
+    db.Open();
+  }
+}
+
+
+TEST(PostgreSQLIndex, SynchronousCommit)
+{
+  {
+    OrthancDatabases::PostgreSQLIndex db(globalParameters_);
+    db.SetClearAll(true);
+    db.SetSynchronousCommit(false);
+    db.Open();
+
+    db.StartTransaction();
+    int64_t patient = db.CreateResource("patient", OrthancPluginResourceType_Patient);
+    db.CommitTransaction();
+
+    OrthancPluginResourceType type;
+    int64_t id;
+    ASSERT_TRUE(db.LookupResource(id, type, "patient"));
+    ASSERT_EQ(patient, id);
+  }
+
+  {
+    // The commit is visible to the other connections
+    OrthancDatabases::PostgreSQLIndex db(globalParameters_);
+    db.Open();
+
+    OrthancPluginResourceType type;
+    int64_t id;
+    ASSERT_TRUE(db.LookupResource(id, type, "patient"));
+    ASSERT_EQ(OrthancPluginResourceType_Patient, type);
+  }
+
+  {
+    OrthancDatabases::PostgreSQLIndex db(globalParameters_);
+    db.SetClearAll(true);
+    db.Open();
+  }
+}
+
+
+TEST(PostgreSQLIndex, DISABLED_PartitioningBenchmark)
+{
+  // Run with "--gtest_also_run_disabled_tests" to compare the latency
+  // of the identifier lookups with and without partitioning of the
+  // "DicomIdentifiers" table by resource level
+  static const unsigned int COUNT = 10000;
+  static const unsigned int LOOKUPS = 1000;
+
+  for (unsigned int mode = 0; mode < 2; mode++)
+  {
+    OrthancDatabases::PostgreSQLIndex db(globalParameters_);
+    db.SetClearAll(true);
+    db.SetPartitioning(mode == 1);
+    db.Open();
+
+    db.StartTransaction();
+    for (unsigned int i = 0; i < COUNT; i++)
+    {
+      // One patient, study, series and instance per iteration
+      const std::string suffix = boost::lexical_cast<std::string>(i);
+      int64_t patient = db.CreateResource(("patient" + suffix).c_str(), OrthancPluginResourceType_Patient);
+      int64_t study = db.CreateResource(("study" + suffix).c_str(), OrthancPluginResourceType_Study);
+      int64_t series = db.CreateResource(("series" + suffix).c_str(), OrthancPluginResourceType_Series);
+      int64_t instance = db.CreateResource(("instance" + suffix).c_str(), OrthancPluginResourceType_Instance);
+      db.SetIdentifierTag(patient, 0x0010, 0x0020, ("id" + suffix).c_str());
+      db.SetIdentifierTag(study, 0x0010, 0x0020, ("id" + suffix).c_str());
+      db.SetIdentifierTag(series, 0x0020, 0x000e, ("series" + suffix).c_str());
+      db.SetIdentifierTag(instance, 0x0008, 0x0018, ("instance" + suffix).c_str());
+    }
+    db.CommitTransaction();
+
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+    std::list<int64_t> ids;
+    for (unsigned int i = 0; i < LOOKUPS; i++)
+    {
+      const std::string value = "id" + boost::lexical_cast<std::string>((i * 7919) % COUNT);
+      db.LookupIdentifier(ids, OrthancPluginResourceType_Study, 0x0010, 0x0020,
+                          OrthancPluginIdentifierConstraint_Equal, value.c_str());
+      ASSERT_EQ(1u, ids.size());
+    }
+
+    boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+
+    LOG(WARNING) << (mode == 1 ? "Partitioned" : "Not partitioned") << ": "
+                 << (elapsed.total_microseconds() / LOOKUPS)
+                 << " microseconds/lookup";
+  }
+
+  {
+    // Back to a non-partitioned database for the other tests
+    OrthancDatabases::PostgreSQLIndex db(globalParameters_);
+    db.SetClearAll(true);
+    db.Open();
+  }
+}
+
+
 int main(int argc, char **argv)
 {
   if (argc < 6)
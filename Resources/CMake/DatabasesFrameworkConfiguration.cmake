@@ -130,6 +130,7 @@ if (ENABLE_POSTGRESQL_BACKEND)
     ${ORTHANC_DATABASES_ROOT}/Framework/PostgreSQL/PostgreSQLResult.cpp
     ${ORTHANC_DATABASES_ROOT}/Framework/PostgreSQL/PostgreSQLStatement.cpp
     ${ORTHANC_DATABASES_ROOT}/Framework/PostgreSQL/PostgreSQLTransaction.cpp
+    ${ORTHANC_DATABASES_ROOT}/Framework/PostgreSQL/PostgreSQLWatchdog.cpp
     ${LIBPQ_SOURCES}
     )
 else()
@@ -42,8 +42,18 @@ endif()
 
 list(APPEND DATABASES_SOURCES
   ${ORTHANC_CORE_SOURCES}
+  ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/ChangesFeed.cpp
   ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/GlobalProperties.cpp
   ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/IndexBackend.cpp
+  ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/IndexMaintenance.cpp
+  ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/IndexStatistics.cpp
+  ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/LogsRetention.cpp
+  ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/MainDicomTagsCache.cpp
+  ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/PeriodicWorker.cpp
+  ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/PublicIdsFilter.cpp
+  ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/PublicIdsFilterRebuilder.cpp
+  ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/ReadAheadCache.cpp
+  ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/ResourcesCache.cpp
   ${ORTHANC_DATABASES_ROOT}/Framework/Plugins/StorageBackend.cpp
   ${ORTHANC_ROOT}/Plugins/Samples/Common/OrthancPluginCppWrapper.cpp
   )
@@ -0,0 +1,47 @@
+-- Counters maintained by triggers, so that the statistics about the
+-- resources and the attachments are read in constant time instead of
+-- scanning the "Resources" and "AttachedFiles" tables.
+--
+--   property = 0                 => Total compressed size of the attachments
+--   property = 1                 => Total uncompressed size of the attachments
+--   property = 2 + resourceType  => Number of resources at this level
+
+CREATE TABLE GlobalIntegers(
+       property INTEGER PRIMARY KEY,
+       value INTEGER NOT NULL
+       );
+
+-- Initialization from the current content of the database (if upgrading)
+INSERT INTO GlobalIntegers VALUES(0, (SELECT COALESCE(SUM(compressedSize), 0) FROM AttachedFiles));
+INSERT INTO GlobalIntegers VALUES(1, (SELECT COALESCE(SUM(uncompressedSize), 0) FROM AttachedFiles));
+INSERT INTO GlobalIntegers VALUES(2, (SELECT COUNT(*) FROM Resources WHERE resourceType = 0));
+INSERT INTO GlobalIntegers VALUES(3, (SELECT COUNT(*) FROM Resources WHERE resourceType = 1));
+INSERT INTO GlobalIntegers VALUES(4, (SELECT COUNT(*) FROM Resources WHERE resourceType = 2));
+INSERT INTO GlobalIntegers VALUES(5, (SELECT COUNT(*) FROM Resources WHERE resourceType = 3));
+
+
+CREATE TRIGGER AttachedFileAddedCounters
+AFTER INSERT ON AttachedFiles
+BEGIN
+  UPDATE GlobalIntegers SET value = value + COALESCE(new.compressedSize, 0) WHERE property = 0;
+  UPDATE GlobalIntegers SET value = value + COALESCE(new.uncompressedSize, 0) WHERE property = 1;
+END;
+
+CREATE TRIGGER AttachedFileDeletedCounters
+AFTER DELETE ON AttachedFiles
+BEGIN
+  UPDATE GlobalIntegers SET value = value - COALESCE(old.compressedSize, 0) WHERE property = 0;
+  UPDATE GlobalIntegers SET value = value - COALESCE(old.uncompressedSize, 0) WHERE property = 1;
+END;
+
+CREATE TRIGGER ResourceAddedCounters
+AFTER INSERT ON Resources
+BEGIN
+  UPDATE GlobalIntegers SET value = value + 1 WHERE property = 2 + new.resourceType;
+END;
+
+CREATE TRIGGER ResourceDeletedCounters
+AFTER DELETE ON Resources
+BEGIN
+  UPDATE GlobalIntegers SET value = value - 1 WHERE property = 2 + old.resourceType;
+END;
@@ -19,12 +19,25 @@
  **/
 
 
+#include "SQLiteCheckpointer.h"
 #include "SQLiteIndex.h"
+#include "SQLiteSnapshotter.h"
+#include "../../Framework/Plugins/IndexMaintenance.h"
+#include "../../Framework/Plugins/IndexStatistics.h"
+#include "../../Framework/Plugins/LogsRetention.h"
 #include "../../Framework/Plugins/PluginInitialization.h"
+#include "../../Framework/Plugins/PublicIdsFilterRebuilder.h"
 
 #include <Core/Logging.h>
 
 static std::auto_ptr<OrthancDatabases::SQLiteIndex> backend_;
+static std::auto_ptr<OrthancDatabases::IndexMaintenance> maintenance_;
+static std::auto_ptr<OrthancDatabases::LogsRetention> retention_;
+static std::auto_ptr<OrthancDatabases::PublicIdsFilterRebuilder> filterRebuilder_;
+static std::auto_ptr<OrthancDatabases::SQLiteCheckpointer> checkpointer_;
+static std::auto_ptr<OrthancDatabases::SQLiteSnapshotter> snapshotter_;
+static std::auto_ptr<OrthancDatabases::ChangesFeed> changesFeed_;
+static std::auto_ptr<OrthancDatabases::IndexStatistics> statistics_;
 
 
 extern "C"
@@ -60,11 +73,92 @@ extern "C"
 
     try
     {
+      // The options of the "SQLite" section are optional
+      OrthancPlugins::OrthancConfiguration sqlite;
+
+      {
+        OrthancPlugins::OrthancConfiguration configuration(context);
+        if (configuration.IsSection("SQLite"))
+        {
+          configuration.GetSection(sqlite, "SQLite");
+        }
+      }
+
       /* Create the database back-end */
       backend_.reset(new OrthancDatabases::SQLiteIndex("index.db"));  // TODO parameter
 
+      bool inMemory;
+      if (sqlite.LookupBooleanValue(inMemory, "InMemory"))
+      {
+        backend_->SetInMemory(inMemory);
+      }
+
+      bool backgroundCheckpoints;
+      if (backend_->IsInMemory())
+      {
+        backgroundCheckpoints = false;  // No write-ahead log in memory
+      }
+      else if (!sqlite.LookupBooleanValue(backgroundCheckpoints, "BackgroundCheckpoints"))
+      {
+        backgroundCheckpoints = true;
+      }
+
+      backend_->SetBackgroundCheckpoints(backgroundCheckpoints);
+
       /* Register the SQLite index into Orthanc */
       OrthancPlugins::DatabaseBackendAdapter::Register(context, *backend_);
+
+      /* Long polling on the changes, signalled by the index on commits */
+      changesFeed_.reset(new OrthancDatabases::ChangesFeed(context));
+      changesFeed_->ReadConfiguration(sqlite);
+      changesFeed_->Register("/sqlite/changes");
+      backend_->SetChangesFeed(*changesFeed_);
+
+      /* Start the removal of the old changes and exported resources */
+      retention_.reset(new OrthancDatabases::LogsRetention(*backend_));
+      retention_->ReadConfiguration(sqlite);
+      retention_->Start();
+
+      /* Start the maintenance of the most modified tables */
+      maintenance_.reset(new OrthancDatabases::IndexMaintenance(*backend_));
+      maintenance_->ReadConfiguration(sqlite);
+      maintenance_->Start();
+
+      /* Rebuilds of the filter of the public IDs, out of the transactions of Orthanc */
+      filterRebuilder_.reset(new OrthancDatabases::PublicIdsFilterRebuilder(*backend_));
+      filterRebuilder_->Start();
+
+      /* Checkpoints of the write-ahead log, out of the commits of Orthanc */
+      if (backgroundCheckpoints)
+      {
+        checkpointer_.reset(new OrthancDatabases::SQLiteCheckpointer(*backend_));
+
+        unsigned int period;  // In milliseconds
+        if (sqlite.LookupUnsignedIntegerValue(period, "CheckpointPeriod"))
+        {
+          checkpointer_->SetPeriod(period);
+        }
+
+        checkpointer_->Start();
+      }
+
+      /* Periodic snapshots of the index that is kept in memory */
+      if (backend_->IsInMemory())
+      {
+        snapshotter_.reset(new OrthancDatabases::SQLiteSnapshotter(*backend_));
+
+        unsigned int period;  // In seconds
+        if (sqlite.LookupUnsignedIntegerValue(period, "SnapshotPeriod"))
+        {
+          snapshotter_->SetPeriod(period);
+        }
+
+        snapshotter_->Start();
+      }
+
+      /* Statistics about the caches of the index */
+      statistics_.reset(new OrthancDatabases::IndexStatistics(context, *backend_));
+      statistics_->Register("/sqlite/statistics");
     }
     catch (Orthanc::OrthancException& e)
     {
@@ -84,7 +178,14 @@ extern "C"
   ORTHANC_PLUGINS_API void OrthancPluginFinalize()
   {
     LOG(WARNING) << "SQLite index is finalizing";
+    statistics_.reset(NULL);
+    checkpointer_.reset(NULL);
+    snapshotter_.reset(NULL);
+    maintenance_.reset(NULL);
+    filterRebuilder_.reset(NULL);
+    retention_.reset(NULL);
     backend_.reset(NULL);
+    changesFeed_.reset(NULL);
   }
 
 
@@ -0,0 +1,90 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "SQLiteCheckpointer.h"
+
+#include <Core/Logging.h>
+#include <Core/OrthancException.h>
+
+namespace OrthancDatabases
+{
+  void SQLiteCheckpointer::RunRound()
+  {
+    int walFrames;
+    if (index_.Checkpoint(walFrames, false /* passive */))
+    {
+      if (walFrames > 0 &&
+          walFrames == previousFrames_)
+      {
+        // No write since the previous round: Orthanc is idle
+        if (index_.Checkpoint(walFrames, true /* truncate */))
+        {
+          walFrames = 0;
+        }
+      }
+
+      previousFrames_ = walFrames;
+    }
+  }
+
+
+  SQLiteCheckpointer::SQLiteCheckpointer(SQLiteIndex& index) :
+    PeriodicWorker("checkpoint thread of the SQLite index"),
+    index_(index),
+    period_(1000),
+    previousFrames_(0)
+  {
+  }
+
+
+  SQLiteCheckpointer::~SQLiteCheckpointer()
+  {
+    Stop();
+  }
+
+
+  void SQLiteCheckpointer::SetPeriod(unsigned int milliseconds)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+    else if (milliseconds == 0)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+    }
+
+    period_ = milliseconds;
+  }
+
+
+  void SQLiteCheckpointer::Start()
+  {
+    previousFrames_ = 0;
+    StartWorker(period_);
+  }
+
+
+  void SQLiteCheckpointer::Stop()
+  {
+    StopWorker();
+  }
+}
@@ -0,0 +1,59 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include "SQLiteIndex.h"
+#include "../../Framework/Plugins/PeriodicWorker.h"
+
+namespace OrthancDatabases
+{
+  /**
+   * Background thread that checkpoints the write-ahead log of the
+   * SQLite index (cf. "SQLiteIndex::SetBackgroundCheckpoints()"), so
+   * that no commit of Orthanc pays for a checkpoint. The checkpoints
+   * run on their own connection to the database file, in parallel
+   * with the transactions of Orthanc. Once the log stops growing, it
+   * is also truncated.
+   **/
+  class SQLiteCheckpointer : public PeriodicWorker
+  {
+  private:
+    SQLiteIndex&   index_;
+    unsigned int   period_;
+    int            previousFrames_;
+
+  protected:
+    virtual void RunRound();
+
+  public:
+    explicit SQLiteCheckpointer(SQLiteIndex& index);
+
+    virtual ~SQLiteCheckpointer();
+
+    // Number of milliseconds between two checkpoints
+    void SetPeriod(unsigned int milliseconds);
+
+    void Start();
+
+    void Stop();
+  };
+}
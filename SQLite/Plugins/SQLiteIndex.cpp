@@ -29,6 +29,11 @@
 
 #include <Core/Logging.h>
 #include <Core/OrthancException.h>
+#include <Core/SystemToolbox.h>
+
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread.hpp>
 
 namespace OrthancDatabases
 {
@@ -61,6 +66,16 @@ namespace OrthancDatabases
     {
       db->OpenInMemory();
     }
+    else if (inMemory_)
+    {
+      db->OpenInMemory();
+
+      if (Orthanc::SystemToolbox::IsRegularFile(path_))
+      {
+        LOG(WARNING) << "Loading the SQLite index in memory from snapshot: " << path_;
+        db->LoadSnapshot(path_);
+      }
+    }
     else
     {
       db->Open(path_);
@@ -86,14 +101,26 @@ namespace OrthancDatabases
 
     db->Execute("PRAGMA ENCODING=\"UTF-8\";");
 
-    if (fast_)
+    if (fast_ &&
+        !inMemory_)
     {
       // Performance tuning of SQLite with PRAGMAs
       // http://www.sqlite.org/pragma.html
       db->Execute("PRAGMA SYNCHRONOUS=NORMAL;");
       db->Execute("PRAGMA JOURNAL_MODE=WAL;");
-      db->Execute("PRAGMA LOCKING_MODE=EXCLUSIVE;");
-      db->Execute("PRAGMA WAL_AUTOCHECKPOINT=1000;");
+
+      if (backgroundCheckpoints_)
+      {
+        // No exclusive locking, so that the checkpoints can run on
+        // another connection (cf. "Checkpoint()")
+        db->Execute("PRAGMA WAL_AUTOCHECKPOINT=0;");
+      }
+      else
+      {
+        db->Execute("PRAGMA LOCKING_MODE=EXCLUSIVE;");
+        db->Execute("PRAGMA WAL_AUTOCHECKPOINT=1000;");
+      }
+
       //db->Execute("PRAGMA TEMP_STORE=memory");
     }
 
@@ -124,9 +151,20 @@ namespace OrthancDatabases
       if (revision != 1)
       {
         LOG(ERROR) << "SQLite plugin is incompatible with database schema revision: " << revision;
-        throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);        
-      }      
-          
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_Database);
+      }
+
+      if (!db->DoesTableExist("GlobalIntegers"))
+      {
+        // Counters of the resources and of the attachments, that are
+        // maintained by triggers (also applies to older databases)
+        std::string query;
+
+        Orthanc::EmbeddedResources::GetFileResource
+          (query, Orthanc::EmbeddedResources::SQLITE_GLOBAL_INTEGERS);
+        db->Execute(query);
+      }
+
       t.Commit();
     }
 
@@ -138,7 +176,16 @@ namespace OrthancDatabases
     IndexBackend(new Factory(*this)),
     context_(NULL),
     path_(path),
-    fast_(true)
+    fast_(true),
+    backgroundCheckpoints_(false),
+    checkpointsCount_(0),
+    walFrames_(0),
+    lastCheckpointDuration_(0),
+    maxCheckpointDuration_(0),
+    inMemory_(false),
+    isOpen_(false),
+    snapshotsCount_(0),
+    lastSnapshotDuration_(0)
   {
     if (path.empty())
     {
@@ -150,7 +197,16 @@ namespace OrthancDatabases
   SQLiteIndex::SQLiteIndex() :
     IndexBackend(new Factory(*this)),
     context_(NULL),
-    fast_(true)
+    fast_(true),
+    backgroundCheckpoints_(false),
+    checkpointsCount_(0),
+    walFrames_(0),
+    lastCheckpointDuration_(0),
+    maxCheckpointDuration_(0),
+    inMemory_(false),
+    isOpen_(false),
+    snapshotsCount_(0),
+    lastSnapshotDuration_(0)
   {
   }
 
@@ -171,6 +227,219 @@ namespace OrthancDatabases
     
     statement.Execute(args);
 
-    return dynamic_cast<SQLiteDatabase&>(statement.GetDatabase()).GetLastInsertRowId();
+    int64_t id = dynamic_cast<SQLiteDatabase&>(statement.GetDatabase()).GetLastInsertRowId();
+    CacheResource(id, publicId, type);
+    SignalModification("Resources");
+    return id;
+  }
+
+
+  void SQLiteIndex::OptimizeTable(IDatabase& database,
+                                  const std::string& table)
+  {
+    SQLiteDatabase& db = dynamic_cast<SQLiteDatabase&>(database);
+
+    // The free pages of the file are reused by the next insertions,
+    // so there is no need to "VACUUM" a table (which would rebuild
+    // the whole database file)
+    LOG(INFO) << "Analyzing SQLite table: " << table;
+    db.Execute("ANALYZE " + table);
+    db.Execute("PRAGMA optimize");
+  }
+
+
+  bool SQLiteIndex::Checkpoint(int& walFrames,
+                               bool truncate)
+  {
+    if (!backgroundCheckpoints_ ||
+        path_.empty() ||
+        inMemory_)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    // The manager is not locked: The checkpoint runs on its own
+    // connection, in parallel with the transactions of Orthanc
+    boost::mutex::scoped_lock lock(checkpointMutex_);
+
+    if (checkpointDatabase_.get() == NULL)
+    {
+      checkpointDatabase_.reset(new SQLiteDatabase);
+      checkpointDatabase_->Open(path_);
+
+      // Reads the header of the file, so that the connection knows
+      // about the write-ahead log before the first checkpoint
+      checkpointDatabase_->Execute("PRAGMA JOURNAL_MODE=WAL;");
+    }
+
+    const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+    int checkpointedFrames;
+    bool done;
+
+    try
+    {
+      done = checkpointDatabase_->Checkpoint(walFrames, checkpointedFrames, truncate);
+    }
+    catch (Orthanc::OrthancException&)
+    {
+      // Reopen the connection at the next round
+      checkpointDatabase_.reset(NULL);
+      throw;
+    }
+
+    const uint64_t duration = static_cast<uint64_t>(
+      (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds());
+
+    {
+      boost::mutex::scoped_lock statisticsLock(statisticsMutex_);
+      checkpointsCount_++;
+      walFrames_ = walFrames;
+      lastCheckpointDuration_ = duration;
+      maxCheckpointDuration_ = std::max(maxCheckpointDuration_, duration);
+    }
+
+    return (done &&
+            walFrames == checkpointedFrames);
+  }
+
+
+  void SQLiteIndex::SetInMemory(bool inMemory)
+  {
+    if (path_.empty())
+    {
+      // No file to store the snapshots
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    inMemory_ = inMemory;
+  }
+
+
+  bool SQLiteIndex::WriteSnapshot(int pagesPerStep,
+                                  ICancellation* cancellation)
+  {
+    // Pause between two steps, to let Orthanc access the index
+    static const unsigned int PAUSE = 10;  // In milliseconds
+
+    if (!inMemory_)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+
+    boost::mutex::scoped_lock snapshotsLock(snapshotsMutex_);
+
+    if (!isOpen_)
+    {
+      return false;
+    }
+
+    const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+    std::auto_ptr<SQLiteDatabase::SnapshotWriter> writer;
+
+    for (;;)
+    {
+      if (cancellation != NULL &&
+          cancellation->IsCancelled())
+      {
+        // The temporary file is removed by the destructor of "writer"
+        LOG(INFO) << "Snapshot of the SQLite index cancelled: " << path_;
+        return false;
+      }
+
+      {
+        DatabaseManager::IdleLock lock(GetManager());
+
+        if (lock.IsIdle())
+        {
+          SQLiteDatabase& db = dynamic_cast<SQLiteDatabase&>(lock.GetDatabase());
+
+          if (writer.get() == NULL ||
+              &writer->GetSource() != &db)
+          {
+            // Start the snapshot (again, if the connection was reopened)
+            writer.reset(new SQLiteDatabase::SnapshotWriter(db, path_));
+          }
+
+          if (writer->Step(pagesPerStep))
+          {
+            writer->Commit();
+            break;
+          }
+        }
+      }
+
+      boost::this_thread::sleep(boost::posix_time::milliseconds(PAUSE));
+    }
+
+    const boost::posix_time::time_duration duration =
+      boost::posix_time::microsec_clock::universal_time() - start;
+
+    LOG(INFO) << "Snapshot of the SQLite index written in "
+              << duration.total_milliseconds() << "ms: " << path_;
+
+    {
+      boost::mutex::scoped_lock statisticsLock(statisticsMutex_);
+      snapshotsCount_++;
+      lastSnapshotDuration_ = static_cast<uint64_t>(duration.total_milliseconds());
+    }
+
+    return true;
+  }
+
+
+  void SQLiteIndex::Open()
+  {
+    IndexBackend::Open();
+
+    boost::mutex::scoped_lock lock(snapshotsMutex_);
+    isOpen_ = true;
+  }
+
+
+  void SQLiteIndex::Close()
+  {
+    if (inMemory_)
+    {
+      // Final snapshot, as the content of the index is lost once the
+      // connection is closed
+      WriteSnapshot(-1, NULL);
+    }
+
+    {
+      boost::mutex::scoped_lock lock(snapshotsMutex_);
+      isOpen_ = false;
+    }
+
+    {
+      boost::mutex::scoped_lock lock(checkpointMutex_);
+      checkpointDatabase_.reset(NULL);
+    }
+
+    IndexBackend::Close();
+  }
+
+
+  void SQLiteIndex::GetStatistics(Json::Value& target)
+  {
+    IndexBackend::GetStatistics(target);
+
+    boost::mutex::scoped_lock lock(statisticsMutex_);
+
+    Json::Value& checkpoints = target["Checkpoints"];
+    checkpoints = Json::objectValue;
+    checkpoints["Count"] = static_cast<Json::UInt64>(checkpointsCount_);
+    checkpoints["WalFrames"] = walFrames_;  // "-1" if not in WAL mode
+    checkpoints["LastDurationUs"] = static_cast<Json::UInt64>(lastCheckpointDuration_);
+    checkpoints["MaxDurationUs"] = static_cast<Json::UInt64>(maxCheckpointDuration_);
+
+    if (inMemory_)
+    {
+      Json::Value& snapshots = target["Snapshots"];
+      snapshots = Json::objectValue;
+      snapshots["Count"] = static_cast<Json::UInt64>(snapshotsCount_);
+      snapshots["LastDurationMs"] = static_cast<Json::UInt64>(lastSnapshotDuration_);
+    }
   }
 }
@@ -22,6 +22,9 @@
 #pragma once
 
 #include "../../Framework/Plugins/IndexBackend.h"
+#include "../../Framework/SQLite/SQLiteDatabase.h"
+
+#include <boost/thread/mutex.hpp>
 
 namespace OrthancDatabases
 {
@@ -53,9 +56,35 @@ namespace OrthancDatabases
     OrthancPluginContext*  context_;
     std::string            path_;
     bool                   fast_;
+    bool                   backgroundCheckpoints_;
+
+    // Statistics about the checkpoints of the write-ahead log, and
+    // about the snapshots
+    boost::mutex           statisticsMutex_;
+    uint64_t               checkpointsCount_;
+    int                    walFrames_;
+    uint64_t               lastCheckpointDuration_;  // In microseconds
+    uint64_t               maxCheckpointDuration_;   // In microseconds
+
+    // Connection to the database file that is dedicated to the
+    // checkpoints (opened by the first call to "Checkpoint()")
+    boost::mutex                   checkpointMutex_;
+    std::auto_ptr<SQLiteDatabase>  checkpointDatabase_;
+
+    // Snapshots of the database that is kept in memory (the mutex
+    // serializes the snapshots, and protects "isOpen_")
+    bool                   inMemory_;
+    boost::mutex           snapshotsMutex_;
+    bool                   isOpen_;
+    uint64_t               snapshotsCount_;
+    uint64_t               lastSnapshotDuration_;  // In milliseconds
 
     IDatabase* OpenInternal();
 
+  protected:
+    virtual void OptimizeTable(IDatabase& database,
+                               const std::string& table);
+
   public:
     SQLiteIndex();  // Opens in memory
 
@@ -71,6 +100,71 @@ namespace OrthancDatabases
       fast_ = fast;
     }
 
+    // Disables the automatic checkpoints of the write-ahead log, that
+    // are run by the commit that crosses the threshold, which leaves
+    // the checkpoints to "Checkpoint()". The database file is then not
+    // opened in exclusive locking mode, as "Checkpoint()" opens its
+    // own connection to it. Must be called before "Open()".
+    void SetBackgroundCheckpoints(bool background)
+    {
+      backgroundCheckpoints_ = background;
+    }
+
+    /**
+     * Runs a checkpoint of the write-ahead log ("truncate" also
+     * resets the log file to zero bytes), on the connection that is
+     * dedicated to the checkpoints: Orthanc can access the index in
+     * the meantime. Returns "false" if the checkpoint could not
+     * complete because of the transactions of Orthanc, in which case
+     * it is to be retried later. "walFrames" receives the size of the
+     * log, in frames. This is invoked by the background thread of
+     * "SQLiteCheckpointer".
+     **/
+    bool Checkpoint(int& walFrames,
+                    bool truncate);
+
+    /**
+     * Keeps the whole index in memory. The file that was given to the
+     * constructor is only used to store snapshots: The last snapshot
+     * is loaded by "Open()", and "Close()" writes a final snapshot.
+     * The modifications since the last snapshot are lost on a crash.
+     * Must be called before "Open()".
+     **/
+    void SetInMemory(bool inMemory);
+
+    bool IsInMemory() const
+    {
+      return inMemory_;
+    }
+
+    // Checked by "WriteSnapshot()" between two steps of the copy
+    class ICancellation : public boost::noncopyable
+    {
+    public:
+      virtual ~ICancellation()
+      {
+      }
+
+      virtual bool IsCancelled() = 0;
+    };
+
+    /**
+     * Writes a snapshot of the in-memory index, by steps of at most
+     * "pagesPerStep" pages ("-1" means one single step). Orthanc can
+     * run its transactions between two steps. Returns "false" if the
+     * index is closed, or if "cancellation" fires before the copy is
+     * complete (in which case the previous snapshot is kept). This is
+     * invoked by the background thread of "SQLiteSnapshotter".
+     **/
+    bool WriteSnapshot(int pagesPerStep,
+                       ICancellation* cancellation /* can be NULL */);
+
+    virtual void Open();
+
+    virtual void Close();
+
+    virtual void GetStatistics(Json::Value& target);
+
     virtual int64_t CreateResource(const char* publicId,
                                    OrthancPluginResourceType type);
   };
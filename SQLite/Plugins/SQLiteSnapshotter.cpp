@@ -0,0 +1,91 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "SQLiteSnapshotter.h"
+
+#include <Core/Logging.h>
+#include <Core/OrthancException.h>
+
+namespace OrthancDatabases
+{
+  void SQLiteSnapshotter::RunRound()
+  {
+    index_.WriteSnapshot(pagesPerStep_, this);
+  }
+
+
+  SQLiteSnapshotter::SQLiteSnapshotter(SQLiteIndex& index) :
+    PeriodicWorker("snapshot thread of the SQLite index"),
+    index_(index),
+    period_(60),
+    pagesPerStep_(256)
+  {
+  }
+
+
+  SQLiteSnapshotter::~SQLiteSnapshotter()
+  {
+    Stop();
+  }
+
+
+  void SQLiteSnapshotter::SetPeriod(unsigned int seconds)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+    else if (seconds == 0)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+    }
+
+    period_ = seconds;
+  }
+
+
+  void SQLiteSnapshotter::SetPagesPerStep(unsigned int pages)
+  {
+    if (IsRunning())
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_BadSequenceOfCalls);
+    }
+    else if (pages == 0 ||
+             pages > 1024 * 1024)
+    {
+      throw Orthanc::OrthancException(Orthanc::ErrorCode_ParameterOutOfRange);
+    }
+
+    pagesPerStep_ = static_cast<int>(pages);
+  }
+
+
+  void SQLiteSnapshotter::Start()
+  {
+    StartWorker(1000 * period_);
+  }
+
+
+  void SQLiteSnapshotter::Stop()
+  {
+    StopWorker();
+  }
+}
@@ -0,0 +1,69 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2016 Sebastien Jodogne, Medical Physics
+ * Department, University Hospital of Liege, Belgium
+ * Copyright (C) 2017-2018 Osimis S.A., Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Affero General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include "SQLiteIndex.h"
+#include "../../Framework/Plugins/PeriodicWorker.h"
+
+namespace OrthancDatabases
+{
+  /**
+   * Background thread that periodically writes a snapshot of the
+   * SQLite index that is kept in memory (cf.
+   * "SQLiteIndex::SetInMemory()"). The period is the maximum amount
+   * of time during which the modifications are lost on a crash.
+   **/
+  class SQLiteSnapshotter :
+    public PeriodicWorker,
+    private SQLiteIndex::ICancellation
+  {
+  private:
+    SQLiteIndex&   index_;
+    unsigned int   period_;
+    int            pagesPerStep_;
+
+    // Gives up the current snapshot once the thread is stopped
+    virtual bool IsCancelled()
+    {
+      return ShouldStop();
+    }
+
+  protected:
+    virtual void RunRound();
+
+  public:
+    explicit SQLiteSnapshotter(SQLiteIndex& index);
+
+    virtual ~SQLiteSnapshotter();
+
+    // Number of seconds between two snapshots
+    void SetPeriod(unsigned int seconds);
+
+    // Number of pages that are copied while Orthanc cannot access
+    // the index (cf. "SQLiteIndex::WriteSnapshot()")
+    void SetPagesPerStep(unsigned int pages);
+
+    void Start();
+
+    void Stop();
+  };
+}
@@ -19,12 +19,19 @@
  **/
 
 
+#include "../../Framework/Common/Integer64Value.h"
+#include "../../Framework/Plugins/IndexMaintenance.h"
+#include "../../Framework/Plugins/PublicIdsFilter.h"
 #include "../../Framework/SQLite/SQLiteDatabase.h"
+#include "../Plugins/SQLiteCheckpointer.h"
 #include "../Plugins/SQLiteIndex.h"
 
 #include <Core/Logging.h>
 #include <Core/SystemToolbox.h>
 
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
 #include <gtest/gtest.h>
 
 
@@ -59,6 +66,254 @@ TEST(SQLiteIndex, Lock)
 }
 
 
+TEST(SQLiteIndex, Maintenance)
+{
+  OrthancDatabases::SQLiteIndex db;  // Open in memory
+  db.Open();
+
+  db.CreateResource("patient1", OrthancPluginResourceType_Patient);
+  db.CreateResource("patient2", OrthancPluginResourceType_Patient);
+
+  std::list<std::string> tables;
+  db.GetTablesToMaintain(tables, 3);
+  ASSERT_TRUE(tables.empty());
+
+  db.GetTablesToMaintain(tables, 2);
+  ASSERT_EQ(1u, tables.size());
+  ASSERT_EQ("Resources", tables.front());
+
+  // No maintenance while Orthanc is running a transaction
+  db.StartTransaction();
+  ASSERT_FALSE(db.MaintainTable("Resources"));
+  db.CommitTransaction();
+
+  ASSERT_TRUE(db.MaintainTable("Resources"));
+  db.GetTablesToMaintain(tables, 1);
+  ASSERT_TRUE(tables.empty());
+
+  OrthancDatabases::IndexMaintenance maintenance(db);
+  ASSERT_FALSE(maintenance.IsEnabled());
+  ASSERT_THROW(maintenance.SetQuietHours(0, 24), Orthanc::OrthancException);
+
+  ASSERT_FALSE(maintenance.HasQuietHours());
+  ASSERT_FALSE(maintenance.IsQuietHour(12));  // No maintenance by default
+
+  maintenance.SetThreshold(1000);
+  ASSERT_FALSE(maintenance.IsEnabled());  // The quiet hours are required
+
+  maintenance.SetQuietHours(0, 0);  // Explicitly any time
+  ASSERT_TRUE(maintenance.IsEnabled());
+  ASSERT_TRUE(maintenance.IsQuietHour(12));
+
+  maintenance.SetQuietHours(22, 6);  // Wraps around midnight
+  ASSERT_TRUE(maintenance.IsQuietHour(23));
+  ASSERT_TRUE(maintenance.IsQuietHour(0));
+  ASSERT_FALSE(maintenance.IsQuietHour(6));
+  ASSERT_FALSE(maintenance.IsQuietHour(12));
+
+  maintenance.SetQuietHours(1, 3);
+  ASSERT_FALSE(maintenance.IsQuietHour(0));
+  ASSERT_TRUE(maintenance.IsQuietHour(2));
+  ASSERT_FALSE(maintenance.IsQuietHour(3));
+}
+
+
+TEST(SQLiteIndex, Checkpoint)
+{
+  Orthanc::SystemToolbox::RemoveFile("index.db");
+
+  {
+    OrthancDatabases::SQLiteIndex db("index.db");
+    db.SetBackgroundCheckpoints(true);  // No automatic checkpoint
+    db.Open();
+
+    db.StartTransaction();
+    for (unsigned int i = 0; i < 100; i++)
+    {
+      std::string id = "patient" + boost::lexical_cast<std::string>(i);
+      db.CreateResource(id.c_str(), OrthancPluginResourceType_Patient);
+    }
+    db.CommitTransaction();
+
+    int walFrames;
+
+    // The checkpoint does not wait for the transactions of Orthanc,
+    // but it may only be partial
+    db.StartTransaction();
+    db.CreateResource("other", OrthancPluginResourceType_Patient);
+    db.Checkpoint(walFrames, false);
+    ASSERT_GT(walFrames, 0);
+    db.CommitTransaction();
+
+    ASSERT_TRUE(db.Checkpoint(walFrames, false));
+    ASSERT_GT(walFrames, 0);
+
+    ASSERT_TRUE(db.Checkpoint(walFrames, true));
+    ASSERT_EQ(0, walFrames);
+
+    Json::Value statistics;
+    db.GetStatistics(statistics);
+    ASSERT_EQ(3u, statistics["Checkpoints"]["Count"].asUInt());
+    ASSERT_EQ(0, statistics["Checkpoints"]["WalFrames"].asInt());
+
+    OrthancDatabases::SQLiteCheckpointer checkpointer(db);
+    checkpointer.SetPeriod(3600 * 1000);
+    checkpointer.Start();
+    ASSERT_TRUE(checkpointer.IsRunning());
+    ASSERT_THROW(checkpointer.SetPeriod(1000), Orthanc::OrthancException);
+
+    // Stopping wakes up the thread, without waiting for the period
+    const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    checkpointer.Stop();
+    ASSERT_FALSE(checkpointer.IsRunning());
+    ASSERT_LT((boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds(), 1000);
+  }
+
+  Orthanc::SystemToolbox::RemoveFile("index.db");
+}
+
+
+namespace
+{
+  class CancelledSnapshot : public OrthancDatabases::SQLiteIndex::ICancellation
+  {
+  public:
+    virtual bool IsCancelled()
+    {
+      return true;
+    }
+  };
+}
+
+
+TEST(SQLiteIndex, Snapshot)
+{
+  Orthanc::SystemToolbox::RemoveFile("snapshot.db");
+
+  {
+    OrthancDatabases::SQLiteIndex db("snapshot.db");
+    db.SetInMemory(true);
+    ASSERT_FALSE(db.WriteSnapshot(-1, NULL));  // Not opened yet
+    db.Open();
+
+    db.CreateResource("patient1", OrthancPluginResourceType_Patient);
+
+    CancelledSnapshot cancelled;
+    ASSERT_FALSE(db.WriteSnapshot(1, &cancelled));
+    ASSERT_FALSE(Orthanc::SystemToolbox::IsRegularFile("snapshot.db"));
+    ASSERT_FALSE(Orthanc::SystemToolbox::IsRegularFile("snapshot.db.tmp"));
+
+    ASSERT_TRUE(db.WriteSnapshot(1, NULL));  // One page per step
+    ASSERT_TRUE(Orthanc::SystemToolbox::IsRegularFile("snapshot.db"));
+
+    db.CreateResource("patient2", OrthancPluginResourceType_Patient);
+    db.Close();  // Writes the final snapshot
+  }
+
+  {
+    OrthancDatabases::SQLiteIndex db("snapshot.db");
+    db.SetInMemory(true);
+    db.Open();
+    ASSERT_EQ(2u, db.GetResourceCount(OrthancPluginResourceType_Patient));
+
+    Json::Value statistics;
+    db.GetStatistics(statistics);
+    ASSERT_EQ(0u, statistics["Snapshots"]["Count"].asUInt());
+    db.Close();
+    ASSERT_FALSE(db.WriteSnapshot(-1, NULL));  // Closed
+  }
+
+  {
+    // No file to store the snapshots
+    OrthancDatabases::SQLiteIndex db;
+    ASSERT_THROW(db.SetInMemory(true), Orthanc::OrthancException);
+  }
+
+  Orthanc::SystemToolbox::RemoveFile("snapshot.db");
+}
+
+
+TEST(SQLiteIndex, DISABLED_IngestBenchmark)
+{
+  // Run with "--gtest_also_run_disabled_tests" to compare the
+  // throughput of the ingest in memory (with snapshots) and in a
+  // file in WAL mode
+  static const unsigned int COUNT = 10000;
+
+  for (unsigned int mode = 0; mode < 2; mode++)
+  {
+    Orthanc::SystemToolbox::RemoveFile("benchmark.db");
+
+    OrthancDatabases::SQLiteIndex db("benchmark.db");
+    db.SetInMemory(mode == 1);
+    db.Open();
+
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+    for (unsigned int i = 0; i < COUNT; i++)
+    {
+      // One transaction per instance, as Orthanc does
+      db.StartTransaction();
+      std::string id = "instance" + boost::lexical_cast<std::string>(i);
+      int64_t instance = db.CreateResource(id.c_str(), OrthancPluginResourceType_Instance);
+      db.SetMainDicomTag(instance, 0x0008, 0x0018, id.c_str());
+      db.SetIdentifierTag(instance, 0x0008, 0x0018, id.c_str());
+      db.CommitTransaction();
+    }
+
+    boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+
+    LOG(WARNING) << (mode == 1 ? "In memory" : "File in WAL mode") << ": "
+                 << (COUNT * 1000 / std::max<int64_t>(1, elapsed.total_milliseconds()))
+                 << " instances/second";
+
+    db.Close();
+  }
+
+  Orthanc::SystemToolbox::RemoveFile("benchmark.db");
+}
+
+
+TEST(SQLiteIndex, DISABLED_PaginationBenchmark)
+{
+  // Run with "--gtest_also_run_disabled_tests" to measure the latency
+  // of "GetAllPublicIds()" with respect to the depth of the page
+  static const unsigned int COUNT = 100000;
+  static const unsigned int PAGE = 100;
+
+  OrthancDatabases::SQLiteIndex db;  // Open in memory
+  db.Open();
+
+  db.StartTransaction();
+
+  for (unsigned int i = 0; i < COUNT; i++)
+  {
+    std::string id = "instance" + boost::lexical_cast<std::string>(i);
+    db.CreateResource(id.c_str(), OrthancPluginResourceType_Instance);
+  }
+
+  db.CommitTransaction();
+
+  std::list<std::string> page;
+
+  for (unsigned int since = 0; since < COUNT; since += PAGE)
+  {
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    db.GetAllPublicIds(page, OrthancPluginResourceType_Instance, since, PAGE);
+    boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+
+    ASSERT_EQ(PAGE, page.size());
+    ASSERT_EQ("instance" + boost::lexical_cast<std::string>(since), page.front());
+
+    if (since % (COUNT / 10) == 0)
+    {
+      LOG(WARNING) << "Page at depth " << since << ": "
+                   << elapsed.total_microseconds() << " us";
+    }
+  }
+}
+
+
 TEST(SQLite, ImplicitTransaction)
 {
   OrthancDatabases::SQLiteDatabase db;
@@ -105,6 +360,439 @@ TEST(SQLite, ImplicitTransaction)
 }
 
 
+namespace
+{
+  class InMemoryFactory : public OrthancDatabases::IDatabaseFactory
+  {
+  public:
+    virtual OrthancDatabases::Dialect GetDialect() const
+    {
+      return OrthancDatabases::Dialect_SQLite;
+    }
+
+    virtual OrthancDatabases::IDatabase* Open()
+    {
+      std::auto_ptr<OrthancDatabases::SQLiteDatabase> db(new OrthancDatabases::SQLiteDatabase);
+      db->OpenInMemory();
+      return db.release();
+    }
+  };
+}
+
+
+TEST(DatabaseManager, MaxCachedStatements)
+{
+  OrthancDatabases::DatabaseManager manager(new InMemoryFactory);
+  manager.SetMaxCachedStatements(2);
+  manager.Open();
+
+  ASSERT_EQ(0u, manager.GetCachedStatementsCount());
+
+  {
+    OrthancDatabases::DatabaseManager::CachedStatement s(STATEMENT_FROM_HERE, manager, "SELECT 1");
+    s.Execute();
+  }
+
+  ASSERT_EQ(1u, manager.GetCachedStatementsCount());
+
+  {
+    OrthancDatabases::DatabaseManager::CachedStatement s(STATEMENT_FROM_HERE, manager, "SELECT 2");
+    s.Execute();
+  }
+
+  ASSERT_EQ(2u, manager.GetCachedStatementsCount());
+
+  {
+    // The statements that are alive are never discarded
+    OrthancDatabases::DatabaseManager::Transaction t(manager);
+
+    {
+      OrthancDatabases::DatabaseManager::CachedStatement s1(STATEMENT_FROM_HERE, t, "SELECT 3");
+      s1.Execute();
+
+      {
+        OrthancDatabases::DatabaseManager::CachedStatement s2(STATEMENT_FROM_HERE, t, "SELECT 4");
+        s2.Execute();
+      }
+
+      ASSERT_EQ(4u, manager.GetCachedStatementsCount());
+      ASSERT_FALSE(s1.IsDone());
+    }
+
+    t.Commit();
+  }
+
+  ASSERT_EQ(2u, manager.GetCachedStatementsCount());
+
+  manager.SetMaxCachedStatements(1);
+  ASSERT_EQ(1u, manager.GetCachedStatementsCount());
+
+  manager.SetMaxCachedStatements(0);  // No limit
+
+  {
+    OrthancDatabases::DatabaseManager::CachedStatement s(STATEMENT_FROM_HERE, manager, "SELECT 5");
+    s.Execute();
+  }
+
+  ASSERT_EQ(2u, manager.GetCachedStatementsCount());
+
+  manager.Close();
+  ASSERT_EQ(0u, manager.GetCachedStatementsCount());
+
+  // The statements are prepared again when reconnecting
+  manager.Open();
+  ASSERT_EQ(2u, manager.GetCachedStatementsCount());
+
+  manager.SetMaxCachedStatements(1);
+  ASSERT_EQ(1u, manager.GetCachedStatementsCount());  // "SELECT 5" is the most recent
+}
+
+
+namespace
+{
+  void InsertValue(OrthancDatabases::DatabaseManager* manager,
+                   int value)
+  {
+    OrthancDatabases::DatabaseManager::Transaction t(*manager);
+
+    {
+      OrthancDatabases::DatabaseManager::CachedStatement s(
+        STATEMENT_FROM_HERE, t, "INSERT INTO Test VALUES(${value})");
+      s.SetParameterType("value", OrthancDatabases::ValueType_Integer64);
+
+      OrthancDatabases::Dictionary args;
+      args.SetIntegerValue("value", value);
+      s.Execute(args);
+    }
+
+    t.Commit();
+  }
+
+
+  int64_t CountValues(OrthancDatabases::DatabaseManager& manager)
+  {
+    OrthancDatabases::DatabaseManager::CachedStatement s(
+      STATEMENT_FROM_HERE, manager, "SELECT COUNT(*) FROM Test");
+    s.Execute();
+    s.SetResultFieldType(0, OrthancDatabases::ValueType_Integer64);
+    return dynamic_cast<const OrthancDatabases::Integer64Value&>(s.GetResultField(0)).GetValue();
+  }
+}
+
+
+TEST(DatabaseManager, GroupCommit)
+{
+  static const unsigned int COUNT = 32;
+
+  OrthancDatabases::DatabaseManager manager(new InMemoryFactory);
+  manager.Open();
+
+  {
+    OrthancDatabases::DatabaseManager::CachedStatement s(
+      STATEMENT_FROM_HERE, manager, "CREATE TABLE Test(value INTEGER UNIQUE)");
+    s.Execute();
+  }
+
+  manager.SetGroupCommit(200);
+
+  {
+    std::vector<boost::thread*> threads;
+
+    for (unsigned int i = 0; i < COUNT; i++)
+    {
+      threads.push_back(new boost::thread(InsertValue, &manager, i));
+    }
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+      threads[i]->join();
+      delete threads[i];
+    }
+  }
+
+  ASSERT_EQ(COUNT, CountValues(manager));
+
+  uint64_t commits, transactions;
+  manager.GetGroupCommitStatistics(commits, transactions);
+  ASSERT_EQ(COUNT, transactions);
+  ASSERT_LT(commits, transactions);
+
+  {
+    // The transaction that is waiting in the group is replayed, if
+    // another transaction of the group is rolled back
+    boost::thread waiting(InsertValue, &manager, 100);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+
+    {
+      OrthancDatabases::DatabaseManager::Transaction t(manager);
+      OrthancDatabases::DatabaseManager::CachedStatement s(
+        STATEMENT_FROM_HERE, t, "INSERT INTO Test VALUES(101)");
+      s.Execute();
+      // Not committed
+    }
+
+    waiting.join();
+  }
+
+  ASSERT_EQ(COUNT + 1, CountValues(manager));
+
+  // Failure of one transaction of the group (violation of the UNIQUE constraint)
+  ASSERT_THROW(InsertValue(&manager, 100), Orthanc::OrthancException);
+  InsertValue(&manager, 102);
+  ASSERT_EQ(COUNT + 2, CountValues(manager));
+
+  manager.SetGroupCommit(0);
+  InsertValue(&manager, 103);
+  ASSERT_EQ(COUNT + 3, CountValues(manager));
+
+  {
+    // A read-only transaction does not join the group, whose
+    // changes are committed before it starts
+    manager.SetGroupCommit(10000);
+
+    boost::thread waiting(InsertValue, &manager, 104);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+
+    manager.GetGroupCommitStatistics(commits, transactions);
+
+    {
+      OrthancDatabases::DatabaseManager::Transaction t(manager, true);
+
+      uint64_t commits2, transactions2;
+      manager.GetGroupCommitStatistics(commits2, transactions2);
+      ASSERT_EQ(commits + 1, commits2);
+      ASSERT_EQ(transactions + 1, transactions2);
+      ASSERT_TRUE(t.GetGroupMember() == NULL);
+
+      t.Commit();
+    }
+
+    ASSERT_TRUE(waiting.timed_join(boost::posix_time::seconds(5)));
+    ASSERT_EQ(COUNT + 4, CountValues(manager));
+  }
+}
+
+
+namespace
+{
+  struct SumDefinition
+  {
+    enum Parameter
+    {
+      Parameter_A,
+      Parameter_B,
+      Parameter_Count
+    };
+
+    static const OrthancDatabases::StatementParameter  PARAMETERS[];
+    static const char* const                           SQL_MYSQL;
+    static const char* const                           SQL_POSTGRESQL;
+    static const char* const                           SQL_SQLITE;
+  };
+
+  const OrthancDatabases::StatementParameter SumDefinition::PARAMETERS[] =
+  {
+    { "a", OrthancDatabases::ValueType_Integer64 },
+    { "b", OrthancDatabases::ValueType_Integer64 },
+    { NULL, OrthancDatabases::ValueType_Null }
+  };
+
+  const char* const SumDefinition::SQL_MYSQL = "SELECT ${a} + ${b}";
+  const char* const SumDefinition::SQL_POSTGRESQL = "SELECT ${a} + ${b}";
+  const char* const SumDefinition::SQL_SQLITE = "SELECT ${a} + ${b} + ${a}";
+
+
+  // The parameter "b" is misspelled in the SQL
+  struct MisspelledDefinition
+  {
+    enum Parameter
+    {
+      Parameter_A,
+      Parameter_B,
+      Parameter_Count
+    };
+
+    static const OrthancDatabases::StatementParameter  PARAMETERS[];
+    static const char* const                           SQL_MYSQL;
+    static const char* const                           SQL_POSTGRESQL;
+    static const char* const                           SQL_SQLITE;
+  };
+
+  const OrthancDatabases::StatementParameter MisspelledDefinition::PARAMETERS[] =
+  {
+    { "a", OrthancDatabases::ValueType_Integer64 },
+    { "b", OrthancDatabases::ValueType_Integer64 },
+    { NULL, OrthancDatabases::ValueType_Null }
+  };
+
+  const char* const MisspelledDefinition::SQL_MYSQL = "SELECT ${a} + ${b}";
+  const char* const MisspelledDefinition::SQL_POSTGRESQL = "SELECT ${a} + ${b}";
+  const char* const MisspelledDefinition::SQL_SQLITE = "SELECT ${a} + ${bb}";
+}
+
+
+TEST(StatementTemplate, Basic)
+{
+  static const OrthancDatabases::StatementTemplate<SumDefinition>  SUM;
+  static const OrthancDatabases::StatementTemplate<MisspelledDefinition>  MISSPELLED;
+
+  ASSERT_EQ(2u, SUM.GetParametersCount());
+  ASSERT_STREQ("b", SUM.GetParameter(SumDefinition::Parameter_B).name_);
+  ASSERT_STREQ("SELECT ${a} + ${b} + ${a}", SUM.GetSql(OrthancDatabases::Dialect_SQLite));
+  ASSERT_THROW(SUM.GetParameter(2), Orthanc::OrthancException);
+
+  OrthancDatabases::DatabaseManager manager(new InMemoryFactory);
+  manager.Open();
+
+  for (unsigned int i = 0; i < 2; i++)  // The second time, the statement is cached
+  {
+    OrthancDatabases::DatabaseManager::CachedStatement s(STATEMENT_FROM_HERE, manager, SUM);
+
+    OrthancDatabases::StatementTemplate<SumDefinition>::Arguments args;
+    args.SetInteger(SumDefinition::Parameter_A, 20);
+    args.SetInteger(SumDefinition::Parameter_B, 2);
+    s.Execute(args.GetDictionary());
+
+    s.SetResultFieldType(0, OrthancDatabases::ValueType_Integer64);
+    ASSERT_EQ(42, dynamic_cast<const OrthancDatabases::Integer64Value&>(s.GetResultField(0)).GetValue());
+  }
+
+  ASSERT_THROW({
+      OrthancDatabases::DatabaseManager::CachedStatement s(STATEMENT_FROM_HERE, manager, MISSPELLED);
+    }, Orthanc::OrthancException);
+}
+
+
+TEST(PublicIdsFilter, Basic)
+{
+  static const unsigned int COUNT = 100000;
+
+  OrthancDatabases::PublicIdsFilter filter;
+  ASSERT_FALSE(filter.NeedsRebuild());     // The first build is done while opening the index
+  ASSERT_TRUE(filter.MayContain("nope"));  // Not built yet
+
+  filter.StartRebuild();
+  ASSERT_THROW(filter.StartRebuild(), Orthanc::OrthancException);
+
+  OrthancDatabases::PublicIdsFilter::Builder builder(COUNT);
+
+  for (unsigned int i = 0; i < COUNT; i++)
+  {
+    builder.Add("resource-" + boost::lexical_cast<std::string>(i));
+  }
+
+  // Resource that was created while reading the database, and that
+  // is not part of the snapshot that fills the builder
+  filter.Add("added");
+
+  ASSERT_TRUE(filter.MayContain("nope"));  // Still not built
+  filter.FinishRebuild(builder);
+  ASSERT_FALSE(filter.NeedsRebuild());
+  ASSERT_THROW(filter.FinishRebuild(builder), Orthanc::OrthancException);
+
+  ASSERT_TRUE(filter.MayContain("added"));
+
+  for (unsigned int i = 0; i < COUNT; i++)
+  {
+    // No false negative
+    ASSERT_TRUE(filter.MayContain("resource-" + boost::lexical_cast<std::string>(i)));
+  }
+
+  unsigned int falsePositives = 0;
+  for (unsigned int i = 0; i < COUNT; i++)
+  {
+    if (filter.MayContain("other-" + boost::lexical_cast<std::string>(i)))
+    {
+      falsePositives++;
+    }
+  }
+
+  ASSERT_LT(falsePositives, COUNT / 50);
+
+  for (unsigned int i = 0; i < COUNT / 2; i++)
+  {
+    filter.SignalDeletion();
+  }
+
+  ASSERT_TRUE(filter.NeedsRebuild());
+
+  {
+    // The previous filter remains in use during the rebuild
+    filter.StartRebuild();
+    ASSERT_FALSE(filter.NeedsRebuild());
+    ASSERT_TRUE(filter.MayContain("resource-0"));
+    filter.SignalDeletion();
+    filter.Add("added-again");
+    ASSERT_TRUE(filter.MayContain("added-again"));
+
+    OrthancDatabases::PublicIdsFilter::Builder empty(0);
+    filter.FinishRebuild(empty);
+    ASSERT_FALSE(filter.NeedsRebuild());
+    ASSERT_TRUE(filter.MayContain("added-again"));
+
+    Json::Value statistics;
+    filter.GetStatistics(statistics);
+    ASSERT_EQ(2u, statistics["Rebuilds"].asUInt());
+    ASSERT_EQ(1u, statistics["Count"].asUInt());
+    ASSERT_EQ(1u, statistics["Deletions"].asUInt());
+  }
+
+  {
+    // A cancelled rebuild keeps the current filter
+    filter.StartRebuild();
+    filter.CancelRebuild();
+    ASSERT_TRUE(filter.MayContain("added-again"));
+  }
+
+  filter.SetEnabled(false);
+  ASSERT_FALSE(filter.NeedsRebuild());
+  ASSERT_TRUE(filter.MayContain("other-0"));
+}
+
+
+TEST(SQLiteIndex, PublicIdsFilter)
+{
+  // More resources than the minimal capacity of the filter
+  static const unsigned int COUNT = 70000;
+
+  OrthancDatabases::SQLiteIndex db;  // Open in memory
+  db.Open();
+
+  int64_t id;
+  OrthancPluginResourceType type;
+  ASSERT_FALSE(db.LookupResource(id, type, "nope"));
+
+  db.StartTransaction();
+
+  for (unsigned int i = 0; i < COUNT; i++)
+  {
+    db.CreateResource(("instance" + boost::lexical_cast<std::string>(i)).c_str(),
+                      OrthancPluginResourceType_Instance);
+  }
+
+  // No rebuild while Orthanc is running a transaction
+  ASSERT_FALSE(db.RefreshPublicIdsFilter());
+  db.CommitTransaction();
+
+  Json::Value statistics;
+  db.GetStatistics(statistics);
+  ASSERT_EQ(1u, statistics["PublicIdsFilter"]["Rebuilds"].asUInt());  // Built by "Open()"
+
+  ASSERT_TRUE(db.RefreshPublicIdsFilter());
+  db.GetStatistics(statistics);
+  ASSERT_EQ(2u, statistics["PublicIdsFilter"]["Rebuilds"].asUInt());
+  ASSERT_EQ(COUNT, statistics["PublicIdsFilter"]["Count"].asUInt());
+  ASSERT_LT(static_cast<unsigned int>(COUNT), statistics["PublicIdsFilter"]["Capacity"].asUInt());
+
+  ASSERT_TRUE(db.RefreshPublicIdsFilter());  // Nothing to do
+  db.GetStatistics(statistics);
+  ASSERT_EQ(2u, statistics["PublicIdsFilter"]["Rebuilds"].asUInt());
+
+  ASSERT_TRUE(db.LookupResource(id, type, "instance0"));
+  ASSERT_FALSE(db.LookupResource(id, type, "nope"));
+}
+
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);